@@ -1,5 +1,8 @@
 #include "AbstractSyntax.h"
 #include "CompilerException.h"
+#include "TypeInference.h"
+#include "Optimize.h"
+#include "IntermediateRepresentation.h"
 #include <typeindex>
 #include <memory>
 #include <set>
@@ -217,6 +220,7 @@ public:
         return std::move(p);
     }
     void Handle(FunctionBlock& type, const vector<wstring>& idList);
+    void HandlePreParsed(FunctionBlock& type, const vector<wstring>& idList);
 private:
     SemanticAnalysisEnvironment& environment;
 };
@@ -390,7 +394,31 @@ void WhileBlockProcess::Handle(WhileBlock& type) {
     environment.ExitWhileBlock();
 }
 
+/*
+    Ԥĺ ɼ () հ ܱʵҪĶ
+    еĴںʱŻᷢ
+*/
+void FunctionBlockProcess::HandlePreParsed(FunctionBlock& type, const vector<wstring>& idList) {
+    environment.EnterFunctionBlock();
+    for (auto& id : idList) {
+        if (environment.FindIdInCurrentBlock(id)) {
+            throw CompileException(MessageHead(type.line) + WstringToString(id) + "ظ");
+        }
+        environment.DefineVariable(id);
+    }
+    for (auto& name : type.preParsed->names) {
+        if (environment.FindIdInCurrentBlock(name) == false && environment.FindIdInPrevousEnvironment(name)) {
+            environment.DefineVariableAndClosure(name);
+        }
+    }
+    type.closure = environment.ExitFunctionBlock();
+}
+
 void FunctionBlockProcess::Handle(FunctionBlock& type, const vector<wstring>& idList) {
+    if (type.preParsed != nullptr) {
+        HandlePreParsed(type, idList);
+        return;
+    }
     if (type.statements.empty()) {
         type.statements.push_back(CreateReturnNull(type.line));
     } else if (!IsReturnProcess(environment).Handle(*type.statements.back())) {
@@ -468,716 +496,833 @@ AbstractSyntaxTreeTransform SemanticAnalysis(const RegisteredNameList& nameList,
     return AbstractSyntaxTreeTransform(std::move(root));
 }
 
+void SemanticAnalysisPreParsedFunction(FunctionBlock& type, const vector<wstring>& idList) {
+    //ֻԤʱõıհ հֲ (ʱ˳)
+    auto closure = type.closure;
+    SemanticAnalysisEnvironment environment(vector<wstring>(closure.begin(), closure.end()));
+    FunctionBlockProcess(environment).Handle(type, idList);
+    type.closure = std::move(closure);
+}
+
 /*----------------------------------------------------------------------------------------
                                      ɴ
 ----------------------------------------------------------------------------------------*/
 
+/*----------------------------------------------------------------------------------------
+                                     мʾ
+----------------------------------------------------------------------------------------*/
+
 struct VariableData {
-    inline VariableData(bool closure, int16_t offest) : closure(closure), offest(offest) {}
+    inline VariableData(bool closure, int32_t index) : closure(closure), index(index) {}
     bool closure;
-    int16_t offest;
+    int32_t index;
 };
 
-struct CodeGenerateBlock {
-    CodeGenerateBlock() : whileBegin() {}
-    CodeGenerateBlock(int32_t whileBegin) : whileBegin(whileBegin) {}
-    map<wstring, int16_t> variableOffest;
-    optional<int32_t> whileBegin;
-    vector<function<void(int32_t)>> breakActions;
-    vector<function<void(int32_t)>> continueActions;
+struct LowerLoop {
+    inline LowerLoop(int32_t entry, int32_t exit) : entry(entry), exit(exit) {}
+    int32_t entry;
+    int32_t exit;
 };
 
-class StringMap {
-public:
-    void Insert(const wstring& idName) {
-        int32_t index = static_cast<int32_t>(idNames.size());
-        idNames.push_back(idName);
-        idToIndexMap.insert(pair(idName, index));
-    }
-    int32_t GetIndex(const wstring& idName) const {
-        auto find = idToIndexMap.find(idName);
-        if (find != idToIndexMap.end()) {
-            return find->second;
-        }
-        throw CompilerError();
-    }
-public:
-    vector<wstring> idNames;
-    map<wstring, int32_t> idToIndexMap;
-};
+inline IRInstruction NewInstruction(IROperation operation, int line, vector<int32_t> operands = vector<int32_t>()) {
+    IRInstruction instruction;
+    instruction.operation = operation;
+    instruction.operands = std::move(operands);
+    instruction.line = line;
+    return instruction;
+}
 
-class CodeGenerateStack {
+/*
+    һ״̬ ǰ  ѭ
+    ֲñűʾ Ϊǰֲ
+*/
+class FunctionLower {
 public:
-    CodeGenerateStack() : currentStackOffest(0) {}
-    CodeGenerateStack(const vector<wstring>& closure, const vector<wstring>& parameters) : closure(closure) {
-        blocks.push_back(CodeGenerateBlock());
-        auto& top = blocks[0];
-        //ѹ SP PC հ ʼƫΪ2
-        int16_t offest = 2;
+    FunctionLower(const vector<wstring>& closure, const vector<wstring>& parameters) : closure(closure), current(0) {
+        function.parameterCount = static_cast<int8_t>(parameters.size());
+        function.closureLength = static_cast<int16_t>(closure.size());
+        scopes.push_back(map<wstring, int32_t>());
         for (auto& parameter : parameters) {
-            offest += 1;
-            top.variableOffest.insert(pair(parameter, offest));
+            DefineVariable(parameter);
         }
-        currentStackOffest = offest;
+        StartBlock(NewBlock());
     }
-    void EnterBlock() {
-        blocks.push_back(CodeGenerateBlock());
+    int32_t NewBlock() {
+        function.blocks.push_back(IRBlock());
+        return static_cast<int32_t>(function.blocks.size() - 1);
     }
-    void ExitBlock() {
-        auto block = std::move(blocks.back());
-        blocks.pop_back();
-        auto& top = blocks.back();
-        std::move(block.breakActions.begin(), block.breakActions.end(), std::back_inserter(top.breakActions));
-        std::move(block.continueActions.begin(), block.continueActions.end(), std::back_inserter(top.continueActions));
-    }
-    void EnterWhileBlock(int32_t whileBegin) {
-        blocks.push_back(CodeGenerateBlock(whileBegin));
-    }
-    void ExitWhileBlock(int32_t nextPosition) {
-        auto& top = blocks.back();
-        for (auto& action : top.breakActions) {
-            action(nextPosition);
+    void StartBlock(int32_t block) {
+        function.layout.push_back(block);
+        current = block;
+    }
+    bool Terminated() {
+        auto& instructions = function.blocks[current].instructions;
+        return instructions.empty() == false && IRIsTerminator(instructions.back().operation);
+    }
+    //ѾĻָ֮ɴ µĻ
+    void Add(IRInstruction instruction) {
+        if (Terminated()) {
+            StartBlock(NewBlock());
         }
-        for (auto& action : top.continueActions) {
-            action(top.whileBegin.value());
+        function.blocks[current].instructions.push_back(std::move(instruction));
+    }
+    int32_t AddValue(IRInstruction instruction) {
+        int32_t value = function.valueCount;
+        function.valueCount += 1;
+        instruction.result = value;
+        Add(std::move(instruction));
+        return value;
+    }
+    //˳һ
+    void Fallthrough(int32_t next, int line) {
+        if (Terminated() == false) {
+            IRInstruction fallthrough = NewInstruction(IROperation::Fallthrough, line);
+            fallthrough.next = next;
+            Add(std::move(fallthrough));
         }
-        blocks.pop_back();
+        StartBlock(next);
     }
-    void RegistBreak(function<void(int32_t)> action) {
-        for (auto iter = blocks.rbegin(); iter < blocks.rend(); iter += 1) {
-            if (iter->whileBegin.has_value()) {
-                iter->breakActions.push_back(std::move(action));
-                return;
-            }
-        }
-        throw CompilerError();
+    void EnterBlock() {
+        scopes.push_back(map<wstring, int32_t>());
     }
-    void RegistContinue(function<void(int32_t)> action) {
-        for (auto iter = blocks.rbegin(); iter < blocks.rend(); iter += 1) {
-            if (iter->whileBegin.has_value()) {
-                iter->continueActions.push_back(std::move(action));
-                return;
-            }
+    void ExitBlock() {
+        scopes.pop_back();
+    }
+    void EnterWhileBlock(int32_t entry, int32_t exit) {
+        loops.push_back(LowerLoop(entry, exit));
+        EnterBlock();
+    }
+    void ExitWhileBlock() {
+        ExitBlock();
+        loops.pop_back();
+    }
+    LowerLoop& GetLoop() {
+        if (loops.empty()) {
+            throw CompilerError();
         }
-        throw CompilerError();
+        return loops.back();
     }
-    void DefineVariable(wstring varIdName) {
-        auto& top = blocks.back();
-        auto find = top.variableOffest.find(varIdName);
-        if (find != top.variableOffest.end()) {
+    int32_t DefineVariable(const wstring& varIdName) {
+        auto& top = scopes.back();
+        int32_t index = function.localCount;
+        auto [iter, b] = top.insert(pair(varIdName, index));
+        if (b == false) {
             throw CompilerError();
         }
-        top.variableOffest.insert(pair(varIdName, currentStackOffest));
+        function.localCount += 1;
+        return index;
     }
-    VariableData GetVariableData(wstring varIdName) {
-        for (auto iter = blocks.rbegin(); iter < blocks.rend(); iter += 1) {
-            auto find = iter->variableOffest.find(varIdName);
-            if (find != iter->variableOffest.end()) {
+    VariableData GetVariableData(const wstring& varIdName) {
+        for (auto iter = scopes.rbegin(); iter < scopes.rend(); iter += 1) {
+            auto find = iter->find(varIdName);
+            if (find != iter->end()) {
                 return VariableData(false, find->second);
             }
         }
-        if (closure.empty()) {
-            throw CompilerError();
-        }
         auto find = std::find(closure.begin(), closure.end(), varIdName);
         if (find != closure.end()) {
-            int16_t offest = static_cast<int16_t>(find - closure.begin());
-            return VariableData(true, offest);
+            return VariableData(true, static_cast<int32_t>(find - closure.begin()));
         }
         throw CompilerError();
     }
-    int16_t MoveOffest(int16_t value) {
-        currentStackOffest += value;
-        return currentStackOffest;
-    };
-    int16_t GetOffest() {
-        return currentStackOffest;
+    int32_t LoadVariable(const wstring& varIdName, int line) {
+        auto data = GetVariableData(varIdName);
+        IRInstruction load = NewInstruction(data.closure ? IROperation::LoadClosure : IROperation::LoadLocal, line);
+        load.index = data.index;
+        return AddValue(std::move(load));
+    }
+    void StoreVariable(const wstring& varIdName, int32_t value, int line) {
+        auto data = GetVariableData(varIdName);
+        IRInstruction store = NewInstruction(data.closure ? IROperation::StoreClosure : IROperation::StoreLocal, line, { value });
+        store.index = data.index;
+        Add(std::move(store));
     }
+public:
+    IRFunction function;
 private:
-    int16_t currentStackOffest;
     vector<wstring> closure;
-    vector<CodeGenerateBlock> blocks;
+    vector<map<wstring, int32_t>> scopes;
+    vector<LowerLoop> loops;
+    int32_t current;
 };
 
 /*
-    еݹ
+    ӳʱδתΪмʾĺ ָ﷨ ﷨Ҫһֱ
 */
-class CodeGenerateEnvironment {
+struct LowerPendingFunction {
+    StatementBlock* block = nullptr;
+    const set<wstring>* closure = nullptr;
+    const vector<wstring>* idList = nullptr;
+};
+
+class LowerEnvironment {
 public:
-    //زλ
-    int32_t AddInstruction(Instruction instruction, int line) {
-        int32_t index = static_cast<int32_t>(instructions.size());
-        instructions.push_back(instruction);
-        instructionLines.push_back(line);
-        return index;
-    }
-    Instruction* UpdateInstruction(int32_t index) {
-        return &instructions[index];
+    LowerEnvironment(const LowerOptions& options) : immediate(options.immediate), lazy(false), typeInference(options.typeInference),
+        tailCalls(options.tailCalls), selfCalls(options.selfCalls), staticFunctionBlocks(options.staticFunctionBlocks), nativeFunctions(options.nativeFunctions),
+        intrinsicFunctions(options.intrinsicFunctions) {}
+    //ƵѾ֤Ҳͬ (Int  Float)
+    optional<HeapEnum> GetOperandType(const BinaryOperation& type) {
+        auto find = typeInference.operandTypes.find(&type);
+        if (find == typeInference.operandTypes.end()) {
+            return optional<HeapEnum>();
+        }
+        return find->second;
     }
-    int32_t NewInstructionPosition() {
-        return static_cast<int32_t>(instructions.size());
+    bool IsStaticFunction(const FunctionBlock& type) {
+        return staticFunctionBlocks.find(&type) != staticFunctionBlocks.end();
     }
-    int32_t InsertString(const wstring& str) {
-        int32_t index = static_cast<int32_t>(strings.size());
-        auto [iter, b] = stringMap.insert(pair(str, index));
-        if (b == true) {
-            strings.push_back(str);
-            return index;
-        } else {
-            return iter->second;
+    //հеÿһʼʱȷ
+    vector<int16_t> StaticClosureItem(const FunctionBlock& type, optional<wstring> name) {
+        vector<int16_t> closureItem;
+        for (auto& idName : type.closure) {
+            if (idName == name) {
+                closureItem.push_back(-1);
+            } else {
+                auto find = std::find(mainClosure.begin(), mainClosure.end(), idName);
+                if (find == mainClosure.end()) {
+                    throw CompilerError();
+                }
+                closureItem.push_back(static_cast<int16_t>(find - mainClosure.begin()));
+            }
         }
+        return closureItem;
     }
-    void RegistMainClosureOffest(vector<int32_t> mainClosureOffest) {
-        this->mainClosureOffest = std::move(mainClosureOffest);
+    bool IsTailCall(const FunctionCall& type) {
+        return tailCalls.find(&type) != tailCalls.end();
     }
+    bool IsSelfCall(const FunctionCall& type) {
+        return selfCalls.find(&type) != selfCalls.end();
+    }
+    //ֱӵõıغ رغı (հеλ)
+    optional<int32_t> NativeFunctionIndex(const wstring& idName) {
+        if (nativeFunctions.find(idName) == nativeFunctions.end()) {
+            return optional<int32_t>();
+        }
+        auto find = std::find(mainClosure.begin(), mainClosure.end(), idName);
+        if (find == mainClosure.end()) {
+            return optional<int32_t>();
+        }
+        return static_cast<int32_t>(find - mainClosure.begin());
+    }
+    optional<InstructionEnum> IntrinsicInstruction(const wstring& idName) {
+        auto find = intrinsicFunctions.find(idName);
+        if (find == intrinsicFunctions.end()) {
+            return optional<InstructionEnum>();
+        }
+        return find->second;
+    }
+    // module.functions еλ ӳʱֻ¼
+    int32_t LowerFunction(StatementBlock& type, const set<wstring>& closure, const vector<wstring>& idList);
+    IRFunction LowerFunctionBody(StatementBlock& type, const set<wstring>& closure, const vector<wstring>& idList);
+    //ӳ δתĺ Ѿĺԭλ
+    int32_t AddPendingFunction(StatementBlock& type, const set<wstring>& closure, const vector<wstring>& idList);
+    void LowerPendingFunctionBody(int32_t index);
 public:
-    vector<Instruction> instructions;
-    vector<int> instructionLines;
-    vector<int32_t> mainClosureOffest;
-    vector<wstring> strings;
-    map<wstring, int32_t> stringMap;
+    IRModule module;
+    bool immediate;
+    bool lazy;
+    map<const StatementBlock*, int32_t> functionIndex;
+    map<int32_t, LowerPendingFunction> pendingFunction;
+    //ԤĺתΪмʾ֮ǰ ﷨ 
+    function<void(FunctionBlock&, const vector<wstring>&)> preParsedProcess;
+    const TypeInferenceResult& typeInference;
+    const set<const FunctionCall*>& tailCalls;
+    const set<const FunctionCall*>& selfCalls;
+    const set<const FunctionBlock*>& staticFunctionBlocks;
+    const set<wstring>& nativeFunctions;
+    const map<wstring, InstructionEnum>& intrinsicFunctions;
+    vector<wstring> mainClosure;
 };
 
-class ExpressionCodeGenerate : public AbstractSyntaxVisitor {
+/*
+    жҲܷΪ ֻ Int Float 
+*/
+class ImmediateLower : public AbstractSyntaxVisitor {
 public:
-    ExpressionCodeGenerate(CodeGenerateStack& stack, CodeGenerateEnvironment& environment) : stack(stack), environment(environment) {}
-    vector<function<void()>> Handle(Expression& type) {
+    optional<ConstantData> Handle(Expression& type) {
         type.Accept(*this);
-        return std::move(handleList);
-    }
-    void BinaryOperate(BinaryOperation& type, InstructionEnum instructionEnum) {
-        vector<function<void()>> resultList;
-        resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.left);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-        resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.right);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-        Instruction instruction;
-        instruction.type = instructionEnum;
-        instruction.offest = stack.MoveOffest(-1);
-        environment.AddInstruction(instruction, type.line);
+        return immediate;
+    }
+    void VisitExpression(Expression& type) override {}
+    void VisitUnaryOperation(UnaryOperation& type) override {}
+    void VisitBinaryOperation(BinaryOperation& type) override {}
+    void Visit(Int& type) override {
+        ConstantData constant;
+        constant.type = HeapEnum::Int;
+        constant.value.intValue = type.value;
+        immediate = constant;
+    }
+    void Visit(Float& type) override {
+        ConstantData constant;
+        constant.type = HeapEnum::Float;
+        constant.value.floatValue = type.value;
+        immediate = constant;
+    }
+private:
+    optional<ConstantData> immediate;
+};
+
+class ExpressionLower : public AbstractSyntaxVisitor {
+public:
+    ExpressionLower(FunctionLower& lower, LowerEnvironment& environment) : lower(lower), environment(environment), value(-1) {}
+    int32_t Handle(Expression& type) {
+        type.Accept(*this);
+        return value;
+    }
+    //immediate Ҳ Int Float ʱ ֱӷָ
+    //specialized ʹƵĽѡרָ
+    void BinaryOperate(BinaryOperation& type, InstructionEnum binary, bool immediate, bool specialized) {
+        int32_t left = ExpressionLower(lower, environment).Handle(*type.left);
+        IRInstruction instruction = NewInstruction(IROperation::Binary, type.line, { left });
+        instruction.binary = binary;
+        if (immediate && environment.immediate) {
+            auto constant = ImmediateLower().Handle(*type.right);
+            //㱣ԭеʱΪ
+            bool divide = (binary == InstructionEnum::Divide || binary == InstructionEnum::Modulus);
+            if (constant.has_value() && (divide && constant->type == HeapEnum::Int && constant->value.intValue == 0) == false) {
+                instruction.immediate = true;
+                instruction.constant = constant.value();
+                value = lower.AddValue(std::move(instruction));
+                return;
+            }
+        }
+        instruction.operands.push_back(ExpressionLower(lower, environment).Handle(*type.right));
+        if (specialized) {
+            instruction.operandType = environment.GetOperandType(type);
+        }
+        value = lower.AddValue(std::move(instruction));
     }
     void Visit(Multiply& type) override {
-        BinaryOperate(type, InstructionEnum::Multiply);
+        BinaryOperate(type, InstructionEnum::Multiply, true, true);
     }
     void Visit(Divide& type) override {
-        BinaryOperate(type, InstructionEnum::Divide);
+        BinaryOperate(type, InstructionEnum::Divide, true, true);
     }
     void Visit(Modulus& type) override {
-        BinaryOperate(type, InstructionEnum::Modulus);
+        BinaryOperate(type, InstructionEnum::Modulus, true, true);
     }
     void Visit(Add& type) override {
-        BinaryOperate(type, InstructionEnum::Add);
+        BinaryOperate(type, InstructionEnum::Add, true, true);
     }
     void Visit(Subtract& type) override {
-        BinaryOperate(type, InstructionEnum::Subtract);
+        BinaryOperate(type, InstructionEnum::Subtract, true, true);
     }
     void Visit(Less& type) override {
-        BinaryOperate(type, InstructionEnum::Less);
+        BinaryOperate(type, InstructionEnum::Less, true, true);
     }
     void Visit(LessEquals& type) override {
-        BinaryOperate(type, InstructionEnum::LessEquals);
+        BinaryOperate(type, InstructionEnum::LessEquals, true, true);
     }
     void Visit(Greater& type) override {
-        BinaryOperate(type, InstructionEnum::Greater);
+        BinaryOperate(type, InstructionEnum::Greater, true, true);
     }
     void Visit(GreaterEquals& type) override {
-        BinaryOperate(type, InstructionEnum::GreaterEquals);
+        BinaryOperate(type, InstructionEnum::GreaterEquals, true, true);
     }
     void Visit(Equals& type) override {
-        BinaryOperate(type, InstructionEnum::Equals);
+        BinaryOperate(type, InstructionEnum::Equals, true, false);
     }
     void Visit(NotEquals& type) override {
-        BinaryOperate(type, InstructionEnum::NotEquals);
+        BinaryOperate(type, InstructionEnum::NotEquals, true, false);
     }
     void Visit(Or& type) override {
-        BinaryOperate(type, InstructionEnum::Or);
+        BinaryOperate(type, InstructionEnum::Or, false, false);
     }
     void Visit(And& type) override {
-        BinaryOperate(type, InstructionEnum::And);
+        BinaryOperate(type, InstructionEnum::And, false, false);
     }
     //------------------------------
-    void UnaryOperate(UnaryOperation& type, InstructionEnum instructionEnum) {
-        handleList = ExpressionCodeGenerate(stack, environment).Handle(*type.expression);
-        Instruction instruction;
-        instruction.type = instructionEnum;
-        instruction.offest = stack.GetOffest();
-        environment.AddInstruction(instruction, type.line);
-    }
     void Visit(Not& type) override {
-        UnaryOperate(type, InstructionEnum::Not);
+        int32_t operand = ExpressionLower(lower, environment).Handle(*type.expression);
+        value = lower.AddValue(NewInstruction(IROperation::Not, type.line, { operand }));
     }
     //----------------------------------
     void Visit(SpecialOperationList& type) override;
     void Visit(Null& type) override {
-        Instruction instruction;
-        instruction.type = InstructionEnum::GetNull;
-        instruction.offest = stack.MoveOffest(1);
-        environment.AddInstruction(instruction, type.line);
+        value = lower.AddValue(NewInstruction(IROperation::Null, type.line));
     }
     void Visit(Bool& type) override {
-
-        Instruction instruction;
-        if (type.value) {
-            instruction.type = InstructionEnum::GetTrue;
-        } else {
-            instruction.type = InstructionEnum::GetFalse;
-        }
-        instruction.offest = stack.MoveOffest(1);
-        environment.AddInstruction(instruction, type.line);
+        value = lower.AddValue(NewInstruction(type.value ? IROperation::True : IROperation::False, type.line));
+    }
+    void LoadConstant(ConstantData constant, int line, wstring name = wstring()) {
+        IRInstruction instruction = NewInstruction(IROperation::Constant, line);
+        instruction.constant = constant;
+        instruction.name = std::move(name);
+        value = lower.AddValue(std::move(instruction));
     }
     void Visit(Char& type) override {
-        Instruction instruction;
-        instruction.type = InstructionEnum::CreateChar;
-        instruction.offest = stack.MoveOffest(1);
-        instruction.value.word = type.value;
-        environment.AddInstruction(instruction, type.line);
+        ConstantData constant;
+        constant.type = HeapEnum::Char;
+        constant.value.word = type.value;
+        LoadConstant(constant, type.line);
     }
     void Visit(Int& type) override {
-        Instruction instruction;
-        instruction.type = InstructionEnum::CreateInt;
-        instruction.offest = stack.MoveOffest(1);
-        instruction.value.intValue = type.value;
-        environment.AddInstruction(instruction, type.line);
+        ConstantData constant;
+        constant.type = HeapEnum::Int;
+        constant.value.intValue = type.value;
+        LoadConstant(constant, type.line);
     }
     void Visit(Float& type) override {
-        Instruction instruction;
-        instruction.type = InstructionEnum::CreateFloat;
-        instruction.offest = stack.MoveOffest(1);
-        instruction.value.floatValue = type.value;
-        environment.AddInstruction(instruction, type.line);
+        ConstantData constant;
+        constant.type = HeapEnum::Float;
+        constant.value.floatValue = type.value;
+        LoadConstant(constant, type.line);
     }
     void Visit(String& type) override {
-        Instruction instruction;
-        instruction.type = InstructionEnum::CreateString;
-        instruction.offest = stack.MoveOffest(1);
-        instruction.value.intValue = environment.InsertString(type.value);
-        environment.AddInstruction(instruction, type.line);
+        ConstantData constant;
+        constant.type = HeapEnum::String;
+        LoadConstant(constant, type.line, type.value);
     }
     void Visit(Array& type) override {
-        handleList = ExpressionCodeGenerate(stack, environment).Handle(*type.length);
-        Instruction instruction;
-        instruction.type = InstructionEnum::CreateArray;
-        instruction.offest = stack.GetOffest();
-        environment.AddInstruction(instruction, type.line);
+        int32_t length = ExpressionLower(lower, environment).Handle(*type.length);
+        value = lower.AddValue(NewInstruction(IROperation::CreateArray, type.line, { length }));
+    }
+    void Visit(Function& type) override {
+        int8_t parameterCount = static_cast<int8_t>(type.idList.size());
+        if (environment.IsStaticFunction(type.functionBlock)) {
+            IRInstruction staticFunction = NewInstruction(IROperation::StaticFunction, type.line);
+            staticFunction.parameterCount = parameterCount;
+            staticFunction.closureItem = environment.StaticClosureItem(type.functionBlock, optional<wstring>());
+            staticFunction.function = environment.LowerFunction(type.functionBlock, type.functionBlock.closure, type.idList);
+            value = lower.AddValue(std::move(staticFunction));
+            return;
+        }
+        vector<int32_t> closureItem;
+        for (auto& idName : type.functionBlock.closure) {
+            closureItem.push_back(lower.LoadVariable(idName, type.line));
+        }
+        int32_t closure = lower.AddValue(NewInstruction(IROperation::CreateClosure, type.line, std::move(closureItem)));
+        IRInstruction createFunction = NewInstruction(IROperation::CreateFunction, type.line, { closure });
+        createFunction.parameterCount = parameterCount;
+        createFunction.function = environment.LowerFunction(type.functionBlock, type.functionBlock.closure, type.idList);
+        value = lower.AddValue(std::move(createFunction));
     }
-    void Visit(Function& type) override;
     void Visit(Object& type) override {
-        Instruction instruction;
-        instruction.type = InstructionEnum::CreateObject;
-        instruction.offest = stack.MoveOffest(1);
-        environment.AddInstruction(instruction, type.line);
+        value = lower.AddValue(NewInstruction(IROperation::CreateObject, type.line));
     }
 private:
-    vector<function<void()>> handleList;
-    CodeGenerateStack& stack;
-    CodeGenerateEnvironment& environment;
-};
-
-class FunctionBlockCodeGenerate : public AbstractSyntaxVisitor {
-public:
-    FunctionBlockCodeGenerate(CodeGenerateEnvironment& environment) : environment(environment) {}
-    void Handle(FunctionBlock& type, const vector<wstring>& idList);
-private:
-    CodeGenerateStack stack;
-    CodeGenerateEnvironment& environment;
+    FunctionLower& lower;
+    LowerEnvironment& environment;
+    int32_t value;
 };
 
-void ExpressionCodeGenerate::Visit(Function& type) {
-    for (auto& idName : type.functionBlock.closure) {
-        auto data = stack.GetVariableData(idName);
-        Instruction closureItem;
-        if (data.closure) {
-            closureItem.type = InstructionEnum::GetClosureItemByOffest;
-        } else {
-            closureItem.type = InstructionEnum::GetVariableByOffest;
-        }
-        closureItem.offest = stack.MoveOffest(1);
-        closureItem.value.offestOrLength = data.offest;
-        environment.AddInstruction(closureItem, type.line);
-    }
-
-    int16_t closureLength = static_cast<int16_t>(type.functionBlock.closure.size());
-    Instruction createClosure;
-    createClosure.type = InstructionEnum::CreateClosure;
-    createClosure.offest = stack.MoveOffest(1 - closureLength);
-    createClosure.value.offestOrLength = closureLength;
-    environment.AddInstruction(createClosure, type.line);
-
-    Instruction createFunction;
-    createFunction.type = InstructionEnum::Unused;
-    createFunction.offest = stack.GetOffest();
-    createFunction.reserved = static_cast<int8_t>(type.idList.size());
-    int32_t index = environment.AddInstruction(createFunction, type.line);
-
-    auto handle = [&environment = this->environment, &type, index]() {
-        auto createFunction = environment.UpdateInstruction(index);
-        createFunction->type = InstructionEnum::CreateFunction;
-        createFunction->value.intValue = environment.NewInstructionPosition();
-        FunctionBlockCodeGenerate(environment).Handle(type.functionBlock, type.idList);
-    };
-    handleList.push_back(std::move(handle));
-}
-
-class SpecialOperationListCodeGenerate : public AbstractSyntaxVisitor {
+class SpecialOperationListLower : public AbstractSyntaxVisitor {
 public:
-    SpecialOperationListCodeGenerate(CodeGenerateStack& stack, CodeGenerateEnvironment& environment) : stack(stack), environment(environment) {}
-    vector<function<void()>> Handle(SpecialOperationList& type)&& {
+    SpecialOperationListLower(FunctionLower& lower, LowerEnvironment& environment) : lower(lower), environment(environment), value(-1) {}
+    int32_t Handle(SpecialOperationList& type)&& {
         type.Accept(*this);
-        return std::move(handleList);
+        return value;
     }
     void Visit(SpecialOperationList& type) override {
-        auto variable = stack.GetVariableData(type.id);
-        Instruction instruction;
-        if (variable.closure == true) {
-            instruction.type = InstructionEnum::GetClosureItemByOffest;
+        auto& items = type.specialOperations;
+        auto call = items.empty() ? nullptr : dynamic_cast<FunctionCall*>(items[0].get());
+        size_t start = 0;
+        if (call != nullptr && DirectCall(type.id, *call)) {
+            start = 1;
         } else {
-            instruction.type = InstructionEnum::GetVariableByOffest;
+            value = lower.LoadVariable(type.id, type.line);
         }
-        instruction.offest = stack.MoveOffest(1);
-        instruction.value.offestOrLength = variable.offest;
-        environment.AddInstruction(instruction, type.line);
-        for (auto& item : type.specialOperations) {
-            item->Accept(*this);
+        for (size_t i = start; i < items.size(); i++) {
+            items[i]->Accept(*this);
+        }
+    }
+    /*
+        עıغ úָ CallNative
+          CallSelf λú SP PC հһԤ
+        ֱӵʱ false
+    */
+    bool DirectCall(const wstring& idName, FunctionCall& call) {
+        if (environment.IsSelfCall(call) && environment.IsTailCall(call) == false) {
+            vector<int32_t> operands;
+            IRInstruction header = NewInstruction(IROperation::FrameHeader, call.line);
+            header.index = 1;
+            operands.push_back(lower.AddValue(std::move(header)));
+            for (auto& item : call.expressionList) {
+                operands.push_back(ExpressionLower(lower, environment).Handle(*item));
+            }
+            value = lower.AddValue(NewInstruction(IROperation::CallSelf, call.line, std::move(operands)));
+            return true;
+        }
+        auto intrinsic = environment.IntrinsicInstruction(idName);
+        auto native = environment.NativeFunctionIndex(idName);
+        if (intrinsic.has_value() && call.expressionList.size() == 1) {
+            int32_t argument = ExpressionLower(lower, environment).Handle(*call.expressionList[0]);
+            IRInstruction instruction = NewInstruction(IROperation::Intrinsic, call.line, { argument });
+            instruction.intrinsic = intrinsic.value();
+            value = lower.AddValue(std::move(instruction));
+            return true;
+        }
+        if (native.has_value() && call.expressionList.size() <= INT8_MAX) {
+            vector<int32_t> operands;
+            for (auto& item : call.expressionList) {
+                operands.push_back(ExpressionLower(lower, environment).Handle(*item));
+            }
+            IRInstruction callNative = NewInstruction(IROperation::CallNative, call.line, std::move(operands));
+            callNative.index = native.value();
+            value = lower.AddValue(std::move(callNative));
+            return true;
         }
+        return false;
     }
     void Visit(AccessField& type) override {
-        Instruction instruction;
-        instruction.type = InstructionEnum::AccessField;
-        instruction.offest = stack.GetOffest();
-        instruction.value.intValue = environment.InsertString(type.id);
-        environment.AddInstruction(instruction, type.line);
+        IRInstruction loadField = NewInstruction(IROperation::LoadField, type.line, { value });
+        loadField.name = type.id;
+        value = lower.AddValue(std::move(loadField));
     }
     void Visit(AccessArray& type) override {
-        auto resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.index);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-        Instruction instruction;
-        instruction.type = InstructionEnum::AccessArray;
-        instruction.offest = stack.MoveOffest(-1);
-        environment.AddInstruction(instruction, type.line);
+        int32_t index = ExpressionLower(lower, environment).Handle(*type.index);
+        value = lower.AddValue(NewInstruction(IROperation::LoadElement, type.line, { value, index }));
     }
     void Visit(FunctionCall& type) override {
-        for (int i = 0; i < 3; i++) {
-            Instruction instruction;
-            instruction.type = InstructionEnum::GetNull;
-            instruction.offest = stack.MoveOffest(1);
-            environment.AddInstruction(instruction, type.line);
-        }
+        vector<int32_t> operands;
+        operands.push_back(value);
+        operands.push_back(lower.AddValue(NewInstruction(IROperation::FrameHeader, type.line)));
         for (auto& item : type.expressionList) {
-            auto resultList = ExpressionCodeGenerate(stack, environment).Handle(*item);
-            std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
+            operands.push_back(ExpressionLower(lower, environment).Handle(*item));
         }
-        int16_t parameterCount = static_cast<int16_t>(type.expressionList.size());
-        int16_t functionCallPosition = -parameterCount - 3;
-
-        Instruction instruction;
-        instruction.type = InstructionEnum::FunctionCall;
-        instruction.offest = stack.MoveOffest(functionCallPosition);
-        instruction.value.offestOrLength = parameterCount;
-        environment.AddInstruction(instruction, type.line);
+        IRInstruction call = NewInstruction(IROperation::Call, type.line, std::move(operands));
+        call.tail = environment.IsTailCall(type);
+        value = lower.AddValue(std::move(call));
     }
 private:
-    vector<function<void()>> handleList;
-    CodeGenerateStack& stack;
-    CodeGenerateEnvironment& environment;
+    FunctionLower& lower;
+    LowerEnvironment& environment;
+    int32_t value;
 };
 
-void ExpressionCodeGenerate::Visit(SpecialOperationList& type) {
-    handleList = SpecialOperationListCodeGenerate(stack, environment).Handle(type);
+void ExpressionLower::Visit(SpecialOperationList& type) {
+    value = SpecialOperationListLower(lower, environment).Handle(type);
 }
 
-class DefaultBlockCodeGenerate : public AbstractSyntaxVisitor {
+class DefaultBlockLower : public AbstractSyntaxVisitor {
 public:
-    DefaultBlockCodeGenerate(CodeGenerateStack& stack, CodeGenerateEnvironment& environment) : stack(stack), environment(environment) {}
-    vector<function<void()>> Handle(DefaultBlock& type)&& {
+    DefaultBlockLower(FunctionLower& lower, LowerEnvironment& environment) : lower(lower), environment(environment) {}
+    void Handle(DefaultBlock& type)&& {
         type.Accept(*this);
-        return std::move(handleList);
     }
     void Visit(DefaultBlock& type) override;
 private:
-    vector<function<void()>> handleList;
-    CodeGenerateStack& stack;
-    CodeGenerateEnvironment& environment;
+    FunctionLower& lower;
+    LowerEnvironment& environment;
 };
 
-class StatementCodeGenerate : public AbstractSyntaxVisitor {
+class StatementLower : public AbstractSyntaxVisitor {
 public:
-    StatementCodeGenerate(CodeGenerateStack& stack, CodeGenerateEnvironment& environment) : stack(stack), environment(environment) {}
-    vector<function<void()>> Handle(Statement& type) {
+    StatementLower(FunctionLower& lower, LowerEnvironment& environment) : lower(lower), environment(environment) {}
+    void Handle(Statement& type) {
         type.Accept(*this);
-        return std::move(handleList);
     }
     void Visit(StatementDefineVariable& type) override {
-        auto resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.expression);
-        stack.DefineVariable(type.id);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
+        int32_t value = ExpressionLower(lower, environment).Handle(*type.expression);
+        IRInstruction defineLocal = NewInstruction(IROperation::DefineLocal, type.line, { value });
+        defineLocal.index = lower.DefineVariable(type.id);
+        lower.Add(std::move(defineLocal));
     }
-
     void Visit(StatementDefineFunction& type) override {
-        optional<int16_t> selfOffest;
-        int16_t closureItemOffest = 0;
-        for (auto& idName : type.functionBlock.closure) {
-            if (idName == type.id) {
-                Instruction nullType;
-                nullType.type = InstructionEnum::GetNull;
-                nullType.offest = stack.MoveOffest(1);
-                selfOffest = closureItemOffest;
-                environment.AddInstruction(nullType, type.line);
-            } else {
-                auto data = stack.GetVariableData(idName);
-                Instruction closureItem;
-                if (data.closure) {
-                    closureItem.type = InstructionEnum::GetClosureItemByOffest;
+        int8_t parameterCount = static_cast<int8_t>(type.idList.size());
+        int32_t function;
+        if (environment.IsStaticFunction(type.functionBlock)) {
+            IRInstruction staticFunction = NewInstruction(IROperation::StaticFunction, type.line);
+            staticFunction.parameterCount = parameterCount;
+            staticFunction.closureItem = environment.StaticClosureItem(type.functionBlock, type.id);
+            staticFunction.function = environment.LowerFunction(type.functionBlock, type.functionBlock.closure, type.idList);
+            function = lower.AddValue(std::move(staticFunction));
+        } else {
+            // null ռλ ֮ٷհ
+            optional<int32_t> selfIndex;
+            vector<int32_t> closureItem;
+            for (auto& idName : type.functionBlock.closure) {
+                if (idName == type.id) {
+                    selfIndex = static_cast<int32_t>(closureItem.size());
+                    closureItem.push_back(lower.AddValue(NewInstruction(IROperation::Null, type.line)));
                 } else {
-                    closureItem.type = InstructionEnum::GetVariableByOffest;
+                    closureItem.push_back(lower.LoadVariable(idName, type.line));
                 }
-                closureItem.offest = stack.MoveOffest(1);
-                closureItem.value.offestOrLength = data.offest;
-                environment.AddInstruction(closureItem, type.line);
             }
-            closureItemOffest += 1;
-        }
-
-        int16_t closureLength = static_cast<int16_t>(type.functionBlock.closure.size());
-        Instruction createClosure;
-        createClosure.type = InstructionEnum::CreateClosure;
-        createClosure.offest = stack.MoveOffest(1 - closureLength);
-        createClosure.value.offestOrLength = closureLength;
-        environment.AddInstruction(createClosure, type.line);
-
-        Instruction createFunction;
-        createFunction.type = InstructionEnum::Unused;
-        createFunction.reserved = static_cast<int8_t>(type.idList.size());
-        createFunction.offest = stack.GetOffest();
-        int32_t index = environment.AddInstruction(createFunction, type.line);
-
-        if (selfOffest.has_value()) {
-            Instruction addRecursiveFunctionItem;
-            addRecursiveFunctionItem.type = InstructionEnum::AddRecursiveFunctionItem;
-            addRecursiveFunctionItem.offest = stack.GetOffest();
-            addRecursiveFunctionItem.value.offestOrLength = selfOffest.value();
-            environment.AddInstruction(addRecursiveFunctionItem, type.line);
+            int32_t closure = lower.AddValue(NewInstruction(IROperation::CreateClosure, type.line, std::move(closureItem)));
+            IRInstruction createFunction = NewInstruction(IROperation::CreateFunction, type.line, { closure });
+            createFunction.parameterCount = parameterCount;
+            createFunction.function = environment.LowerFunction(type.functionBlock, type.functionBlock.closure, type.idList);
+            function = lower.AddValue(std::move(createFunction));
+            if (selfIndex.has_value()) {
+                IRInstruction recursiveFunctionItem = NewInstruction(IROperation::RecursiveFunctionItem, type.line, { function });
+                recursiveFunctionItem.index = selfIndex.value();
+                lower.Add(std::move(recursiveFunctionItem));
+            }
         }
-
-        stack.DefineVariable(type.id);
-
-        auto handle = [&environment = this->environment, &type, index]() {
-            auto createFunction = environment.UpdateInstruction(index);
-            createFunction->type = InstructionEnum::CreateFunction;
-            createFunction->value.intValue = environment.NewInstructionPosition();
-            FunctionBlockCodeGenerate(environment).Handle(type.functionBlock, type.idList);
-        };
-        handleList.push_back(std::move(handle));
+        IRInstruction defineLocal = NewInstruction(IROperation::DefineLocal, type.line, { function });
+        defineLocal.index = lower.DefineVariable(type.id);
+        lower.Add(std::move(defineLocal));
     }
     void Visit(StatementAssignmentId& type) override {
-        auto resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.expression);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-        auto data = stack.GetVariableData(type.id);
-        Instruction instruction;
-        if (data.closure) {
-            instruction.type = InstructionEnum::SetClosureItemByOffest;
-        } else {
-            instruction.type = InstructionEnum::SetVariableByOffest;
-        }
-        instruction.offest = stack.GetOffest();
-        instruction.value.offestOrLength = data.offest;
-        environment.AddInstruction(instruction, type.line);
+        int32_t value = ExpressionLower(lower, environment).Handle(*type.expression);
+        lower.StoreVariable(type.id, value, type.line);
     }
     void Visit(StatementAssignmentArray& type) override {
-        vector<function<void()>> resultList;
-        resultList = SpecialOperationListCodeGenerate(stack, environment).Handle(*type.specialOperationList);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-
-        resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.index);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-
-        resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.expression);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-
-        Instruction assignmentArray;
-        assignmentArray.type = InstructionEnum::AssignmentArray;
-        assignmentArray.offest = stack.MoveOffest(-2);
-        environment.AddInstruction(assignmentArray, type.line);
+        int32_t array = SpecialOperationListLower(lower, environment).Handle(*type.specialOperationList);
+        int32_t index = ExpressionLower(lower, environment).Handle(*type.index);
+        int32_t value = ExpressionLower(lower, environment).Handle(*type.expression);
+        lower.Add(NewInstruction(IROperation::StoreElement, type.line, { array, index, value }));
     }
     void Visit(StatementAssignmentField& type) override {
-        vector<function<void()>> resultList;
-        resultList = SpecialOperationListCodeGenerate(stack, environment).Handle(*type.specialOperationList);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-
-        resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.expression);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-
-        Instruction assignmentField;
-        assignmentField.type = InstructionEnum::AssignmentField;
-        assignmentField.offest = stack.MoveOffest(-1);
-        assignmentField.value.intValue = environment.InsertString(type.field);
-        environment.AddInstruction(assignmentField, type.line);
+        int32_t object = SpecialOperationListLower(lower, environment).Handle(*type.specialOperationList);
+        int32_t value = ExpressionLower(lower, environment).Handle(*type.expression);
+        IRInstruction storeField = NewInstruction(IROperation::StoreField, type.line, { object, value });
+        storeField.name = type.field;
+        lower.Add(std::move(storeField));
     }
     void Visit(StatementCall& type) override {
-        auto resultList = SpecialOperationListCodeGenerate(stack, environment).Handle(*type.specialOperationList);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-        stack.MoveOffest(-1);
+        int32_t value = SpecialOperationListLower(lower, environment).Handle(*type.specialOperationList);
+        lower.Add(NewInstruction(IROperation::Discard, type.line, { value }));
     }
+    /*
+        cond Branch(ifBlock) -> elseBlock Jump(end) -> ifBlock -> end
+    */
     void Visit(StatementIf& type) override {
-        vector<function<void()>> resultList;
-
-        resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.condition);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-
-        Instruction conditionJump;
-        conditionJump.offest = stack.GetOffest();
-        int32_t conditionJumpIndex = environment.AddInstruction(conditionJump, type.line);
-
-        resultList = DefaultBlockCodeGenerate(stack, environment).Handle(type.elseBlock);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-
-        Instruction jump;
-        jump.offest = stack.GetOffest();
-        int32_t jumpIndex = environment.AddInstruction(jump, type.line);
-
-        auto pConditionJump = environment.UpdateInstruction(conditionJumpIndex);
-        pConditionJump->type = InstructionEnum::ConditionJump;
-        pConditionJump->value.intValue = environment.NewInstructionPosition();
-
-        resultList = DefaultBlockCodeGenerate(stack, environment).Handle(type.ifBlock);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-
-        auto pJump = environment.UpdateInstruction(jumpIndex);
-        pJump->type = InstructionEnum::Jump;
-        pJump->value.intValue = environment.NewInstructionPosition();
-
-    }
+        int32_t condition = ExpressionLower(lower, environment).Handle(*type.condition);
+        int32_t ifBlock = lower.NewBlock();
+        int32_t elseBlock = lower.NewBlock();
+        int32_t endBlock = lower.NewBlock();
+
+        IRInstruction branch = NewInstruction(IROperation::Branch, type.line, { condition });
+        branch.target = ifBlock;
+        branch.next = elseBlock;
+        lower.Add(std::move(branch));
+
+        lower.StartBlock(elseBlock);
+        DefaultBlockLower(lower, environment).Handle(type.elseBlock);
+        IRInstruction jump = NewInstruction(IROperation::Jump, type.line);
+        jump.target = endBlock;
+        lower.Add(std::move(jump));
+
+        lower.StartBlock(ifBlock);
+        DefaultBlockLower(lower, environment).Handle(type.ifBlock);
+        lower.Fallthrough(endBlock, type.line);
+    }
+    /*
+        entry Jump(cond) -> body -> cond Branch(body) -> exit
+        continue ת entry  break ת exit
+    */
     void Visit(StatementWhile& type) override {
-        stack.EnterWhileBlock(environment.NewInstructionPosition());
-
-        Instruction jump;
-        jump.offest = stack.GetOffest();
-
-        int32_t jumpPosition = environment.AddInstruction(jump, type.line);
-        int32_t conditionJumpIndex = environment.NewInstructionPosition();
-
-        vector<function<void()>> resultList;
+        int32_t entryBlock = lower.NewBlock();
+        int32_t bodyBlock = lower.NewBlock();
+        int32_t conditionBlock = lower.NewBlock();
+        int32_t exitBlock = lower.NewBlock();
+
+        lower.Fallthrough(entryBlock, type.line);
+        lower.EnterWhileBlock(entryBlock, exitBlock);
+        IRInstruction jump = NewInstruction(IROperation::Jump, type.line);
+        jump.target = conditionBlock;
+        lower.Add(std::move(jump));
+
+        lower.StartBlock(bodyBlock);
         for (auto& item : type.whileBlock.statements) {
-            resultList = StatementCodeGenerate(stack, environment).Handle(*item);
-            std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
+            StatementLower(lower, environment).Handle(*item);
         }
+        lower.Fallthrough(conditionBlock, type.line);
 
-        auto pJump = environment.UpdateInstruction(jumpPosition);
-        pJump->type = InstructionEnum::Jump;
-        pJump->value.intValue = environment.NewInstructionPosition();
-
-        resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.condition);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
+        int32_t condition = ExpressionLower(lower, environment).Handle(*type.condition);
+        IRInstruction branch = NewInstruction(IROperation::Branch, type.line, { condition });
+        branch.target = bodyBlock;
+        branch.next = exitBlock;
+        lower.Add(std::move(branch));
+        lower.ExitWhileBlock();
 
-        Instruction conditionJump;
-        conditionJump.type = InstructionEnum::ConditionJump;
-        conditionJump.offest = stack.GetOffest();
-        conditionJump.value.intValue = conditionJumpIndex;
-        environment.AddInstruction(conditionJump, type.line);
-
-        stack.ExitWhileBlock(environment.NewInstructionPosition());
+        lower.StartBlock(exitBlock);
     }
     void Visit(StatementBreak& type) override {
-        Instruction jump;
-        jump.type = InstructionEnum::Jump;
-        jump.offest = stack.GetOffest();
-        int32_t index = environment.AddInstruction(jump, type.line);
-        stack.RegistBreak([&environment = this->environment, index](int32_t newPosition) {
-            environment.UpdateInstruction(index)->value.intValue = newPosition;
-        });
+        IRInstruction jump = NewInstruction(IROperation::Jump, type.line);
+        jump.target = lower.GetLoop().exit;
+        lower.Add(std::move(jump));
     }
     void Visit(StatementContinue& type) override {
-        Instruction jump;
-        jump.type = InstructionEnum::Jump;
-        jump.offest = stack.GetOffest();
-        int32_t index = environment.AddInstruction(jump, type.line);
-        stack.RegistContinue([&environment = this->environment, index](int32_t whileBegin) {
-            environment.UpdateInstruction(index)->value.intValue = whileBegin;
-        });
+        IRInstruction jump = NewInstruction(IROperation::Jump, type.line);
+        jump.target = lower.GetLoop().entry;
+        lower.Add(std::move(jump));
     }
     void Visit(StatementReturn& type) override {
-        auto resultList = ExpressionCodeGenerate(stack, environment).Handle(*type.expression);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-        Instruction ret;
-        ret.type = InstructionEnum::Return;
-        ret.offest = stack.GetOffest();
-        environment.AddInstruction(ret, type.line);
+        int32_t value = ExpressionLower(lower, environment).Handle(*type.expression);
+        lower.Add(NewInstruction(IROperation::Return, type.line, { value }));
     }
-
-public:
-    vector<function<void()>> handleList;
-    CodeGenerateStack& stack;
-    CodeGenerateEnvironment& environment;
+private:
+    FunctionLower& lower;
+    LowerEnvironment& environment;
 };
 
-void DefaultBlockCodeGenerate::Visit(DefaultBlock& type) {
-    stack.EnterBlock();
+void DefaultBlockLower::Visit(DefaultBlock& type) {
+    lower.EnterBlock();
     for (auto& item : type.statements) {
-        auto resultList = StatementCodeGenerate(stack, environment).Handle(*item);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
+        StatementLower(lower, environment).Handle(*item);
     }
-    stack.ExitBlock();
+    lower.ExitBlock();
 }
 
-void FunctionBlockCodeGenerate::Handle(FunctionBlock& type, const vector<wstring>& idList) {
-    vector<wstring> closure;
-    std::copy(type.closure.begin(), type.closure.end(), std::back_inserter(closure));
-    stack = CodeGenerateStack(closure, idList);
+int32_t LowerEnvironment::LowerFunction(StatementBlock& type, const set<wstring>& closure, const vector<wstring>& idList) {
+    if (lazy) {
+        return AddPendingFunction(type, closure, idList);
+    }
+    int32_t index = static_cast<int32_t>(module.functions.size());
+    module.functions.push_back(IRFunction());
+    module.functions[index] = LowerFunctionBody(type, closure, idList);
+    return index;
+}
 
-    vector<function<void()>> handleList;
+IRFunction LowerEnvironment::LowerFunctionBody(StatementBlock& type, const set<wstring>& closure, const vector<wstring>& idList) {
+    vector<wstring> closureList;
+    std::copy(closure.begin(), closure.end(), std::back_inserter(closureList));
+    FunctionLower lower(closureList, idList);
     for (auto& item : type.statements) {
-        auto resultList = StatementCodeGenerate(stack, environment).Handle(*item);
-        std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-    }
-    for (auto& handle : handleList) {
-        handle();
+        StatementLower(lower, *this).Handle(*item);
     }
+    return std::move(lower.function);
 }
 
-class MainBlockCodeGenerate : public AbstractSyntaxVisitor {
-public:
-    CodeGenerateEnvironment Handle(MainBlock& type, const RegisteredNameList& nameList)&& {
-        vector<wstring> closure;
-        std::copy(type.closure.begin(), type.closure.end(), std::back_inserter(closure));
-        stack = CodeGenerateStack(closure, vector<wstring>());
+int32_t LowerEnvironment::AddPendingFunction(StatementBlock& type, const set<wstring>& closure, const vector<wstring>& idList) {
+    auto find = functionIndex.find(&type);
+    if (find != functionIndex.end()) {
+        return find->second;
+    }
+    int32_t index = static_cast<int32_t>(module.functions.size());
+    IRFunction function;
+    function.pending = true;
+    function.parameterCount = static_cast<int8_t>(idList.size());
+    module.functions.push_back(std::move(function));
+    functionIndex.insert(pair(&type, index));
+    pendingFunction.insert(pair(index, LowerPendingFunction{ &type, &closure, &idList }));
+    return index;
+}
 
-        //closure Ǽ  registered 
-        //ܻᵼ˳ͬ
-        vector<int> mainClosureOffest;
-        for (auto& closureItem : closure) {
-            for (int i = 0; i < nameList.registeredNames.size(); i++) {
-                if (closureItem == nameList.registeredNames[i]) {
-                    mainClosureOffest.push_back(i);
-                    break;
-                }
-            }
+void LowerEnvironment::LowerPendingFunctionBody(int32_t index) {
+    auto find = pendingFunction.find(index);
+    if (find == pendingFunction.end()) {
+        throw CompilerError();
+    }
+    LowerPendingFunction pending = find->second;
+    pendingFunction.erase(find);
+    auto functionBlock = dynamic_cast<FunctionBlock*>(pending.block);
+    if (functionBlock != nullptr && functionBlock->preParsed != nullptr) {
+        if (!preParsedProcess) {
+            throw CompilerError();
+        }
+        preParsedProcess(*functionBlock, *pending.idList);
+    }
+    module.functions[index] = LowerFunctionBody(*pending.block, *pending.closure, *pending.idList);
+}
 
+//closure Ǽ  registered
+//ܻᵼ˳ͬ
+void LowerMainClosure(LowerEnvironment& environment, const RegisteredNameList& nameList, MainBlock& root) {
+    std::copy(root.closure.begin(), root.closure.end(), std::back_inserter(environment.mainClosure));
+    for (auto& closureItem : environment.mainClosure) {
+        for (int i = 0; i < nameList.registeredNames.size(); i++) {
+            if (closureItem == nameList.registeredNames[i]) {
+                environment.module.mainClosureOffest.push_back(i);
+                break;
+            }
         }
-        environment.RegistMainClosureOffest(std::move(mainClosureOffest));
+    }
+    environment.module.registeredNames = nameList.registeredNames;
+}
 
+IRModule CreateIntermediateRepresentation(const RegisteredNameList& nameList, AbstractSyntaxTreeTransform& abstractSyntaxTree, const LowerOptions& options) {
+    MainBlock& root = abstractSyntaxTree.root;
+    LowerEnvironment environment(options);
+    LowerMainClosure(environment, nameList, root);
+    environment.LowerFunction(root, root.closure, vector<wstring>());
+    return std::move(environment.module);
+}
 
-        vector<function<void()>> handleList;
-        for (auto& item : type.statements) {
-            auto resultList = StatementCodeGenerate(stack, environment).Handle(*item);
-            std::move(resultList.begin(), resultList.end(), std::back_inserter(handleList));
-        }
-        for (auto& handle : handleList) {
-            handle();
-        }
-        return std::move(environment);
+VMRuntimeData CreateVMRuntimeData(const RegisteredNameList& nameList, AbstractSyntaxTreeTransform&& abstractSyntaxTree) {
+    LowerOptions options;
+    options.immediate = true;
+    options.typeInference = TypeInference(abstractSyntaxTree.root);
+    options.tailCalls = TailCallAnalysis(abstractSyntaxTree.root);
+    options.staticFunctionBlocks = StaticFunctionAnalysis(abstractSyntaxTree.root);
+    return IREmit(CreateIntermediateRepresentation(nameList, abstractSyntaxTree, options));
+}
+
+/*
+    ӳʱԤȼе ʼ֮زٸı
+*/
+class LazyConstantProcess : public AbstractSyntaxVisitor {
+public:
+    LazyConstantProcess(IRLazyEmit& emit) : emit(emit) {}
+    void Handle(Expression& type) {
+        type.Accept(*this);
+    }
+    void VisitExpression(Expression& type) override {}
+    void VisitUnaryOperation(UnaryOperation& type) override {}
+    void VisitBinaryOperation(BinaryOperation& type) override {}
+    void Visit(Char& type) override {
+        ConstantData constant;
+        constant.type = HeapEnum::Char;
+        constant.value.word = type.value;
+        emit.AddConstant(constant, wstring());
+    }
+    void Visit(Int& type) override {
+        ConstantData constant;
+        constant.type = HeapEnum::Int;
+        constant.value.intValue = type.value;
+        emit.AddConstant(constant, wstring());
+    }
+    void Visit(Float& type) override {
+        ConstantData constant;
+        constant.type = HeapEnum::Float;
+        constant.value.floatValue = type.value;
+        emit.AddConstant(constant, wstring());
+    }
+    void Visit(String& type) override {
+        ConstantData constant;
+        constant.type = HeapEnum::String;
+        emit.AddConstant(constant, type.value);
     }
 private:
-    CodeGenerateStack stack;
-    CodeGenerateEnvironment environment;
+    IRLazyEmit& emit;
 };
 
-VMRuntimeData CreateVMRuntimeData(const RegisteredNameList& nameList, AbstractSyntaxTreeTransform&& abstractSyntaxTree) {
-    CodeGenerateEnvironment environment = MainBlockCodeGenerate().Handle(abstractSyntaxTree.root, nameList);
-    VMRuntimeData data;
-    data.registeredNames = nameList.registeredNames;
-    data.instruction = std::move(environment.instructions);
-    data.instructionLine = std::move(environment.instructionLines);
-    data.staticString = std::move(environment.strings);
-    data.mainClosureOffest = std::move(environment.mainClosureOffest);
-    data.stringMap = std::move(environment.stringMap);
-    return std::move(data);
+/*
+    ӳʱһֱ е lazyCompile 
+*/
+struct LazyCompileState {
+    LazyCompileState(AbstractSyntaxTreeTransform&& abstractSyntaxTree, LowerOptions&& options)
+        : abstractSyntaxTree(std::move(abstractSyntaxTree)), options(std::move(options)), environment(this->options), emit(environment.module) {}
+    AbstractSyntaxTreeTransform abstractSyntaxTree;
+    LowerOptions options;
+    LowerEnvironment environment;
+    IRLazyEmit emit;
+};
+
+VMRuntimeData CreateLazyVMRuntimeData(const RegisteredNameList& nameList, AbstractSyntaxTreeTransform&& abstractSyntaxTree, LowerOptions options,
+    PreParsedFunctionProcess preParsedProcess) {
+    auto state = std::make_shared<LazyCompileState>(std::move(abstractSyntaxTree), std::move(options));
+    MainBlock& root = state->abstractSyntaxTree.root;
+    LowerEnvironment& environment = state->environment;
+    LowerMainClosure(environment, nameList, root);
+    environment.lazy = true;
+    if (preParsedProcess) {
+        //state  environment ﲻٳ state
+        environment.preParsedProcess = [process = std::move(preParsedProcess), &options = state->options](FunctionBlock& type, const vector<wstring>& idList) {
+            process(type, idList, options);
+        };
+    }
+    environment.module.functions.push_back(IRFunction());
+
+    //Ԥȷĺͳʼʱ Ҫ֮ǰȫ
+    LazyConstantProcess constant(state->emit);
+    AllFunctionProcess(root, [&](FunctionBlock& item, const vector<wstring>& idList, optional<wstring> name) {
+        if (environment.IsStaticFunction(item)) {
+            int32_t function = environment.AddPendingFunction(item, item.closure, idList);
+            state->emit.AddStaticFunction(function, static_cast<int8_t>(idList.size()), environment.StaticClosureItem(item, name));
+        }
+    }, [&](Expression& item) {
+        constant.Handle(item);
+    });
+
+    environment.module.functions[0] = environment.LowerFunctionBody(root, root.closure, vector<wstring>());
+    VMRuntimeData data = state->emit.EmitMain();
+    data.lazyCompile = [state](int32_t function, int32_t programPosition) {
+        state->environment.LowerPendingFunctionBody(function);
+        return state->emit.EmitFunction(function, programPosition);
+    };
+    return data;
 }
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 #include"AbstractSyntaxType.h"
 #include"CodeGenerate.h"
+#include"IntermediateRepresentation.h"
+#include"TypeInference.h"
 #include<map>
+#include<set>
 using std::pair;
 using std::map;
+using std::set;
 using AbstractSyntax::AbstractSyntaxType;
 
 struct AbstractSyntaxTree;
@@ -13,7 +17,42 @@ struct VMRuntimeData;
 
 VMRuntimeData CreateVMRuntimeData(const RegisteredNameList& nameList, AbstractSyntaxTreeTransform&& abstractSyntaxTree);
 
+/*
+    мʾʱʹõŻ ɱ pass д ûе pass ӦĽΪ
+    immediate            ҲΪ Int Float ʱʹָ
+    typeInference        ѡ AddInt AddFloat רָ
+    tailCalls             TailCall
+    selfCalls            βʱ CallSelf
+    staticFunctionBlocks  LoadStaticFunction
+    nativeFunctions      ʱ CallNative
+    intrinsicFunctions   ֻһĵúָ
+*/
+struct LowerOptions {
+    bool immediate = false;
+    TypeInferenceResult typeInference;
+    set<const AbstractSyntax::FunctionCall*> tailCalls;
+    set<const AbstractSyntax::FunctionCall*> selfCalls;
+    set<const AbstractSyntax::FunctionBlock*> staticFunctionBlocks;
+    set<wstring> nativeFunctions;
+    map<wstring, InstructionEnum> intrinsicFunctions;
+};
+
+//мʾ CreateVMRuntimeData ʹȫŻ мʾֽ
+IRModule CreateIntermediateRepresentation(const RegisteredNameList& nameList, AbstractSyntaxTreeTransform& abstractSyntaxTree, const LowerOptions& options);
+
+//Ԥĺһɴ֮ǰ 岢Ϊд LowerOptions
+using PreParsedFunctionProcess = function<void(AbstractSyntax::FunctionBlock&, const vector<wstring>&, LowerOptions&)>;
+
+/*
+    ӳ ֻ ڵһεʱ ﷨ɷֵе lazyCompile 
+    ﷨Ԥĺʱ Ҫ preParsedProcess
+*/
+VMRuntimeData CreateLazyVMRuntimeData(const RegisteredNameList& nameList, AbstractSyntaxTreeTransform&& abstractSyntaxTree, LowerOptions options,
+    PreParsedFunctionProcess preParsedProcess = nullptr);
+
 AbstractSyntaxTreeTransform SemanticAnalysis(const RegisteredNameList& nameList, AbstractSyntaxTree&& abstractSyntaxTree);
+//Ԥĺ֮ еĺȻֻԤ
+void SemanticAnalysisPreParsedFunction(AbstractSyntax::FunctionBlock& type, const vector<wstring>& idList);
 
 struct RegisteredNameList {
     inline RegisteredNameList(vector<wstring> registeredNames) : registeredNames(std::move(registeredNames)) {}
@@ -54,6 +54,7 @@
 	BinaryOperation  -> Modulus
 
 */
+#include "ParseType.h"
 #include <memory>
 #include <vector>
 #include <string>
@@ -93,9 +94,19 @@ namespace AbstractSyntax {
 		virtual void Accept(AbstractSyntaxVisitor& visitor);
 		set<wstring> closure;
 	};
+	/*
+		Ԥĺ һɴ֮ǰŽ﷨ ɳ﷨
+		tokens Ϊ { ... } еս names Ϊгֵ ( . ֶ֮) ڼհ
+	*/
+	struct PreParsedBlock {
+		vector<unique_ptr<Parse::LAType>> tokens;
+		set<wstring> names;
+	};
+	//preParsed Ϊʱδ statements Ϊ
 	struct FunctionBlock : public StatementBlock {
 		virtual void Accept(AbstractSyntaxVisitor& visitor);
 		set<wstring> closure;
+		unique_ptr<PreParsedBlock> preParsed;
 	};
 	struct DefaultBlock : public StatementBlock {
 		virtual void Accept(AbstractSyntaxVisitor& visitor);
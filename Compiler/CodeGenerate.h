@@ -3,9 +3,11 @@
 #include<vector>
 #include<string>
 #include<map>
+#include<functional>
 using std::map;
 using std::vector;
 using std::wstring;
+using std::function;
 
 
 
@@ -15,12 +17,16 @@ using std::wstring;
     Null  heap[0]
     False heap[1]
     True  heap[2]
+
+    ͳһ볣 ʼʱڶ 
+    LoadConstant ֱȡеĶλ ٷڴ
 */
 enum class InstructionEnum : int8_t {
     Unused = 0,
     GetNull,
     GetFalse,
     GetTrue,
+    LoadConstant,
     CreateChar,
     CreateInt,
     CreateFloat,
@@ -30,6 +36,8 @@ enum class InstructionEnum : int8_t {
     CreateClosure,
     CreateFunction,
     AddRecursiveFunctionItem, //ڵݹ麯ʱʹ
+    LoadStaticFunction, //Ԥȷĺ ֱȡеλ
+    CompileFunction, //ӳɵĺ һεʱ ֮滻Ϊ Jump
 
     GetVariableByOffest,
     SetVariableByOffest,
@@ -42,6 +50,16 @@ enum class InstructionEnum : int8_t {
     AssignmentArray,
     AssignmentField,
     FunctionCall,
+    TailCall,
+    CallNative, //ֱӵñغ հ LocalFunction
+    CallSelf, // ʹõǰջ֡ıհ ȡ
+
+    //ú ͬıغ λջ 
+    ArrayLength,
+    ObjectFieldCount,
+    TypeOf, //Ϊ HeapEnum ֵ
+    CharToInt,
+    IntToChar,
 
     Jump,
     ConditionJump,
@@ -62,6 +80,40 @@ enum class InstructionEnum : int8_t {
     And,
 
     Not,
+
+    //ҲΪ Ҫڶз reserved 
+    MultiplyImmediate,
+    DivideImmediate,
+    ModulusImmediate,
+    AddImmediate,
+    SubtractImmediate,
+    LessImmediate,
+    LessEqualsImmediate,
+    GreaterImmediate,
+    GreaterEqualsImmediate,
+    EqualsImmediate,
+    NotEqualsImmediate,
+
+    //ƵѾ֤Ҳ ҪʱͲ
+    MultiplyInt,
+    DivideInt,
+    ModulusInt,
+    AddInt,
+    SubtractInt,
+    LessInt,
+    LessEqualsInt,
+    GreaterInt,
+    GreaterEqualsInt,
+
+    MultiplyFloat,
+    DivideFloat,
+    ModulusFloat,
+    AddFloat,
+    SubtractFloat,
+    LessFloat,
+    LessEqualsFloat,
+    GreaterFloat,
+    GreaterEqualsFloat,
 };
 /*
     [-----64-----]
@@ -80,6 +132,7 @@ enum class InstructionEnum : int8_t {
     GetNull                                             intValue (0)
     GetFalse                                            intValue (1)
     GetTrue                                             intValue (2)
+    LoadConstant                                        intValue(index)
     CreateChar                                          word
     CreateInt                                           intValue
     CreateFloat                                         floatValue
@@ -89,6 +142,8 @@ enum class InstructionEnum : int8_t {
     CreateClosure                                       offestOrLength
     CreateFunction    parameterCount                    intValue(position)    Closure
     AddRecursiveFunctionItem                            offestOrLength        Function
+    LoadStaticFunction                                  intValue(index)
+    CompileFunction                                     intValue(function)
 
     GetVariableByOffest                                 offestOrLength
     SetVariableByOffest                                 offestOrLength
@@ -100,7 +155,16 @@ enum class InstructionEnum : int8_t {
     AccessField                                         intValue(index)       Object
     AssignmentArray                                                           Array               Expression(index)   Expression
     AssignmentField                                     intValue(index)       Object              Expression
-    FunctionCall                                        offestOrLength        Function            Null                Null            Null       parameter.....
+    FunctionCall                                        offestOrLength        Function            (Ԥ)              (Ԥ)          (Ԥ)     parameter.....
+    TailCall                                            offestOrLength        Function            (Ԥ)              (Ԥ)          (Ԥ)     parameter.....
+    CallNative        parameterCount                    intValue(index)       parameter.....
+    CallSelf          parameterCount                    intValue(position)    (Ԥ)              (Ԥ)              (Ԥ)          (Ԥ)     parameter.....
+
+    ArrayLength                                                               Array
+    ObjectFieldCount                                                          Object
+    TypeOf                                                                    Expression
+    CharToInt                                                                 Char
+    IntToChar                                                                 Int
 
     Jump                                                intValue(position)
     ConditionJump                                       intValue(position)    Expression
@@ -108,6 +172,10 @@ enum class InstructionEnum : int8_t {
 
     BinaryOperation                                                           Expression          Expression
     UnaryOperation                                                            Expression
+
+    BinaryOperationImmediate  HeapEnum(Int Float)       intValue floatValue   Expression
+    BinaryOperationInt                                                        Expression(Int)     Expression(Int)
+    BinaryOperationFloat                                                      Expression(Float)   Expression(Float)
 */
 struct Instruction {
     InstructionEnum type = InstructionEnum::Unused;
@@ -139,6 +207,9 @@ enum class HeapEnum : int8_t {
     Closure,
     Function,
     LocalFunction,
+    ObjectHashTable,
+    Map,
+    MapTable,
 };
 
 /*
@@ -172,7 +243,10 @@ struct StringLengthOrIndex {
 
     word    string   洢 ַ
     length  function 洢   հ
-    length  object   洢   
+    length  ObjectFieldList 洢 ֶθ Ϊ memoryLength - 2
+    length  ObjectHashTable 洢 ֶθ  (2 ) Ϊ (memoryLength - 2) / 2
+    length  MapTable 洢 ĸ  (2 ) Ϊ (memoryLength - 3) / 3 used Ϊĸɾλ
+    String  hash Ϊ 0 ʱδ һΪ Map ļʱ
     length  array    洢 鳤 (ڶ 0)
 
     type              reserved              memoryLength               value
@@ -183,13 +257,17 @@ struct StringLengthOrIndex {
     Char                                         2                     word
     Int                                          2                     intValue
     Float                                        2                     floatValue
-    String                                       2                     intValue(index)
+    String                                       3                     lengthOrIndex(Index)     intValue(hash)
+    String                             3 + (length + 1) / 2            lengthOrIndex(Length)    intValue(hash)           word......
     Array                                    2 + length                length                   intValue(heapPosition)......
-    Object                                       2                     intValue(heapPosition)
-    ObjectFieldList                          2 + length                length                   [ intValue(index)   intValue(heapPosition) ]........
+    Object                                       3                     intValue(heapPosition)   intValue(shape)
+    ObjectFieldList                          2 + capacity              length                   intValue(heapPosition)......  (λɶ״)
     Closure                                  2 + length                length                   intValue(heapPosition)......
     Function                                     4                     length(parameterCount)   intValue(heapPosition)   intValue(grogramPosition)
     LocalFunction                                2                     intValue(localList)
+    ObjectHashTable                        2 + capacity * 2            length                   (intValue(index) intValue(heapPosition))......  (Ѱַ λ index Ϊ -1)
+    Map                                          2                     intValue(heapPosition)
+    MapTable                               3 + capacity * 3            length                   intValue(used)           (intValue(hash) intValue(key) intValue(value))......  (λ key Ϊ -1 ɾΪ -2)
 */
 struct HeapType {
     union {
@@ -206,6 +284,7 @@ struct HeapType {
     [  32  ]
 
      ָѵָ  SP PC
+    ǰԤ SP PC հλÿֵ ָֻͷֵָ
 
 
      ѹջʽ:
@@ -216,9 +295,9 @@ struct HeapType {
      [ parameter 3  ]
      [ parameter 2  ]
      [ parameter 1  ]
-     [     Null     ]  ѹջΪNull
-     [     Null     ]  ѹջΪNull
-     [     Null     ]  ѹջΪNull
+     [   (Ԥ)     ]  ֻƶƫ ָ ֮ǰµֵ
+     [   (Ԥ)     ]  ֻƶƫ ָ ֮ǰµֵ
+     [   (Ԥ)     ]  ֻƶƫ ָ ֮ǰµֵ
      [   Function1  ]
      [     var3     ]
      [     var2     ]
@@ -254,11 +333,58 @@ struct StackType {
     int32_t intValue = 0;
 };
 
+/*
+    еһ ɴռ VirtualMachineInit ʱɶӦĶڴ
+
+    type              value
+    Char              word
+    Int               intValue
+    Float             floatValue
+    String            intValue(index)
+*/
+struct ConstantData {
+    HeapEnum type = HeapEnum::Nothing;
+    union {
+        wchar_t word;
+        int32_t intValue = 0;
+        float floatValue;
+    } value;
+};
+
+/*
+    Ԥȷĺ VirtualMachineInit ʱյ Closure  Function
+    closureItem ΪհÿһԴ -1 ʾ Ϊհ (ע) еλ
+*/
+struct StaticFunctionData {
+    int32_t programPosition = 0;
+    int8_t parameterCount = 0;
+    vector<int16_t> closureItem;
+};
+/*
+    ӳɵһ  programPosition ʼλ
+    staticString      ¼ַ (Žеַ֮)
+    createFunction    ָú CreateFunction λ Ϊָɵĺ
+    staticFunction    úԤȷĺʱ  staticFunction еλ Ϊ -1
+*/
+struct LazyCompileResult {
+    vector<Instruction> instruction;
+    vector<int> instructionLine;
+    vector<wstring> staticString;
+    vector<int32_t> createFunction;
+    int32_t staticFunction = -1;
+};
+
+/*
+    lazyCompile Ϊʱ ڵһεʱ Ϊ ͺ忪ʼλ
+*/
 struct VMRuntimeData {
     vector<Instruction> instruction;
+    vector<ConstantData> constantPool;
     vector<wstring> registeredNames;
     vector<wstring> staticString;
     vector<int> mainClosureOffest;
     vector<int> instructionLine;
     map<wstring, int32_t> stringMap;
+    vector<StaticFunctionData> staticFunction;
+    function<LazyCompileResult(int32_t, int32_t)> lazyCompile;
 };
\ No newline at end of file
@@ -1,17 +1,208 @@
 #include "Complie.h"
+#include "CompilerException.h"
+#include <chrono>
 CompileData::CompileData()
     : dfa(CreateDefaultDFA()),
     table(CreateDefaultPredictiveParsingTable()),
-    generateMap(CreateDefaultGenerateSATypeFunctionMap()) {}
-
-VMRuntimeData GenerateVMRuntimeData(const wstring& text, const CompileData& data, const vector<wstring>& registeredNames) {
-    auto la = LexicalAnalysis(data.dfa, text);
-    auto la2 = LexicalAnalysisResultRemoveBlank(std::move(la));
-    auto pt = CreateParseTree(data.table, data.generateMap, std::move(la2));
-    auto namelist = CreateRegisteredNameList(data.dfa, registeredNames);
-    auto ast = CreateAbstractSyntaxTree(pt);
-    auto result = SemanticAnalysis(namelist, std::move(ast));
+    generateMap(CreateDefaultGenerateSATypeFunctionMap()),
+    passes(CreateDefaultPassList()) {}
+
+vector<CompilePass> CreateDefaultPassList() {
+    using AbstractSyntax::MainBlock;
+    using AbstractSyntax::FunctionBlock;
+    vector<CompilePass> passes;
+    passes.push_back({ "closure-capture", OptimizeLevel::O1, [](MainBlock& root, LowerOptions&) {
+        ClosureCaptureAnalysis(root);
+    } });
+    passes.push_back({ "inline", OptimizeLevel::O2, [](MainBlock& root, LowerOptions&) {
+        FunctionInline(root);
+    } });
+    passes.push_back({ "scalar-replacement", OptimizeLevel::O2, [](MainBlock& root, LowerOptions&) {
+        ScalarReplacement(root);
+    } });
+    passes.push_back({ "cse", OptimizeLevel::O2, [](MainBlock& root, LowerOptions&) {
+        CommonSubexpressionElimination(root);
+    } });
+    passes.push_back({ "licm", OptimizeLevel::O2, [](MainBlock& root, LowerOptions&) {
+        LoopInvariantCodeMotion(root);
+    } });
+    //ķ﷨ٸı֮ ڴ
+    passes.push_back({ "type-inference", OptimizeLevel::O1, [](MainBlock& root, LowerOptions& options) {
+        options.typeInference = TypeInference(root);
+    }, [](FunctionBlock& type, const vector<wstring>& idList, LowerOptions& options) {
+        TypeInferenceFunction(type, idList, options.typeInference);
+    } });
+    passes.push_back({ "tail-call", OptimizeLevel::O1, [](MainBlock& root, LowerOptions& options) {
+        options.tailCalls = TailCallAnalysis(root);
+    }, [](FunctionBlock& type, const vector<wstring>& idList, LowerOptions& options) {
+        TailCallAnalysisFunction(type, idList, options.tailCalls);
+    } });
+    passes.push_back({ "self-call", OptimizeLevel::O1, [](MainBlock& root, LowerOptions& options) {
+        options.selfCalls = SelfCallAnalysis(root);
+    } });
+    passes.push_back({ "static-function", OptimizeLevel::O1, [](MainBlock& root, LowerOptions& options) {
+        options.staticFunctionBlocks = StaticFunctionAnalysis(root);
+    } });
+    passes.push_back({ "native-call", OptimizeLevel::O1, [](MainBlock& root, LowerOptions& options) {
+        options.nativeFunctions = NativeFunctionAnalysis(root);
+    } });
+    passes.push_back({ "intrinsic", OptimizeLevel::O1, [](MainBlock& root, LowerOptions& options) {
+        options.intrinsicFunctions = IntrinsicAnalysis(root);
+    } });
+    passes.push_back({ "immediate", OptimizeLevel::O1, [](MainBlock& root, LowerOptions& options) {
+        options.immediate = true;
+    }, [](FunctionBlock& type, const vector<wstring>& idList, LowerOptions& options) {} });
+    passes.push_back({ "layout", OptimizeLevel::O2, nullptr, nullptr, [](IRModule& module, const CompileOptions& options) {
+        IRLayout(module, options.profile.get());
+    } });
+    return passes;
+}
+
+CompileOptions ParseCompileOptions(const vector<string>& arguments, const vector<CompilePass>& passes) {
+    auto checkName = [&](const string& name) {
+        for (auto& pass : passes) {
+            if (pass.name == name) {
+                return name;
+            }
+        }
+        throw ConfigurationException("ڵ pass : " + name);
+    };
+    CompileOptions options;
+    for (auto& argument : arguments) {
+        if (argument == "-O0") {
+            options.level = OptimizeLevel::O0;
+        } else if (argument == "-O1") {
+            options.level = OptimizeLevel::O1;
+        } else if (argument == "-O2") {
+            options.level = OptimizeLevel::O2;
+        } else if (argument == "-verify") {
+            options.verify = true;
+        } else if (argument == "-lazy") {
+            options.lazy = true;
+        } else if (argument == "-preparse") {
+            options.lazy = true;
+            options.preParse = true;
+        } else if (argument.rfind("-enable=", 0) == 0) {
+            options.enablePasses.insert(checkName(argument.substr(8)));
+        } else if (argument.rfind("-disable=", 0) == 0) {
+            options.disablePasses.insert(checkName(argument.substr(9)));
+        } else {
+            throw ConfigurationException("ڵıѡ : " + argument);
+        }
+    }
+    return options;
+}
+
+static bool PassEnabled(const CompilePass& pass, const CompileOptions& options) {
+    if (options.disablePasses.find(pass.name) != options.disablePasses.end()) {
+        return false;
+    }
+    if (options.enablePasses.find(pass.name) != options.enablePasses.end()) {
+        return true;
+    }
+    return pass.level <= options.level;
+}
+
+/*
+    ¼ action ĺʱ passTime Ϊ nullptr ʱ¼
+*/
+template<typename Action>
+static auto Measure(vector<PassTime>* passTime, const string& name, Action&& action) {
+    auto start = std::chrono::steady_clock::now();
+    auto record = [&]() {
+        if (passTime != nullptr) {
+            std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+            passTime->push_back({ name, duration.count() });
+        }
+    };
+    if constexpr (std::is_void_v<decltype(action())>) {
+        action();
+        record();
+    } else {
+        auto result = action();
+        record();
+        return result;
+    }
+}
+
+/*
+    ʷ ﷨  Ȼõ pass
+    preParse Ϊ true ʱֻԤ ֻ runFunction  pass
+*/
+static std::pair<AbstractSyntaxTreeTransform, LowerOptions> GenerateAbstractSyntaxTree(const wstring& text, const CompileData& data,
+    const vector<wstring>& registeredNames, vector<PassTime>* passTime, bool preParse) {
+    auto la = Measure(passTime, "lexical-analysis", [&]() {
+        return LexicalAnalysisResultRemoveBlank(LexicalAnalysis(data.dfa, text));
+    });
+    auto pt = Measure(passTime, preParse ? "pre-parse" : "parse", [&]() {
+        return CreateParseTree(data.table, data.generateMap, std::move(la), preParse);
+    });
+    auto result = Measure(passTime, "semantic-analysis", [&]() {
+        auto namelist = CreateRegisteredNameList(data.dfa, registeredNames);
+        auto ast = CreateAbstractSyntaxTree(pt);
+        return SemanticAnalysis(namelist, std::move(ast));
+    });
+    LowerOptions lowerOptions;
+    for (auto& pass : data.passes) {
+        if (PassEnabled(pass, data.options) && pass.run && (preParse == false || pass.runFunction)) {
+            Measure(passTime, pass.name, [&]() {
+                pass.run(result.root, lowerOptions);
+            });
+        }
+    }
+    return std::pair(std::move(result), std::move(lowerOptions));
+}
+
+IRModule GenerateIntermediateRepresentation(const wstring& text, const CompileData& data, const vector<wstring>& registeredNames,
+    vector<PassTime>* passTime) {
+    auto tree = GenerateAbstractSyntaxTree(text, data, registeredNames, passTime, false);
     auto registeredNameList = RegisteredNameList(registeredNames);
-    return CreateVMRuntimeData(registeredNameList, std::move(result));
+    auto module = Measure(passTime, "lower", [&]() {
+        return CreateIntermediateRepresentation(registeredNameList, tree.first, tree.second);
+    });
+    for (auto& pass : data.passes) {
+        if (PassEnabled(pass, data.options) && pass.runModule) {
+            Measure(passTime, pass.name, [&]() {
+                pass.runModule(module, data.options);
+            });
+        }
+    }
+    if (data.options.verify) {
+        Measure(passTime, "verify", [&]() {
+            IRVerify(module);
+        });
+    }
+    return module;
+}
+
+VMRuntimeData GenerateVMRuntimeData(const wstring& text, const CompileData& data, const vector<wstring>& registeredNames,
+    vector<PassTime>* passTime) {
+    if (data.options.lazy) {
+        auto tree = GenerateAbstractSyntaxTree(text, data, registeredNames, passTime, data.options.preParse);
+        auto registeredNameList = RegisteredNameList(registeredNames);
+        PreParsedFunctionProcess preParsedProcess;
+        if (data.options.preParse) {
+            vector<const CompilePass*> passes;
+            for (auto& pass : data.passes) {
+                if (PassEnabled(pass, data.options) && pass.runFunction) {
+                    passes.push_back(&pass);
+                }
+            }
+            preParsedProcess = [&data, passes](AbstractSyntax::FunctionBlock& type, const vector<wstring>& idList, LowerOptions& options) {
+                CreatePreParsedFunctionBlock(data.table, data.generateMap, type);
+                SemanticAnalysisPreParsedFunction(type, idList);
+                for (auto pass : passes) {
+                    pass->runFunction(type, idList, options);
+                }
+            };
+        }
+        return Measure(passTime, "lazy-emit", [&]() {
+            return CreateLazyVMRuntimeData(registeredNameList, std::move(tree.first), std::move(tree.second), std::move(preParsedProcess));
+        });
+    }
+    auto module = GenerateIntermediateRepresentation(text, data, registeredNames, passTime);
+    return Measure(passTime, "emit", [&]() {
+        return IREmit(module);
+    });
 }
 
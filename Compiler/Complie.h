@@ -1,12 +1,86 @@
 #pragma once
 #include "Parse.h"
 #include "CodeGenerate.h"
+#include "Optimize.h"
+#include <functional>
+#include <memory>
+using std::function;
+using std::shared_ptr;
+
+/*
+    Ż ʱٵ
+    O0 Ż
+    O1 еŻ ( רָ β Ԥȷĺ) ͱհ
+    O2 ȫŻ
+    нͬ ΨһĲ static-function: ͬһʽֵõͬһ
+     == ȽǵĽΪ true  O0 Ԥʱÿֵµĺ Ϊ false
+*/
+enum class OptimizeLevel : int8_t {
+    O0,
+    O1,
+    O2,
+};
+
+/*
+    ˳е pass
+    ﷨ϵ pass ֱ޸﷨ ʹõķѽд LowerOptions
+    level ΪĬø pass ͼ
+    runFunction ֻһ Ԥĺ֮ Ϊյ pass Ҫ Ԥʱ
+    runModule תΪмʾ֮ (run Ϊ) ӳʱ
+*/
+struct CompileOptions;
+
+struct CompilePass {
+    string name;
+    OptimizeLevel level;
+    function<void(AbstractSyntax::MainBlock&, LowerOptions&)> run;
+    function<void(AbstractSyntax::FunctionBlock&, const vector<wstring>&, LowerOptions&)> runFunction;
+    function<void(IRModule&, const CompileOptions&)> runModule;
+};
+
+vector<CompilePass> CreateDefaultPassList();
+
+/*
+    enablePasses disablePasses ڼĻϴ򿪻߹ر pass
+    verify Ϊ true ʱɵмʾ
+    lazy Ϊ true ʱ GenerateVMRuntimeData ֻ ڵһεʱ (мʾ)
+    preParse Ϊ true ʱͬʱӳ ֻƥ һεʱŽ﷨ 
+             еĴڵʱŻᷢ ڼҪ CompileData
+    profile Ϊ layout ʹõִм¼ Ϊʱ layout ʹþ̬ĵͼ
+*/
+struct CompileOptions {
+    OptimizeLevel level = OptimizeLevel::O2;
+    set<string> enablePasses;
+    set<string> disablePasses;
+    bool verify = false;
+    bool lazy = false;
+    bool preParse = false;
+    shared_ptr<const IRProfile> profile;
+};
+
+/*
+    -O0 -O1 -O2 -enable= -disable= -verify -lazy -preparse
+    ʶĲ pass ׳ ConfigurationException
+*/
+CompileOptions ParseCompileOptions(const vector<string>& arguments, const vector<CompilePass>& passes);
+
+//ÿ׶κ pass ĺʱ () е˳
+struct PassTime {
+    string name;
+    double milliseconds;
+};
 
 struct CompileData {
     CompileData();
     DFA dfa;
     PredictiveParsingTable table;
     GenerateSATypeFunctionMap generateMap;
+    vector<CompilePass> passes;
+    CompileOptions options;
 };
 
-VMRuntimeData GenerateVMRuntimeData(const wstring& text, const CompileData& data, const vector<wstring>& registeredNames);
\ No newline at end of file
+IRModule GenerateIntermediateRepresentation(const wstring& text, const CompileData& data, const vector<wstring>& registeredNames,
+    vector<PassTime>* passTime = nullptr);
+
+VMRuntimeData GenerateVMRuntimeData(const wstring& text, const CompileData& data, const vector<wstring>& registeredNames,
+    vector<PassTime>* passTime = nullptr);
\ No newline at end of file
@@ -0,0 +1,1016 @@
+#include "IntermediateRepresentation.h"
+#include "CompilerException.h"
+#include <functional>
+#include <set>
+#include <algorithm>
+using std::function;
+using std::set;
+using std::pair;
+
+bool IRIsTerminator(IROperation operation) {
+    switch (operation) {
+        case IROperation::Jump:
+        case IROperation::Branch:
+        case IROperation::Fallthrough:
+        case IROperation::Return:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void IRVerifyFunction(const IRModule& module, const IRFunction& function) {
+    int32_t blockCount = static_cast<int32_t>(function.blocks.size());
+    if (function.layout.size() != function.blocks.size()) {
+        throw CompilerError();
+    }
+    vector<int32_t> layoutPosition(blockCount, -1);
+    for (int32_t i = 0; i < blockCount; i++) {
+        int32_t block = function.layout[i];
+        if (block < 0 || block >= blockCount || layoutPosition[block] != -1) {
+            throw CompilerError();
+        }
+        layoutPosition[block] = i;
+    }
+    auto checkBlock = [&](int32_t block) {
+        if (block < 0 || block >= blockCount) {
+            throw CompilerError();
+        }
+    };
+    auto checkNext = [&](int32_t block, int32_t next) {
+        checkBlock(next);
+        if (layoutPosition[next] != layoutPosition[block] + 1) {
+            throw CompilerError();
+        }
+    };
+
+    vector<bool> defined(function.valueCount, false);
+    for (int32_t block = 0; block < blockCount; block++) {
+        auto& instructions = function.blocks[block].instructions;
+        if (instructions.empty() || IRIsTerminator(instructions.back().operation) == false) {
+            throw CompilerError();
+        }
+        //ֵֻڶĻʹ
+        set<int32_t> available;
+        for (size_t i = 0; i < instructions.size(); i++) {
+            auto& instruction = instructions[i];
+            if (IRIsTerminator(instruction.operation) && i + 1 != instructions.size()) {
+                throw CompilerError();
+            }
+            for (auto operand : instruction.operands) {
+                if (available.find(operand) == available.end()) {
+                    throw CompilerError();
+                }
+            }
+            switch (instruction.operation) {
+                case IROperation::DefineLocal:
+                case IROperation::LoadLocal:
+                case IROperation::StoreLocal:
+                    if (instruction.index < 0 || instruction.index >= function.localCount) {
+                        throw CompilerError();
+                    }
+                    break;
+                case IROperation::LoadClosure:
+                case IROperation::StoreClosure:
+                    if (instruction.index < 0 || instruction.index >= function.closureLength) {
+                        throw CompilerError();
+                    }
+                    break;
+                case IROperation::CreateFunction:
+                case IROperation::StaticFunction:
+                    if (instruction.function <= 0 || instruction.function >= static_cast<int32_t>(module.functions.size())) {
+                        throw CompilerError();
+                    }
+                    break;
+                case IROperation::Jump:
+                    checkBlock(instruction.target);
+                    break;
+                case IROperation::Branch:
+                    checkBlock(instruction.target);
+                    checkNext(block, instruction.next);
+                    break;
+                case IROperation::Fallthrough:
+                    checkNext(block, instruction.next);
+                    break;
+                default:
+                    break;
+            }
+            if (instruction.result != -1) {
+                if (instruction.result < 0 || instruction.result >= function.valueCount || defined[instruction.result]) {
+                    throw CompilerError();
+                }
+                defined[instruction.result] = true;
+                available.insert(instruction.result);
+            }
+        }
+    }
+}
+
+void IRVerify(const IRModule& module) {
+    if (module.functions.empty()) {
+        throw CompilerError();
+    }
+    for (auto& function : module.functions) {
+        if (function.pending == false) {
+            IRVerifyFunction(module, function);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------------------
+                                    мʾֽ
+----------------------------------------------------------------------------------------*/
+
+InstructionEnum IRImmediateInstruction(InstructionEnum binary) {
+    switch (binary) {
+        case InstructionEnum::Multiply: return InstructionEnum::MultiplyImmediate;
+        case InstructionEnum::Divide: return InstructionEnum::DivideImmediate;
+        case InstructionEnum::Modulus: return InstructionEnum::ModulusImmediate;
+        case InstructionEnum::Add: return InstructionEnum::AddImmediate;
+        case InstructionEnum::Subtract: return InstructionEnum::SubtractImmediate;
+        case InstructionEnum::Less: return InstructionEnum::LessImmediate;
+        case InstructionEnum::LessEquals: return InstructionEnum::LessEqualsImmediate;
+        case InstructionEnum::Greater: return InstructionEnum::GreaterImmediate;
+        case InstructionEnum::GreaterEquals: return InstructionEnum::GreaterEqualsImmediate;
+        case InstructionEnum::Equals: return InstructionEnum::EqualsImmediate;
+        case InstructionEnum::NotEquals: return InstructionEnum::NotEqualsImmediate;
+        default: throw CompilerError();
+    }
+}
+
+//Ƶ֤ҲΪ Int  Float ʱרָ ûרָʱʹԭָ
+InstructionEnum IRTypedInstruction(InstructionEnum binary, optional<HeapEnum> operandType) {
+    bool isInt = operandType == HeapEnum::Int;
+    bool isFloat = operandType == HeapEnum::Float;
+    if (isInt == false && isFloat == false) {
+        return binary;
+    }
+    switch (binary) {
+        case InstructionEnum::Multiply: return isInt ? InstructionEnum::MultiplyInt : InstructionEnum::MultiplyFloat;
+        case InstructionEnum::Divide: return isInt ? InstructionEnum::DivideInt : InstructionEnum::DivideFloat;
+        case InstructionEnum::Modulus: return isInt ? InstructionEnum::ModulusInt : InstructionEnum::ModulusFloat;
+        case InstructionEnum::Add: return isInt ? InstructionEnum::AddInt : InstructionEnum::AddFloat;
+        case InstructionEnum::Subtract: return isInt ? InstructionEnum::SubtractInt : InstructionEnum::SubtractFloat;
+        case InstructionEnum::Less: return isInt ? InstructionEnum::LessInt : InstructionEnum::LessFloat;
+        case InstructionEnum::LessEquals: return isInt ? InstructionEnum::LessEqualsInt : InstructionEnum::LessEqualsFloat;
+        case InstructionEnum::Greater: return isInt ? InstructionEnum::GreaterInt : InstructionEnum::GreaterFloat;
+        case InstructionEnum::GreaterEquals: return isInt ? InstructionEnum::GreaterEqualsInt : InstructionEnum::GreaterEqualsFloat;
+        default: return binary;
+    }
+}
+
+vector<int32_t> IRSuccessors(const IRBlock& block) {
+    auto& terminator = block.instructions.back();
+    switch (terminator.operation) {
+        case IROperation::Jump:
+            return { terminator.target };
+        case IROperation::Branch:
+            return { terminator.target, terminator.next };
+        case IROperation::Fallthrough:
+            return { terminator.next };
+        default:
+            return {};
+    }
+}
+
+//Ӻǰһָ
+void IRLocalTransfer(const IRInstruction& instruction, vector<bool>& live) {
+    if (instruction.operation == IROperation::DefineLocal) {
+        live[instruction.index] = false;
+    } else if (instruction.operation == IROperation::LoadLocal || instruction.operation == IROperation::StoreLocal) {
+        live[instruction.index] = true;
+    }
+}
+
+/*
+    ֲռջλõĻԾ
+    LoadLocal StoreLocal Ҫֲλ (д֮ǰλҲܱʹ) DefineLocal ֮ǰռ
+*/
+struct IRLocalLiveness {
+    vector<vector<bool>> liveIn;
+    vector<vector<bool>> liveOut;
+};
+
+IRLocalLiveness IRLocalLivenessAnalysis(const IRFunction& function) {
+    size_t blockCount = function.blocks.size();
+    IRLocalLiveness result;
+    result.liveIn = vector<vector<bool>>(blockCount, vector<bool>(function.localCount, false));
+    result.liveOut = result.liveIn;
+    bool change = true;
+    while (change) {
+        change = false;
+        for (auto iter = function.layout.rbegin(); iter != function.layout.rend(); iter++) {
+            int32_t block = *iter;
+            vector<bool> live(function.localCount, false);
+            for (auto successor : IRSuccessors(function.blocks[block])) {
+                for (int32_t i = 0; i < function.localCount; i++) {
+                    live[i] = live[i] || result.liveIn[successor][i];
+                }
+            }
+            result.liveOut[block] = live;
+            auto& instructions = function.blocks[block].instructions;
+            for (auto instruction = instructions.rbegin(); instruction != instructions.rend(); instruction++) {
+                IRLocalTransfer(*instruction, live);
+            }
+            if (live != result.liveIn[block]) {
+                result.liveIn[block] = std::move(live);
+                change = true;
+            }
+        }
+    }
+    return result;
+}
+
+/*
+    һӦһ offest Ϊǰջջοʼλ
+    ѹ SP PC հ ʼƫΪ2 ηں
+*/
+class IRFunctionEmit {
+public:
+    IRFunctionEmit(const IRModule& module, IREmitEnvironment& environment) : module(module), environment(environment), offest(0) {}
+    //ÿһָλ ûָĻΪ -1
+    vector<int32_t> Handle(int32_t functionIndex);
+private:
+    void Emit(const IRInstruction& instruction);
+    //λջ
+    void CheckTop(const vector<int32_t>& operands) {
+        int32_t count = static_cast<int32_t>(operands.size());
+        for (int32_t i = 0; i < count; i++) {
+            if (valueOffest[operands[i]] != offest - count + 1 + i) {
+                throw CompilerError();
+            }
+        }
+    }
+    int16_t MoveOffest(int16_t value) {
+        offest += value;
+        return offest;
+    }
+    void Add(InstructionEnum type, int16_t instructionOffest, const IRInstruction& instruction, int32_t value = 0) {
+        Instruction result;
+        result.type = type;
+        result.offest = instructionOffest;
+        result.value.intValue = value;
+        environment.AddInstruction(result, instruction.line);
+    }
+    void Push(InstructionEnum type, const IRInstruction& instruction, int32_t value = 0) {
+        Add(type, MoveOffest(1), instruction, value);
+        SetResult(instruction);
+    }
+    void SetResult(const IRInstruction& instruction) {
+        if (instruction.result != -1) {
+            valueOffest[instruction.result] = offest;
+            SetOwner(offest, instruction.result);
+        }
+    }
+    //owner ¼ջÿλôŵ ֵı  -2 - ֲ Ϊ -1
+    void SetOwner(int16_t position, int32_t value) {
+        if (owner.size() <= static_cast<size_t>(position)) {
+            owner.resize(position + 1, -1);
+        }
+        owner[position] = value;
+    }
+    //ջʹõֵͲٻԾľֲ ֵ֮;ֲЩλ
+    void Release(const vector<int32_t>& lastUse, const vector<bool>& live, int32_t index) {
+        while (offest > 2) {
+            int32_t value = static_cast<size_t>(offest) < owner.size() ? owner[offest] : -1;
+            if (value >= 0 && lastUse[value] > index) {
+                break;
+            }
+            if (value <= -2 && live[-2 - value]) {
+                break;
+            }
+            offest -= 1;
+        }
+    }
+    void ClearDeadLocal(const vector<bool>& liveOut, int line);
+    const IRModule& module;
+    IREmitEnvironment& environment;
+    int16_t offest;
+    int32_t functionPosition = 0;
+    vector<int32_t> owner;
+    vector<int16_t> valueOffest;
+    vector<int16_t> localOffest;
+    vector<pair<int32_t, int32_t>> jumps;
+};
+
+/*
+    ֲֻ֮ͨ 鿪ʼʱջֻлԾľֲ
+    ƫƴӻԾľֲߵλÿʼ ٻԾľֲλ֮ı
+*/
+vector<int32_t> IRFunctionEmit::Handle(int32_t functionIndex) {
+    auto& function = module.functions[functionIndex];
+    auto liveness = IRLocalLivenessAnalysis(function);
+    valueOffest = vector<int16_t>(function.valueCount, -1);
+    localOffest = vector<int16_t>(function.localCount, -1);
+    for (int8_t i = 0; i < function.parameterCount; i++) {
+        localOffest[i] = 3 + i;
+    }
+    functionPosition = environment.NewInstructionPosition();
+    vector<int32_t> blockPosition(function.blocks.size(), -1);
+    vector<int32_t> emitted(function.blocks.size(), -1);
+    for (auto block : function.layout) {
+        blockPosition[block] = environment.NewInstructionPosition();
+        offest = 2;
+        owner.assign(3, -1);
+        for (int32_t i = 0; i < function.localCount; i++) {
+            if (liveness.liveIn[block][i]) {
+                if (localOffest[i] == -1) {
+                    throw CompilerError();
+                }
+                SetOwner(localOffest[i], -2 - i);
+                offest = std::max(offest, localOffest[i]);
+            }
+        }
+        auto& instructions = function.blocks[block].instructions;
+        int32_t count = static_cast<int32_t>(instructions.size());
+        vector<vector<bool>> liveAfter(count);
+        vector<bool> live = liveness.liveOut[block];
+        for (int32_t i = count - 1; i >= 0; i--) {
+            liveAfter[i] = live;
+            IRLocalTransfer(instructions[i], live);
+        }
+        vector<int32_t> lastUse(function.valueCount, -1);
+        for (int32_t i = 0; i < count; i++) {
+            for (auto operand : instructions[i].operands) {
+                lastUse[operand] = i;
+            }
+        }
+        for (int32_t i = 0; i < count; i++) {
+            if (i == count - 1) {
+                ClearDeadLocal(liveness.liveOut[block], instructions[i].line);
+            }
+            Emit(instructions[i]);
+            Release(lastUse, liveAfter[i], i);
+        }
+        if (environment.NewInstructionPosition() != blockPosition[block]) {
+            emitted[block] = blockPosition[block];
+        }
+    }
+    for (auto& [index, block] : jumps) {
+        environment.UpdateInstruction(index)->value.intValue = blockPosition[block];
+    }
+    return emitted;
+}
+
+/*
+    β λڻԾľֲ֮µĲٻԾľֲΪ null ձõĶ
+    ʹջ֮ϵĿλ GetNull Ȼ SetVariableByOffest
+*/
+void IRFunctionEmit::ClearDeadLocal(const vector<bool>& liveOut, int line) {
+    int16_t highest = 2;
+    for (size_t i = 0; i < liveOut.size(); i++) {
+        if (liveOut[i]) {
+            highest = std::max(highest, localOffest[i]);
+        }
+    }
+    for (int16_t position = 3; position < highest && position <= offest; position++) {
+        int32_t value = owner[position];
+        if (value <= -2 && liveOut[-2 - value] == false) {
+            Instruction getNull;
+            getNull.type = InstructionEnum::GetNull;
+            getNull.offest = offest + 1;
+            environment.AddInstruction(getNull, line);
+            Instruction setVariable;
+            setVariable.type = InstructionEnum::SetVariableByOffest;
+            setVariable.offest = offest + 1;
+            setVariable.value.offestOrLength = position;
+            environment.AddInstruction(setVariable, line);
+            owner[position] = -1;
+        }
+    }
+}
+
+void IRFunctionEmit::Emit(const IRInstruction& instruction) {
+    auto& operands = instruction.operands;
+    switch (instruction.operation) {
+        case IROperation::Null:
+            Push(InstructionEnum::GetNull, instruction);
+            break;
+        case IROperation::False:
+            Push(InstructionEnum::GetFalse, instruction);
+            break;
+        case IROperation::True:
+            Push(InstructionEnum::GetTrue, instruction);
+            break;
+        case IROperation::Constant:
+        {
+            ConstantData constant = instruction.constant;
+            if (constant.type == HeapEnum::String) {
+                constant.value.intValue = environment.InsertString(instruction.name);
+            }
+            //ʼ֮ųֵ (Ԥĺ) ÿֵʱ
+            if (environment.constantFixed && environment.HasConstant(constant) == false) {
+                Instruction create;
+                switch (constant.type) {
+                    case HeapEnum::Char:
+                        create.type = InstructionEnum::CreateChar;
+                        create.value.word = constant.value.word;
+                        break;
+                    case HeapEnum::Int:
+                        create.type = InstructionEnum::CreateInt;
+                        create.value.intValue = constant.value.intValue;
+                        break;
+                    case HeapEnum::Float:
+                        create.type = InstructionEnum::CreateFloat;
+                        create.value.floatValue = constant.value.floatValue;
+                        break;
+                    case HeapEnum::String:
+                        create.type = InstructionEnum::CreateString;
+                        create.value.intValue = constant.value.intValue;
+                        break;
+                    default:
+                        throw CompilerError();
+                }
+                create.offest = MoveOffest(1);
+                environment.AddInstruction(create, instruction.line);
+                SetResult(instruction);
+                break;
+            }
+            Push(InstructionEnum::LoadConstant, instruction, environment.InsertConstant(constant));
+            break;
+        }
+        case IROperation::CreateArray:
+            CheckTop(operands);
+            Add(InstructionEnum::CreateArray, offest, instruction);
+            SetResult(instruction);
+            break;
+        case IROperation::CreateObject:
+            Push(InstructionEnum::CreateObject, instruction);
+            break;
+        case IROperation::CreateClosure:
+        {
+            //Ҫհĺհ ʹ null  (вʱհ)
+            int16_t closureLength = static_cast<int16_t>(operands.size());
+            if (closureLength == 0) {
+                Push(InstructionEnum::GetNull, instruction);
+                break;
+            }
+            CheckTop(operands);
+            Instruction createClosure;
+            createClosure.type = InstructionEnum::CreateClosure;
+            createClosure.offest = MoveOffest(1 - closureLength);
+            createClosure.value.offestOrLength = closureLength;
+            environment.AddInstruction(createClosure, instruction.line);
+            SetResult(instruction);
+            break;
+        }
+        case IROperation::CreateFunction:
+        {
+            CheckTop(operands);
+            //λк֮
+            Instruction createFunction;
+            createFunction.type = InstructionEnum::CreateFunction;
+            createFunction.reserved = instruction.parameterCount;
+            createFunction.offest = offest;
+            int32_t index = environment.AddInstruction(createFunction, instruction.line);
+            SetResult(instruction);
+            environment.createFunction[instruction.function].push_back(index);
+            if (environment.lazy) {
+                environment.pendingFunction.push_back(instruction.function);
+            }
+            break;
+        }
+        case IROperation::StaticFunction:
+        {
+            auto find = environment.staticFunction.find(instruction.function);
+            if (find != environment.staticFunction.end()) {
+                Push(InstructionEnum::LoadStaticFunction, instruction, find->second);
+                break;
+            }
+            if (environment.lazy) {
+                throw CompilerError();
+            }
+            int32_t index = static_cast<int32_t>(environment.data.staticFunction.size());
+            StaticFunctionData data;
+            data.parameterCount = instruction.parameterCount;
+            data.closureItem = instruction.closureItem;
+            environment.data.staticFunction.push_back(std::move(data));
+            environment.staticFunction[instruction.function] = index;
+            Push(InstructionEnum::LoadStaticFunction, instruction, index);
+            break;
+        }
+        case IROperation::RecursiveFunctionItem:
+        {
+            CheckTop(operands);
+            Instruction addRecursiveFunctionItem;
+            addRecursiveFunctionItem.type = InstructionEnum::AddRecursiveFunctionItem;
+            addRecursiveFunctionItem.offest = offest;
+            addRecursiveFunctionItem.value.offestOrLength = static_cast<int16_t>(instruction.index);
+            environment.AddInstruction(addRecursiveFunctionItem, instruction.line);
+            break;
+        }
+        case IROperation::DefineLocal:
+            CheckTop(operands);
+            localOffest[instruction.index] = valueOffest[operands[0]];
+            SetOwner(offest, -2 - instruction.index);
+            break;
+        case IROperation::LoadLocal:
+        case IROperation::LoadClosure:
+        {
+            bool local = instruction.operation == IROperation::LoadLocal;
+            Instruction load;
+            load.type = local ? InstructionEnum::GetVariableByOffest : InstructionEnum::GetClosureItemByOffest;
+            load.offest = MoveOffest(1);
+            load.value.offestOrLength = local ? localOffest[instruction.index] : static_cast<int16_t>(instruction.index);
+            environment.AddInstruction(load, instruction.line);
+            SetResult(instruction);
+            break;
+        }
+        case IROperation::StoreLocal:
+        case IROperation::StoreClosure:
+        {
+            CheckTop(operands);
+            bool local = instruction.operation == IROperation::StoreLocal;
+            Instruction store;
+            store.type = local ? InstructionEnum::SetVariableByOffest : InstructionEnum::SetClosureItemByOffest;
+            store.offest = offest;
+            store.value.offestOrLength = local ? localOffest[instruction.index] : static_cast<int16_t>(instruction.index);
+            environment.AddInstruction(store, instruction.line);
+            break;
+        }
+        case IROperation::LoadElement:
+            CheckTop(operands);
+            Add(InstructionEnum::AccessArray, MoveOffest(-1), instruction);
+            SetResult(instruction);
+            break;
+        case IROperation::StoreElement:
+            CheckTop(operands);
+            Add(InstructionEnum::AssignmentArray, MoveOffest(-2), instruction);
+            break;
+        case IROperation::LoadField:
+            CheckTop(operands);
+            Add(InstructionEnum::AccessField, offest, instruction, environment.InsertString(instruction.name));
+            SetResult(instruction);
+            break;
+        case IROperation::StoreField:
+        {
+            CheckTop(operands);
+            int16_t instructionOffest = MoveOffest(-1);
+            Add(InstructionEnum::AssignmentField, instructionOffest, instruction, environment.InsertString(instruction.name));
+            break;
+        }
+        case IROperation::FrameHeader:
+            //ֻԤλ ָ ʱд SP PC հ (ͷֵ)
+            for (int i = 0; i < 3 + instruction.index; i++) {
+                SetOwner(MoveOffest(1), instruction.result);
+            }
+            valueOffest[instruction.result] = offest - 2;
+            break;
+        case IROperation::Call:
+        case IROperation::CallSelf:
+        {
+            // SP PC հ   CallSelf ûкֵ λ header Ԥ
+            bool self = instruction.operation == IROperation::CallSelf;
+            int32_t header = self ? 0 : 1;
+            int16_t parameterCount = static_cast<int16_t>(operands.size() - header - 1);
+            int16_t functionOffest = valueOffest[operands[header]] - 1;
+            if (self == false && valueOffest[operands[0]] != functionOffest) {
+                throw CompilerError();
+            }
+            if (offest != functionOffest + 3 + parameterCount) {
+                throw CompilerError();
+            }
+            for (int16_t i = 0; i < parameterCount; i++) {
+                if (valueOffest[operands[header + 1 + i]] != functionOffest + 4 + i) {
+                    throw CompilerError();
+                }
+            }
+            Instruction call;
+            if (self) {
+                //λþǵǰλ
+                call.type = InstructionEnum::CallSelf;
+                call.reserved = static_cast<int8_t>(parameterCount);
+                call.value.intValue = functionPosition;
+            } else {
+                call.type = instruction.tail ? InstructionEnum::TailCall : InstructionEnum::FunctionCall;
+                call.value.offestOrLength = parameterCount;
+            }
+            call.offest = MoveOffest(-parameterCount - 3);
+            environment.AddInstruction(call, instruction.line);
+            SetResult(instruction);
+            break;
+        }
+        case IROperation::CallNative:
+        {
+            //ڵһλ
+            CheckTop(operands);
+            int16_t parameterCount = static_cast<int16_t>(operands.size());
+            Instruction callNative;
+            callNative.type = InstructionEnum::CallNative;
+            callNative.reserved = static_cast<int8_t>(parameterCount);
+            callNative.offest = MoveOffest(1 - parameterCount);
+            callNative.value.intValue = instruction.index;
+            environment.AddInstruction(callNative, instruction.line);
+            SetResult(instruction);
+            break;
+        }
+        case IROperation::Intrinsic:
+            CheckTop(operands);
+            Add(instruction.intrinsic, offest, instruction);
+            SetResult(instruction);
+            break;
+        case IROperation::Discard:
+            CheckTop(operands);
+            MoveOffest(-1);
+            break;
+        case IROperation::Binary:
+        {
+            CheckTop(operands);
+            Instruction binary;
+            if (instruction.immediate) {
+                binary.type = IRImmediateInstruction(instruction.binary);
+                binary.reserved = static_cast<int8_t>(instruction.constant.type);
+                binary.value.intValue = instruction.constant.value.intValue;
+                binary.offest = offest;
+            } else {
+                binary.type = IRTypedInstruction(instruction.binary, instruction.operandType);
+                binary.offest = MoveOffest(-1);
+            }
+            environment.AddInstruction(binary, instruction.line);
+            SetResult(instruction);
+            break;
+        }
+        case IROperation::Not:
+            CheckTop(operands);
+            Add(InstructionEnum::Not, offest, instruction);
+            SetResult(instruction);
+            break;
+        case IROperation::Jump:
+        {
+            int32_t index = environment.NewInstructionPosition();
+            Add(InstructionEnum::Jump, offest, instruction);
+            jumps.push_back(pair(index, instruction.target));
+            break;
+        }
+        case IROperation::Branch:
+        {
+            CheckTop(operands);
+            int32_t index = environment.NewInstructionPosition();
+            Add(InstructionEnum::ConditionJump, offest, instruction);
+            jumps.push_back(pair(index, instruction.target));
+            break;
+        }
+        case IROperation::Fallthrough:
+            break;
+        case IROperation::Return:
+            CheckTop(operands);
+            Add(InstructionEnum::Return, offest, instruction);
+            break;
+        default:
+            throw CompilerError();
+    }
+}
+
+//õĺ  layout гֵ˳
+static vector<int32_t> IRReferencedFunction(const IRFunction& function) {
+    vector<int32_t> result;
+    for (auto block : function.layout) {
+        for (auto& instruction : function.blocks[block].instructions) {
+            if (instruction.operation == IROperation::CreateFunction || instruction.operation == IROperation::StaticFunction) {
+                result.push_back(instruction.function);
+            }
+        }
+    }
+    return result;
+}
+
+// Ȼ ÿֻһ
+static vector<int32_t> IRDefaultFunctionOrder(const IRModule& module) {
+    vector<int32_t> order;
+    vector<bool> visited(module.functions.size(), false);
+    function<void(int32_t)> visit = [&](int32_t function) {
+        if (visited[function]) {
+            return;
+        }
+        visited[function] = true;
+        order.push_back(function);
+        for (auto referenced : IRReferencedFunction(module.functions[function])) {
+            visit(referenced);
+        }
+    };
+    visit(0);
+    return order;
+}
+
+VMRuntimeData IREmit(const IRModule& module, vector<vector<int32_t>>* blockPosition) {
+    IREmitEnvironment environment;
+    vector<int32_t> order = module.functionOrder.empty() ? IRDefaultFunctionOrder(module) : module.functionOrder;
+    if (order.empty() || order[0] != 0) {
+        throw CompilerError();
+    }
+    vector<int32_t> functionPosition(module.functions.size(), -1);
+    if (blockPosition != nullptr) {
+        blockPosition->assign(module.functions.size(), {});
+    }
+    for (auto function : order) {
+        functionPosition[function] = environment.NewInstructionPosition();
+        auto position = IRFunctionEmit(module, environment).Handle(function);
+        if (blockPosition != nullptr) {
+            (*blockPosition)[function] = std::move(position);
+        }
+    }
+    for (auto& [function, references] : environment.createFunction) {
+        if (functionPosition[function] == -1) {
+            throw CompilerError();
+        }
+        for (auto index : references) {
+            environment.UpdateInstruction(index)->value.intValue = functionPosition[function];
+        }
+    }
+    for (auto& [function, index] : environment.staticFunction) {
+        if (functionPosition[function] == -1) {
+            throw CompilerError();
+        }
+        environment.data.staticFunction[index].programPosition = functionPosition[function];
+    }
+    environment.data.registeredNames = module.registeredNames;
+    environment.data.mainClosureOffest = module.mainClosureOffest;
+    return std::move(environment.data);
+}
+
+void IRLazyEmit::AddConstant(ConstantData constant, const wstring& str) {
+    if (constant.type == HeapEnum::String) {
+        constant.value.intValue = environment.InsertString(str);
+    }
+    environment.InsertConstant(constant);
+}
+
+void IRLazyEmit::AddStaticFunction(int32_t function, int8_t parameterCount, vector<int16_t> closureItem) {
+    StaticFunctionData data;
+    data.parameterCount = parameterCount;
+    data.closureItem = std::move(closureItem);
+    environment.staticFunction[function] = static_cast<int32_t>(environment.data.staticFunction.size());
+    environment.data.staticFunction.push_back(std::move(data));
+    environment.pendingFunction.push_back(function);
+}
+
+//δɵĺ CompileFunction ָ CreateFunction Ԥȷĺָ
+void IRLazyEmit::EmitPendingFunction() {
+    for (auto function : environment.pendingFunction) {
+        Instruction compileFunction;
+        compileFunction.type = InstructionEnum::CompileFunction;
+        compileFunction.offest = 2 + module.functions[function].parameterCount;
+        compileFunction.value.intValue = function;
+        int32_t position = environment.AddInstruction(compileFunction, 0);
+        for (auto index : environment.createFunction[function]) {
+            environment.UpdateInstruction(index)->value.intValue = position;
+        }
+        auto find = environment.staticFunction.find(function);
+        if (find != environment.staticFunction.end()) {
+            environment.data.staticFunction[find->second].programPosition = position;
+        }
+    }
+    environment.pendingFunction.clear();
+}
+
+VMRuntimeData IRLazyEmit::EmitMain() {
+    IRFunctionEmit(module, environment).Handle(0);
+    EmitPendingFunction();
+    environment.constantFixed = true;
+    VMRuntimeData data = environment.data;
+    data.registeredNames = module.registeredNames;
+    data.mainClosureOffest = module.mainClosureOffest;
+    environment.base = static_cast<int32_t>(environment.data.instruction.size());
+    environment.data.instruction.clear();
+    environment.data.instructionLine.clear();
+    return data;
+}
+
+LazyCompileResult IRLazyEmit::EmitFunction(int32_t function, int32_t programPosition) {
+    if (programPosition != environment.base) {
+        throw CompilerError();
+    }
+    size_t stringCount = environment.data.staticString.size();
+    IRFunctionEmit(module, environment).Handle(function);
+    EmitPendingFunction();
+    LazyCompileResult result;
+    result.instruction = std::move(environment.data.instruction);
+    result.instructionLine = std::move(environment.data.instructionLine);
+    result.staticString.assign(environment.data.staticString.begin() + stringCount, environment.data.staticString.end());
+    result.createFunction = std::move(environment.createFunction[function]);
+    environment.createFunction.erase(function);
+    auto find = environment.staticFunction.find(function);
+    if (find != environment.staticFunction.end()) {
+        result.staticFunction = find->second;
+    }
+    environment.base += static_cast<int32_t>(result.instruction.size());
+    environment.data.instruction.clear();
+    environment.data.instructionLine.clear();
+    return result;
+}
+
+/*----------------------------------------------------------------------------------------
+                                    Ϊȴ벼
+----------------------------------------------------------------------------------------*/
+
+IRProfile IRCreateProfile(const IRModule& module, const vector<vector<int32_t>>& blockPosition, const vector<int64_t>& instructionCount) {
+    IRProfile profile;
+    profile.blockCount.resize(module.functions.size());
+    for (size_t function = 0; function < module.functions.size(); function++) {
+        auto& count = profile.blockCount[function];
+        count.assign(module.functions[function].blocks.size(), -1);
+        if (function >= blockPosition.size()) {
+            continue;
+        }
+        auto& position = blockPosition[function];
+        for (size_t block = 0; block < count.size() && block < position.size(); block++) {
+            //еִָ һִָдǻִд
+            if (position[block] >= 0 && static_cast<size_t>(position[block]) < instructionCount.size()) {
+                count[block] = instructionCount[position[block]];
+            }
+        }
+    }
+    return profile;
+}
+
+//ǰ (ָԼ) תΪѭĻر ѭڲ λڻر֮Ļѭȼһ
+static vector<int32_t> IRLoopDepth(const IRFunction& function) {
+    vector<int32_t> position(function.blocks.size(), 0);
+    for (size_t i = 0; i < function.layout.size(); i++) {
+        position[function.layout[i]] = static_cast<int32_t>(i);
+    }
+    vector<int32_t> depth(function.blocks.size(), 0);
+    for (auto block : function.layout) {
+        for (auto successor : IRSuccessors(function.blocks[block])) {
+            if (position[successor] <= position[block]) {
+                for (int32_t i = position[successor]; i <= position[block]; i++) {
+                    depth[function.layout[i]] += 1;
+                }
+            }
+        }
+    }
+    return depth;
+}
+
+/*
+    ̬ĵͼ ( õĺ)
+    ֻʶֱӵ StaticFunction CreateFunction ԼֻһҲٸֵľֲеĺ
+*/
+static vector<pair<int32_t, int32_t>> IRCallSite(const IRFunction& function) {
+    vector<int32_t> localFunction(function.localCount, -1);
+    vector<bool> unknown(function.localCount, false);
+    for (auto& block : function.blocks) {
+        map<int32_t, int32_t> valueFunction;
+        for (auto& instruction : block.instructions) {
+            switch (instruction.operation) {
+                case IROperation::CreateFunction:
+                case IROperation::StaticFunction:
+                    valueFunction[instruction.result] = instruction.function;
+                    break;
+                case IROperation::DefineLocal:
+                {
+                    auto find = valueFunction.find(instruction.operands[0]);
+                    if (find == valueFunction.end() || (localFunction[instruction.index] != -1 && localFunction[instruction.index] != find->second)) {
+                        unknown[instruction.index] = true;
+                    } else {
+                        localFunction[instruction.index] = find->second;
+                    }
+                    break;
+                }
+                case IROperation::StoreLocal:
+                    unknown[instruction.index] = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    vector<pair<int32_t, int32_t>> result;
+    for (int32_t block = 0; block < static_cast<int32_t>(function.blocks.size()); block++) {
+        map<int32_t, int32_t> valueFunction;
+        for (auto& instruction : function.blocks[block].instructions) {
+            switch (instruction.operation) {
+                case IROperation::CreateFunction:
+                case IROperation::StaticFunction:
+                    valueFunction[instruction.result] = instruction.function;
+                    break;
+                case IROperation::LoadLocal:
+                    if (localFunction[instruction.index] != -1 && unknown[instruction.index] == false) {
+                        valueFunction[instruction.result] = localFunction[instruction.index];
+                    }
+                    break;
+                case IROperation::Call:
+                {
+                    auto find = valueFunction.find(instruction.operands[0]);
+                    if (find != valueFunction.end()) {
+                        result.push_back(pair(block, find->second));
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+    return result;
+}
+
+//ɵͼÿִд Ϊ 1 ݹû ֻ޵Ĵ
+static vector<double> IRStaticFunctionCount(const IRModule& module, const vector<int32_t>& order) {
+    size_t functionCount = module.functions.size();
+    vector<vector<pair<int32_t, double>>> calls(functionCount);
+    for (auto caller : order) {
+        auto& function = module.functions[caller];
+        auto depth = IRLoopDepth(function);
+        for (auto& [block, callee] : IRCallSite(function)) {
+            double weight = 1;
+            for (int32_t i = 0; i < std::min(depth[block], 4); i++) {
+                weight *= 8;
+            }
+            calls[caller].push_back(pair(callee, weight));
+        }
+    }
+    vector<double> count(functionCount, 0);
+    count[0] = 1;
+    for (int round = 0; round < 8; round++) {
+        vector<double> next(functionCount, 0);
+        next[0] = 1;
+        for (auto caller : order) {
+            for (auto& [callee, weight] : calls[caller]) {
+                if (callee != caller) {
+                    next[callee] += count[caller] * weight;
+                }
+            }
+        }
+        if (next == count) {
+            break;
+        }
+        count = std::move(next);
+    }
+    return count;
+}
+
+/*
+    µ˳Ľβ
+    Fallthrough ĺ̲ʱΪ Jump  Jump ĿʱΪ Fallthrough
+    Branch Ϊٵĺ̲ʱ ֮һֻ Jump Ļ
+*/
+static void IRRelayout(IRFunction& function, const vector<int32_t>& order) {
+    vector<int32_t> layout;
+    for (size_t i = 0; i < order.size(); i++) {
+        int32_t block = order[i];
+        int32_t following = i + 1 < order.size() ? order[i + 1] : -1;
+        layout.push_back(block);
+        auto& terminator = function.blocks[block].instructions.back();
+        if (terminator.operation == IROperation::Fallthrough && terminator.next != following) {
+            terminator.operation = IROperation::Jump;
+            terminator.target = terminator.next;
+        } else if (terminator.operation == IROperation::Jump && terminator.target == following) {
+            terminator.operation = IROperation::Fallthrough;
+            terminator.next = following;
+        } else if (terminator.operation == IROperation::Branch && terminator.next != following) {
+            IRInstruction jump;
+            jump.operation = IROperation::Jump;
+            jump.target = terminator.next;
+            jump.line = terminator.line;
+            int32_t trampoline = static_cast<int32_t>(function.blocks.size());
+            terminator.next = trampoline;
+            IRBlock trampolineBlock;
+            trampolineBlock.instructions.push_back(std::move(jump));
+            function.blocks.push_back(std::move(trampolineBlock));
+            layout.push_back(trampoline);
+        }
+    }
+    function.layout = std::move(layout);
+}
+
+void IRLayout(IRModule& module, const IRProfile* profile) {
+    vector<int32_t> order = IRDefaultFunctionOrder(module);
+    vector<double> count;
+    if (profile == nullptr) {
+        count = IRStaticFunctionCount(module, order);
+    } else {
+        count.assign(module.functions.size(), 0);
+        for (size_t function = 0; function < module.functions.size() && function < profile->blockCount.size(); function++) {
+            for (auto blockCount : profile->blockCount[function]) {
+                count[function] = std::max(count[function], static_cast<double>(blockCount));
+            }
+        }
+    }
+    std::stable_sort(order.begin() + 1, order.end(), [&count](int32_t left, int32_t right) {
+        return count[left] > count[right];
+    });
+    module.functionOrder = order;
+    if (profile == nullptr) {
+        return;
+    }
+    //ûִйĻ鰴ԭ˳ںĩβ ڲƶ
+    for (auto index : order) {
+        auto& function = module.functions[index];
+        if (count[index] <= 0 || static_cast<size_t>(index) >= profile->blockCount.size()) {
+            continue;
+        }
+        auto& blockCount = profile->blockCount[index];
+        vector<int32_t> hot;
+        vector<int32_t> cold;
+        for (auto block : function.layout) {
+            bool isCold = block != function.layout[0] && static_cast<size_t>(block) < blockCount.size() && blockCount[block] == 0;
+            (isCold ? cold : hot).push_back(block);
+        }
+        if (cold.empty()) {
+            continue;
+        }
+        hot.insert(hot.end(), cold.begin(), cold.end());
+        IRRelayout(function, hot);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,243 @@
+#pragma once
+#include"CodeGenerate.h"
+#include"CompilerException.h"
+#include<optional>
+#include<map>
+using std::optional;
+using std::map;
+using std::pair;
+
+/*
+    мʾ λڳ﷨ֽ֮
+    ɻ еֵΪ SSA ʽ (ÿֵֻһ ֻڶĻʹ)
+    ֲ հ Ԫ ֶ ͨʽĶдָ ֲֻ֮ͨ
+
+    ֵն˳ڲջ ָĲλջ (ֵ˳һ)
+    ֲǱ ֽʱŷջеλ Ϊǰ parameterCount ֲ
+
+    operation            result    operands                         
+    Null False True      ֵ
+    Constant             ֵ                                         constant (String  name )
+    CreateArray          ֵ        length
+    CreateObject         ֵ
+    CreateClosure        ֵ        item......                       (û item ʱհ ʹ null)
+    CreateFunction       ֵ        closure                          function parameterCount
+    StaticFunction       ֵ                                         function parameterCount closureItem
+    RecursiveFunctionItem          function                         index(հеλ)
+    DefineLocal                    value                            index(ֲ) ֵڵλóΪֲ
+    LoadLocal            ֵ                                         index(ֲ)
+    StoreLocal                     value                            index(ֲ)
+    LoadClosure          ֵ                                         index(հеλ)
+    StoreClosure                   value                            index(հеλ)
+    LoadElement          ֵ        array index
+    StoreElement                   array index value
+    LoadField            ֵ        object                           name
+    StoreField                     object value                     name
+    FrameHeader          ֵ                                         ʱд SP PC հ Ԥ 3 λ ָ
+                                                                    index(Ϊ 1 ʱͬʱԤλ ֵΪ SP λ)
+    Call                 ֵ        function header parameter......  tail
+    CallNative           ֵ        parameter......                  index(غı հеλ)
+    CallSelf             ֵ        header parameter......           õǰ header  index Ϊ 1
+    Intrinsic            ֵ        value                            intrinsic(úָ)
+    Discard                        value                            ʹõֵ
+    Binary               ֵ        left right / left                binary operandType immediate(Ҳ constant )
+    Not                  ֵ        value
+    Jump                                                            target
+    Branch                         condition                        target(Ϊ) next(Ϊ һ)
+    Fallthrough                                                     next(һ)
+    Return                         value
+*/
+enum class IROperation : int8_t {
+    Null,
+    False,
+    True,
+    Constant,
+    CreateArray,
+    CreateObject,
+    CreateClosure,
+    CreateFunction,
+    StaticFunction,
+    RecursiveFunctionItem,
+    DefineLocal,
+    LoadLocal,
+    StoreLocal,
+    LoadClosure,
+    StoreClosure,
+    LoadElement,
+    StoreElement,
+    LoadField,
+    StoreField,
+    FrameHeader,
+    Call,
+    CallNative,
+    CallSelf,
+    Intrinsic,
+    Discard,
+    Binary,
+    Not,
+    Jump,
+    Branch,
+    Fallthrough,
+    Return,
+};
+
+struct IRInstruction {
+    IROperation operation = IROperation::Null;
+    int32_t result = -1;
+    vector<int32_t> operands;
+    int32_t index = 0;
+    int32_t target = 0;
+    int32_t next = 0;
+    int32_t function = 0;
+    int8_t parameterCount = 0;
+    vector<int16_t> closureItem;
+    InstructionEnum binary = InstructionEnum::Unused;
+    InstructionEnum intrinsic = InstructionEnum::Unused;
+    optional<HeapEnum> operandType;
+    bool immediate = false;
+    bool tail = false;
+    ConstantData constant;
+    wstring name;
+    int line = 0;
+};
+
+struct IRBlock {
+    vector<IRInstruction> instructions;
+};
+
+/*
+    layout Ϊֽе˳
+    pending ΪӳʱδתΪмʾ ֻ parameterCount Ч
+*/
+struct IRFunction {
+    bool pending = false;
+    int8_t parameterCount = 0;
+    int16_t closureLength = 0;
+    int32_t localCount = 0;
+    int32_t valueCount = 0;
+    vector<IRBlock> blocks;
+    vector<int32_t> layout;
+};
+
+/*
+    functions[0] Ϊ
+    functionOrder Ϊֽе˳ һ Ϊʱõ˳ ( Ȼ)
+*/
+struct IRModule {
+    vector<IRFunction> functions;
+    vector<wstring> registeredNames;
+    vector<int> mainClosureOffest;
+    vector<int32_t> functionOrder;
+};
+
+bool IRIsTerminator(IROperation operation);
+
+// SSA ʽ Ľβ Լ layout Ƿȷ ȷʱ׳ CompilerError
+void IRVerify(const IRModule& module);
+
+/*
+    ֽ  functionOrder ηú
+    Ϊֲջеλ ÿָ offest
+    blockPosition Ϊ nullptr ʱ¼ÿÿһָλ ûָĻΪ -1
+*/
+VMRuntimeData IREmit(const IRModule& module, vector<vector<int32_t>>* blockPosition = nullptr);
+
+/*
+    ִм¼ ÿÿִеĴ ޷֪Ϊ -1
+    ¼ÿִָдõ ı֮±ͬһδʱ
+*/
+struct IRProfile {
+    vector<vector<int64_t>> blockCount;
+};
+
+IRProfile IRCreateProfile(const IRModule& module, const vector<vector<int32_t>>& blockPosition, const vector<int64_t>& instructionCount);
+
+/*
+    ȴ벼  functionOrder ÿ layout
+    profile Ϊ nullptr ʱɾ̬ĵͼƺִд (ڵѭÿһ 8)
+    ʹִм¼ ûִйĻƶĩβ
+    ִ֮дӶൽٷú ִеöĺ ûִйĺ
+*/
+void IRLayout(IRModule& module, const IRProfile* profile);
+
+/*
+    ֽʱõ
+    ӳʱÿֻһ base Ϊ data.instruction еһָڳеλ
+*/
+class IREmitEnvironment {
+public:
+    int32_t AddInstruction(Instruction instruction, int line) {
+        int32_t index = NewInstructionPosition();
+        data.instruction.push_back(instruction);
+        data.instructionLine.push_back(line);
+        return index;
+    }
+    Instruction* UpdateInstruction(int32_t index) {
+        return &data.instruction[index - base];
+    }
+    int32_t NewInstructionPosition() {
+        return base + static_cast<int32_t>(data.instruction.size());
+    }
+    int32_t InsertString(const wstring& str) {
+        int32_t index = static_cast<int32_t>(data.staticString.size());
+        auto [iter, b] = data.stringMap.insert(pair(str, index));
+        if (b == true) {
+            data.staticString.push_back(str);
+            return index;
+        } else {
+            return iter->second;
+        }
+    }
+    bool HasConstant(ConstantData constant) {
+        return constantMap.find(pair(constant.type, constant.value.intValue)) != constantMap.end();
+    }
+    //ֻͬһ ʼ֮ٸı
+    int32_t InsertConstant(ConstantData constant) {
+        int32_t index = static_cast<int32_t>(data.constantPool.size());
+        auto key = pair(constant.type, constant.value.intValue);
+        auto [iter, b] = constantMap.insert(pair(key, index));
+        if (b == true) {
+            if (constantFixed) {
+                throw CompilerError();
+            }
+            data.constantPool.push_back(constant);
+            return index;
+        } else {
+            return iter->second;
+        }
+    }
+public:
+    VMRuntimeData data;
+    map<pair<HeapEnum, int32_t>, int32_t> constantMap;
+    int32_t base = 0;
+    bool lazy = false;
+    bool constantFixed = false;
+    //δõĺ -> ָ CreateFunction λ
+    map<int32_t, vector<int32_t>> createFunction;
+    //Ԥȷĺ ->  staticFunction еλ
+    map<int32_t, int32_t> staticFunction;
+    //һõδɵĺ  CompileFunction
+    vector<int32_t> pendingFunction;
+};
+
+/*
+    ӳֽ ֮ĺڵһεʱתΪмʾֽ
+    δɵĺָһ CompileFunction ֮滻Ϊ Jump ڳĩβ
+    Ԥȷĺʼʱ ֮ǰȫ
+*/
+class IRLazyEmit {
+public:
+    IRLazyEmit(const IRModule& module) : module(module) {
+        environment.lazy = true;
+    }
+    //String  str 
+    void AddConstant(ConstantData constant, const wstring& str);
+    void AddStaticFunction(int32_t function, int8_t parameterCount, vector<int16_t> closureItem);
+    VMRuntimeData EmitMain();
+    //function ѾתΪмʾ programPosition Ϊ忪ʼλ
+    LazyCompileResult EmitFunction(int32_t function, int32_t programPosition);
+private:
+    void EmitPendingFunction();
+    const IRModule& module;
+    IREmitEnvironment environment;
+};
\ No newline at end of file
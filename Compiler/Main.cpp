@@ -5,7 +5,11 @@
 #include <fstream>
 using std::wifstream;
 using std::wcout;
-int main() {
+/*
+     -O0 -O1 -O2 -enable= -disable= -verify -lazy -preparse  ParseCompileOptions
+    -time ÿ pass ĺʱ
+*/
+int main(int argc, char* argv[]) {
     string path = "../demo.txt";
     std::wifstream f(path, std::ios::in);
     if (!f.is_open()) {
@@ -19,11 +23,38 @@ int main() {
     }
     try {
         auto compileData = CompileData();
+        vector<string> arguments;
+        bool showTime = false;
+        for (int i = 1; i < argc; i++) {
+            if (string(argv[i]) == "-time") {
+                showTime = true;
+            } else {
+                arguments.push_back(argv[i]);
+            }
+        }
+        compileData.options = ParseCompileOptions(arguments, compileData.passes);
         vector<wstring> regNames{
             L"Print",
             L"ArrayLength",
+            L"ObjectFieldCount",
+            L"TypeOf",
+            L"CharToInt",
+            L"IntToChar",
+            L"Map",
+            L"MapGet",
+            L"MapSet",
+            L"MapHas",
+            L"MapDelete",
+            L"MapSize",
+            L"MapKeys",
         };
-        auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+        vector<PassTime> passTime;
+        auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames, &passTime));
+        if (showTime) {
+            for (auto& item : passTime) {
+                std::cout << item.name << " : " << item.milliseconds << "ms" << std::endl;
+            }
+        }
         builder.RegistLocalFunction(L"Print", [](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
             if (parameterCount != 1) {
                 throw RuntimeException("Print Ϊ 1");
@@ -58,6 +89,9 @@ int main() {
                 case HeapEnum::Object:
                     wcout << L"Object";
                     break;
+                case HeapEnum::Map:
+                    wcout << L"Map";
+                    break;
                 case HeapEnum::Function:
                     wcout << L"Funtion";
                     break;
@@ -79,11 +113,53 @@ int main() {
                 throw RuntimeException("ArrayLength ");
             }
             int32_t size = VMLocalFunctionGetArraySize(*vm, heapPointerArray);
-            int32_t heapPointerInt = VMAllocateHeapMemory(*vm, HeapEnum::Int, 2);
-            auto heapPointerIntPtr = VMHeapMemory(*vm, heapPointerInt);
-            heapPointerIntPtr[1].value.intValue = size;
-            return heapPointerInt;
+            return VMIntToHeapPointer(*vm, size);
+        });
+        //ıغûб¶ʱɱ滻Ϊúָ ΪֵʹʱŻ
+        builder.RegistLocalFunction(L"ObjectFieldCount", [](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+            if (parameterCount != 1) {
+                throw RuntimeException("ObjectFieldCount Ϊ 1");
+            }
+            auto heapPointerObject = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+            if (VMLocalFunctionGetType(*vm, heapPointerObject) != HeapEnum::Object) {
+                throw RuntimeException("ObjectFieldCount ");
+            }
+            return VMIntToHeapPointer(*vm, VMLocalFunctionGetObjectFieldSize(*vm, heapPointerObject));
+        });
+        builder.RegistLocalFunction(L"TypeOf", [](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+            if (parameterCount != 1) {
+                throw RuntimeException("TypeOf Ϊ 1");
+            }
+            auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+            return VMIntToHeapPointer(*vm, static_cast<int32_t>(VMLocalFunctionGetType(*vm, heapPointer)));
+        });
+        builder.RegistLocalFunction(L"CharToInt", [](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+            if (parameterCount != 1) {
+                throw RuntimeException("CharToInt Ϊ 1");
+            }
+            auto heapPointerChar = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+            if (VMLocalFunctionGetType(*vm, heapPointerChar) != HeapEnum::Char) {
+                throw RuntimeException("CharToInt ");
+            }
+            return VMIntToHeapPointer(*vm, static_cast<int32_t>(VMLocalFunctionGetChar(*vm, heapPointerChar)));
+        });
+        builder.RegistLocalFunction(L"IntToChar", [](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+            if (parameterCount != 1) {
+                throw RuntimeException("IntToChar Ϊ 1");
+            }
+            auto heapPointerInt = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+            if (VMLocalFunctionGetType(*vm, heapPointerInt) != HeapEnum::Int) {
+                throw RuntimeException("IntToChar ");
+            }
+            return VMCharToHeapPointer(*vm, static_cast<wchar_t>(VMLocalFunctionGetInt(*vm, heapPointerInt)));
         });
+        builder.RegistLocalFunction(L"Map", VMMapCreate);
+        builder.RegistLocalFunction(L"MapGet", VMMapGet);
+        builder.RegistLocalFunction(L"MapSet", VMMapSet);
+        builder.RegistLocalFunction(L"MapHas", VMMapHas);
+        builder.RegistLocalFunction(L"MapDelete", VMMapDelete);
+        builder.RegistLocalFunction(L"MapSize", VMMapSize);
+        builder.RegistLocalFunction(L"MapKeys", VMMapKeys);
         auto vm = builder.Build();
         VirtualMachineInit(vm);
         VirtualMachineStart(vm);
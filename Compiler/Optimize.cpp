@@ -0,0 +1,2073 @@
+#include "Optimize.h"
+#include "CompilerException.h"
+#include <typeindex>
+#include <memory>
+#include <set>
+#include <map>
+#include <functional>
+#include <optional>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+using std::optional;
+using std::function;
+using std::make_unique;
+using std::set;
+using std::map;
+using std::pair;
+using std::type_index;
+using std::to_wstring;
+using namespace AbstractSyntax;
+
+int32_t inlineSizeMax = 32;
+int32_t scalarArrayMax = 16;
+
+/*
+    ʽֱӰӱʽ 뺯
+*/
+class ExpressionChildren : public AbstractSyntaxVisitor {
+public:
+    ExpressionChildren(function<void(unique_ptr<Expression>&)> action) : action(std::move(action)) {}
+    void Handle(Expression& type) {
+        type.Accept(*this);
+    }
+    void VisitExpression(Expression& type) override {}
+    void VisitBinaryOperation(BinaryOperation& type) override {
+        action(type.left);
+        action(type.right);
+    }
+    void VisitUnaryOperation(UnaryOperation& type) override {
+        action(type.expression);
+    }
+    void Visit(Array& type) override {
+        action(type.length);
+    }
+    void Visit(SpecialOperationList& type) override {
+        for (auto& item : type.specialOperations) {
+            item->Accept(*this);
+        }
+    }
+    void Visit(FunctionCall& type) override {
+        for (auto& item : type.expressionList) {
+            action(item);
+        }
+    }
+    void Visit(AccessArray& type) override {
+        action(type.index);
+    }
+    void Visit(AccessField& type) override {}
+private:
+    function<void(unique_ptr<Expression>&)> action;
+};
+
+/*
+    ҵʽеĺ 뺯
+*/
+class FunctionLiteralProcess : public AbstractSyntaxVisitor {
+public:
+    FunctionLiteralProcess(function<void(Function&)> action) : action(std::move(action)) {}
+    void Handle(Expression& type) {
+        type.Accept(*this);
+        ExpressionChildren([this](unique_ptr<Expression>& item) {
+            Handle(*item);
+        }).Handle(type);
+    }
+    void VisitExpression(Expression& type) override {}
+    void VisitBinaryOperation(BinaryOperation& type) override {}
+    void VisitUnaryOperation(UnaryOperation& type) override {}
+    void Visit(Function& type) override {
+        action(type);
+    }
+private:
+    function<void(Function&)> action;
+};
+
+/*
+    ֱӰıʽ 뺯
+*/
+class StatementChildren : public AbstractSyntaxVisitor {
+public:
+    StatementChildren(function<void(unique_ptr<Expression>&)> expressionAction,
+        function<void(unique_ptr<SpecialOperationList>&)> specialOperationListAction,
+        function<void(StatementBlock&)> blockAction)
+        : expressionAction(std::move(expressionAction)), specialOperationListAction(std::move(specialOperationListAction)),
+        blockAction(std::move(blockAction)) {}
+    void Handle(Statement& type) {
+        type.Accept(*this);
+    }
+    void Visit(StatementDefineVariable& type) override {
+        expressionAction(type.expression);
+    }
+    void Visit(StatementDefineFunction& type) override {}
+    void Visit(StatementAssignmentId& type) override {
+        expressionAction(type.expression);
+    }
+    void Visit(StatementAssignmentArray& type) override {
+        specialOperationListAction(type.specialOperationList);
+        expressionAction(type.index);
+        expressionAction(type.expression);
+    }
+    void Visit(StatementAssignmentField& type) override {
+        specialOperationListAction(type.specialOperationList);
+        expressionAction(type.expression);
+    }
+    void Visit(StatementCall& type) override {
+        specialOperationListAction(type.specialOperationList);
+    }
+    void Visit(StatementIf& type) override {
+        expressionAction(type.condition);
+        blockAction(type.ifBlock);
+        blockAction(type.elseBlock);
+    }
+    void Visit(StatementWhile& type) override {
+        expressionAction(type.condition);
+        blockAction(type.whileBlock);
+    }
+    void Visit(StatementBreak& type) override {}
+    void Visit(StatementContinue& type) override {}
+    void Visit(StatementReturn& type) override {
+        expressionAction(type.expression);
+    }
+private:
+    function<void(unique_ptr<Expression>&)> expressionAction;
+    function<void(unique_ptr<SpecialOperationList>&)> specialOperationListAction;
+    function<void(StatementBlock&)> blockAction;
+};
+
+/*
+    ûкõıʽ (ѭ )
+    rename еıʱ滻Ϊµ
+*/
+class ExpressionClone : public AbstractSyntaxVisitor {
+public:
+    ExpressionClone() {}
+    ExpressionClone(map<wstring, wstring> rename) : rename(std::move(rename)) {}
+    unique_ptr<Expression> Handle(Expression& type) {
+        type.Accept(*this);
+        result->line = type.line;
+        return std::move(result);
+    }
+    template<typename T>
+    void CloneBinary(T& type) {
+        auto p = make_unique<T>();
+        p->left = ExpressionClone(rename).Handle(*type.left);
+        p->right = ExpressionClone(rename).Handle(*type.right);
+        result = std::move(p);
+    }
+    void Visit(Or& type) override { CloneBinary(type); }
+    void Visit(And& type) override { CloneBinary(type); }
+    void Visit(Equals& type) override { CloneBinary(type); }
+    void Visit(NotEquals& type) override { CloneBinary(type); }
+    void Visit(Less& type) override { CloneBinary(type); }
+    void Visit(LessEquals& type) override { CloneBinary(type); }
+    void Visit(Greater& type) override { CloneBinary(type); }
+    void Visit(GreaterEquals& type) override { CloneBinary(type); }
+    void Visit(Add& type) override { CloneBinary(type); }
+    void Visit(Subtract& type) override { CloneBinary(type); }
+    void Visit(Multiply& type) override { CloneBinary(type); }
+    void Visit(Divide& type) override { CloneBinary(type); }
+    void Visit(Modulus& type) override { CloneBinary(type); }
+    void Visit(Not& type) override {
+        auto p = make_unique<Not>();
+        p->expression = ExpressionClone(rename).Handle(*type.expression);
+        result = std::move(p);
+    }
+    void Visit(Null& type) override {
+        result = make_unique<Null>();
+    }
+    void Visit(Bool& type) override {
+        auto p = make_unique<Bool>();
+        p->value = type.value;
+        result = std::move(p);
+    }
+    void Visit(Char& type) override {
+        auto p = make_unique<Char>();
+        p->value = type.value;
+        result = std::move(p);
+    }
+    void Visit(Int& type) override {
+        auto p = make_unique<Int>();
+        p->value = type.value;
+        result = std::move(p);
+    }
+    void Visit(Float& type) override {
+        auto p = make_unique<Float>();
+        p->value = type.value;
+        result = std::move(p);
+    }
+    void Visit(String& type) override {
+        auto p = make_unique<String>();
+        p->value = type.value;
+        result = std::move(p);
+    }
+    void Visit(Array& type) override {
+        auto p = make_unique<Array>();
+        p->length = ExpressionClone(rename).Handle(*type.length);
+        result = std::move(p);
+    }
+    void Visit(Object& type) override {
+        result = make_unique<Object>();
+    }
+    void Visit(SpecialOperationList& type) override {
+        auto p = make_unique<SpecialOperationList>();
+        auto find = rename.find(type.id);
+        p->id = find == rename.end() ? type.id : find->second;
+        for (auto& item : type.specialOperations) {
+            item->Accept(*this);
+            specialOperation->line = item->line;
+            p->specialOperations.push_back(std::move(specialOperation));
+        }
+        result = std::move(p);
+    }
+    void Visit(AccessField& type) override {
+        auto p = make_unique<AccessField>();
+        p->id = type.id;
+        specialOperation = std::move(p);
+    }
+    void Visit(AccessArray& type) override {
+        auto p = make_unique<AccessArray>();
+        p->index = ExpressionClone(rename).Handle(*type.index);
+        specialOperation = std::move(p);
+    }
+private:
+    map<wstring, wstring> rename;
+    unique_ptr<Expression> result;
+    unique_ptr<SpecialOperation> specialOperation;
+};
+
+/*
+    ѭпܸıֵĲ 뺯 (ֻڵʱŻִ)
+*/
+struct LoopEffect {
+    set<wstring> assignedNames;
+    set<wstring> storedFields;
+    bool storeArray = false;
+    bool call = false;
+    //   ÿζᴴµڴ
+    bool allocate = false;
+};
+
+class LoopEffectProcess : public AbstractSyntaxVisitor {
+public:
+    LoopEffectProcess(LoopEffect& effect) : effect(effect) {}
+    void HandleExpression(Expression& type) {
+        type.Accept(*this);
+        ExpressionChildren([this](unique_ptr<Expression>& item) {
+            LoopEffectProcess(effect).HandleExpression(*item);
+        }).Handle(type);
+    }
+    void HandleBlock(StatementBlock& type) {
+        for (auto& item : type.statements) {
+            HandleStatement(*item);
+        }
+    }
+    void HandleStatement(Statement& type) {
+        type.Accept(*this);
+        StatementChildren([this](unique_ptr<Expression>& item) {
+            LoopEffectProcess(effect).HandleExpression(*item);
+        }, [this](unique_ptr<SpecialOperationList>& item) {
+            LoopEffectProcess(effect).HandleExpression(*item);
+        }, [this](StatementBlock& item) {
+            LoopEffectProcess(effect).HandleBlock(item);
+        }).Handle(type);
+    }
+    void VisitExpression(Expression& type) override {}
+    void VisitBinaryOperation(BinaryOperation& type) override {}
+    void VisitUnaryOperation(UnaryOperation& type) override {}
+    void Visit(Array& type) override {
+        effect.allocate = true;
+    }
+    void Visit(Object& type) override {
+        effect.allocate = true;
+    }
+    void Visit(Function& type) override {
+        effect.allocate = true;
+    }
+    void Visit(SpecialOperationList& type) override {
+        for (auto& item : type.specialOperations) {
+            if (typeid(*item) == typeid(FunctionCall)) {
+                effect.call = true;
+            }
+        }
+    }
+    void VisitStatement(Statement& type) override {}
+    void Visit(StatementDefineVariable& type) override {
+        effect.assignedNames.insert(type.id);
+    }
+    void Visit(StatementDefineFunction& type) override {
+        effect.assignedNames.insert(type.id);
+        effect.allocate = true;
+    }
+    void Visit(StatementAssignmentId& type) override {
+        effect.assignedNames.insert(type.id);
+    }
+    void Visit(StatementAssignmentArray& type) override {
+        effect.storeArray = true;
+    }
+    void Visit(StatementAssignmentField& type) override {
+        effect.storedFields.insert(type.field);
+    }
+private:
+    LoopEffect& effect;
+};
+
+/*
+    һӦһ ¼ǰɼľֲ
+    հеֵܱݹ޸(ݹùհ) ѭеʱΪ
+*/
+class LoopInvariantEnvironment {
+public:
+    LoopInvariantEnvironment(int32_t& temporaryCount) : temporaryCount(temporaryCount) {
+        scopes.push_back(set<wstring>());
+    }
+    void EnterBlock() {
+        scopes.push_back(set<wstring>());
+    }
+    void ExitBlock() {
+        scopes.pop_back();
+    }
+    void DefineVariable(const wstring& idName) {
+        scopes.back().insert(idName);
+    }
+    bool IsLocal(const wstring& idName) const {
+        for (auto& scope : scopes) {
+            if (scope.find(idName) != scope.end()) {
+                return true;
+            }
+        }
+        return false;
+    }
+    wstring NewTemporary() {
+        wstring name = L"#licm" + to_wstring(temporaryCount);
+        temporaryCount += 1;
+        return name;
+    }
+private:
+    int32_t& temporaryCount;
+    vector<set<wstring>> scopes;
+};
+
+/*
+    ʽṹӦַ ֵַͬͬ
+    ǲؿ
+*/
+class InvariantKeyProcess : public AbstractSyntaxVisitor {
+public:
+    InvariantKeyProcess(const LoopEffect& effect, const LoopInvariantEnvironment& environment) : effect(effect), environment(environment) {}
+    optional<wstring> Handle(Expression& type) {
+        type.Accept(*this);
+        return std::move(key);
+    }
+    void VisitBinaryOperation(BinaryOperation& type) override {
+        auto left = InvariantKeyProcess(effect, environment).Handle(*type.left);
+        auto right = InvariantKeyProcess(effect, environment).Handle(*type.right);
+        if (left.has_value() && right.has_value()) {
+            key = L"(" + to_wstring(type_index(typeid(type)).hash_code()) + L" " + left.value() + L" " + right.value() + L")";
+        }
+    }
+    void Visit(Not& type) override {
+        auto expression = InvariantKeyProcess(effect, environment).Handle(*type.expression);
+        if (expression.has_value()) {
+            key = L"(! " + expression.value() + L")";
+        }
+    }
+    void Visit(Null& type) override {
+        key = L"null";
+    }
+    void Visit(Bool& type) override {
+        key = type.value ? L"true" : L"false";
+    }
+    void Visit(Char& type) override {
+        key = L"c" + to_wstring(static_cast<int32_t>(type.value));
+    }
+    void Visit(Int& type) override {
+        key = L"i" + to_wstring(type.value);
+    }
+    void Visit(Float& type) override {
+        int32_t bits;
+        std::memcpy(&bits, &type.value, sizeof(bits));
+        key = L"f" + to_wstring(bits);
+    }
+    void Visit(String& type) override {
+        key = L"s" + to_wstring(type.value.size()) + L":" + type.value;
+    }
+    void Visit(Array& type) override {}
+    void Visit(Object& type) override {}
+    void Visit(Function& type) override {}
+    void Visit(SpecialOperationList& type) override {
+        if (effect.assignedNames.find(type.id) != effect.assignedNames.end()) {
+            return;
+        }
+        if (effect.call && environment.IsLocal(type.id) == false) {
+            return;
+        }
+        wstring result = type.id;
+        for (auto& item : type.specialOperations) {
+            if (auto field = dynamic_cast<AccessField*>(item.get())) {
+                if (effect.call || effect.storedFields.find(field->id) != effect.storedFields.end()) {
+                    return;
+                }
+                result += L"." + field->id;
+            } else if (auto array = dynamic_cast<AccessArray*>(item.get())) {
+                if (effect.call || effect.storeArray) {
+                    return;
+                }
+                auto index = InvariantKeyProcess(effect, environment).Handle(*array->index);
+                if (index.has_value() == false) {
+                    return;
+                }
+                result += L"[" + index.value() + L"]";
+            } else {
+                return;
+            }
+        }
+        key = L"v" + result;
+    }
+private:
+    optional<wstring> key;
+    const LoopEffect& effect;
+    const LoopInvariantEnvironment& environment;
+};
+
+/*
+    ֻͷֵ ıҪ
+*/
+bool LoopInvariantWorth(Expression& type) {
+    if (dynamic_cast<BinaryOperation*>(&type) != nullptr) {
+        return true;
+    }
+    if (auto list = dynamic_cast<SpecialOperationList*>(&type)) {
+        return list->specialOperations.empty() == false;
+    }
+    return false;
+}
+
+class LoopInvariantTransform {
+public:
+    LoopInvariantTransform(LoopInvariantEnvironment& environment) : environment(environment) {}
+    void Handle(unique_ptr<Statement>& statement) {
+        auto& type = static_cast<StatementWhile&>(*statement);
+        LoopEffectProcess(effect).HandleExpression(*type.condition);
+        //Ҫѭǰһ ûи
+        if (effect.call || effect.allocate) {
+            return;
+        }
+        LoopEffectProcess(effect).HandleBlock(type.whileBlock);
+
+        //ֻÿѭһִеĲѡ ⲿ׳쳣ʱԭѭҲһ׳
+        Collect(type.condition);
+        for (auto& item : type.whileBlock.statements) {
+            if (MustExecute(*item) == false) {
+                break;
+            }
+            StatementChildren([this](unique_ptr<Expression>& item) {
+                Collect(item);
+            }, [this](unique_ptr<SpecialOperationList>& item) {
+                Collect(item);
+            }, [](StatementBlock& item) {}).Handle(*item);
+        }
+        if (order.empty()) {
+            return;
+        }
+
+        auto guard = make_unique<StatementIf>();
+        guard->line = type.line;
+        guard->condition = ExpressionClone().Handle(*type.condition);
+
+        Replace(type.condition);
+        ReplaceBlock(type.whileBlock);
+
+        for (auto& key : order) {
+            auto& [name, expression] = temporaries[key];
+            if (expression == nullptr) {
+                throw CompilerError();
+            }
+            auto define = make_unique<StatementDefineVariable>();
+            define->line = expression->line;
+            define->id = name;
+            define->expression = std::move(expression);
+            guard->ifBlock.statements.push_back(std::move(define));
+        }
+        guard->ifBlock.statements.push_back(std::move(statement));
+        statement = std::move(guard);
+    }
+private:
+    bool MustExecute(Statement& type) {
+        bool assignment = dynamic_cast<StatementDefineVariable*>(&type) != nullptr
+            || dynamic_cast<StatementAssignmentId*>(&type) != nullptr
+            || dynamic_cast<StatementAssignmentArray*>(&type) != nullptr
+            || dynamic_cast<StatementAssignmentField*>(&type) != nullptr;
+        if (assignment == false) {
+            return false;
+        }
+        LoopEffect statementEffect;
+        LoopEffectProcess(statementEffect).HandleStatement(type);
+        return statementEffect.call == false;
+    }
+    template<typename T>
+    void Collect(unique_ptr<T>& type) {
+        auto key = InvariantKeyProcess(effect, environment).Handle(*type);
+        if (key.has_value() && LoopInvariantWorth(*type)) {
+            if (temporaries.find(key.value()) == temporaries.end()) {
+                temporaries.insert(pair(key.value(), pair(environment.NewTemporary(), unique_ptr<Expression>())));
+                order.push_back(key.value());
+            }
+            return;
+        }
+        //·ұ߲һִ
+        if (auto binary = dynamic_cast<BinaryOperation*>(type.get())) {
+            if (typeid(*binary) == typeid(Or) || typeid(*binary) == typeid(And)) {
+                Collect(binary->left);
+                return;
+            }
+        }
+        ExpressionChildren([this](unique_ptr<Expression>& item) {
+            Collect(item);
+        }).Handle(*type);
+    }
+    template<typename T>
+    void Replace(unique_ptr<T>& type) {
+        auto key = InvariantKeyProcess(effect, environment).Handle(*type);
+        if (key.has_value()) {
+            auto find = temporaries.find(key.value());
+            if (find != temporaries.end()) {
+                auto& [name, expression] = find->second;
+                auto temporary = make_unique<SpecialOperationList>();
+                temporary->line = type->line;
+                temporary->id = name;
+                if (expression == nullptr) {
+                    expression = std::move(type);
+                }
+                type = std::move(temporary);
+                return;
+            }
+        }
+        ExpressionChildren([this](unique_ptr<Expression>& item) {
+            Replace(item);
+        }).Handle(*type);
+    }
+    void ReplaceBlock(StatementBlock& type) {
+        for (auto& statement : type.statements) {
+            StatementChildren([this](unique_ptr<Expression>& item) {
+                Replace(item);
+            }, [this](unique_ptr<SpecialOperationList>& item) {
+                Replace(item);
+            }, [this](StatementBlock& item) {
+                ReplaceBlock(item);
+            }).Handle(*statement);
+        }
+    }
+    LoopInvariantEnvironment& environment;
+    LoopEffect effect;
+    vector<wstring> order;
+    map<wstring, pair<wstring, unique_ptr<Expression>>> temporaries;
+};
+
+class FunctionLoopInvariant {
+public:
+    FunctionLoopInvariant(int32_t& temporaryCount) : environment(temporaryCount), temporaryCount(temporaryCount) {}
+    void Handle(StatementBlock& type, const vector<wstring>& idList);
+private:
+    LoopInvariantEnvironment environment;
+    int32_t& temporaryCount;
+};
+
+class StatementLoopInvariant : public AbstractSyntaxVisitor {
+public:
+    StatementLoopInvariant(LoopInvariantEnvironment& environment, int32_t& temporaryCount)
+        : environment(environment), temporaryCount(temporaryCount) {}
+    void Handle(unique_ptr<Statement>& type) {
+        type->Accept(*this);
+        if (dynamic_cast<StatementWhile*>(type.get()) != nullptr) {
+            LoopInvariantTransform(environment).Handle(type);
+        }
+    }
+    void HandleBlock(StatementBlock& type) {
+        environment.EnterBlock();
+        for (auto& item : type.statements) {
+            StatementLoopInvariant(environment, temporaryCount).Handle(item);
+        }
+        environment.ExitBlock();
+    }
+    void HandleExpression(Expression& type) {
+        FunctionLiteralProcess([this](Function& item) {
+            FunctionLoopInvariant(temporaryCount).Handle(item.functionBlock, item.idList);
+        }).Handle(type);
+    }
+    void Visit(StatementDefineVariable& type) override {
+        HandleExpression(*type.expression);
+        environment.DefineVariable(type.id);
+    }
+    void Visit(StatementDefineFunction& type) override {
+        environment.DefineVariable(type.id);
+        FunctionLoopInvariant(temporaryCount).Handle(type.functionBlock, type.idList);
+    }
+    void VisitStatement(Statement& type) override {
+        StatementChildren([this](unique_ptr<Expression>& item) {
+            HandleExpression(*item);
+        }, [this](unique_ptr<SpecialOperationList>& item) {
+            HandleExpression(*item);
+        }, [this](StatementBlock& item) {
+            HandleBlock(item);
+        }).Handle(type);
+    }
+private:
+    LoopInvariantEnvironment& environment;
+    int32_t& temporaryCount;
+};
+
+void FunctionLoopInvariant::Handle(StatementBlock& type, const vector<wstring>& idList) {
+    for (auto& idName : idList) {
+        environment.DefineVariable(idName);
+    }
+    for (auto& item : type.statements) {
+        StatementLoopInvariant(environment, temporaryCount).Handle(item);
+    }
+}
+
+void LoopInvariantCodeMotion(MainBlock& root) {
+    int32_t temporaryCount = 0;
+    FunctionLoopInvariant(temporaryCount).Handle(root, vector<wstring>());
+}
+
+/*
+    f(...) ʽĵ  f ǵǰ
+*/
+bool IsSelfCall(Expression& type, const wstring& name) {
+    auto list = dynamic_cast<SpecialOperationList*>(&type);
+    if (list == nullptr || list->id != name || list->specialOperations.size() != 1) {
+        return false;
+    }
+    return dynamic_cast<FunctionCall*>(list->specialOperations[0].get()) != nullptr;
+}
+
+bool IsReturnNull(Statement& type) {
+    auto ret = dynamic_cast<StatementReturn*>(&type);
+    return ret != nullptr && dynamic_cast<Null*>(ret->expression.get()) != nullptr;
+}
+
+/*
+    е name ʼָ е return Ϊ null  return name(...)
+*/
+class ReturnNullProcess : public AbstractSyntaxVisitor {
+public:
+    ReturnNullProcess(const wstring& name) : name(name), result(true) {}
+    bool Handle(StatementBlock& type) {
+        for (auto& item : type.statements) {
+            item->Accept(*this);
+            StatementChildren([](unique_ptr<Expression>& item) {}, [](unique_ptr<SpecialOperationList>& item) {},
+                [this](StatementBlock& item) {
+                Handle(item);
+            }).Handle(*item);
+        }
+        return result;
+    }
+    void VisitStatement(Statement& type) override {}
+    void Visit(StatementDefineVariable& type) override {
+        Define(type.id);
+    }
+    void Visit(StatementDefineFunction& type) override {
+        Define(type.id);
+    }
+    void Visit(StatementAssignmentId& type) override {
+        Define(type.id);
+    }
+    void Visit(StatementReturn& type) override {
+        if (dynamic_cast<Null*>(type.expression.get()) == nullptr && IsSelfCall(*type.expression, name) == false) {
+            result = false;
+        }
+    }
+private:
+    void Define(const wstring& id) {
+        if (id == name) {
+            result = false;
+        }
+    }
+    const wstring& name;
+    bool result;
+};
+
+struct TailCallEnvironment {
+    set<const FunctionCall*>& tailCalls;
+    //ǰ û
+    optional<wstring> name;
+    //ǰĽһ null
+    bool returnNull = false;
+};
+
+void TailCallFunction(set<const FunctionCall*>& tailCalls, StatementBlock& type, optional<wstring> name, const vector<wstring>& idList);
+
+class TailCallStatement : public AbstractSyntaxVisitor {
+public:
+    TailCallStatement(TailCallEnvironment& environment, bool tail) : environment(environment), tail(tail) {}
+    void Handle(Statement& type) {
+        type.Accept(*this);
+    }
+    // return null ֮ǰ Լ β if  β
+    void HandleBlock(StatementBlock& type, bool blockTail) {
+        auto& statements = type.statements;
+        for (size_t i = 0; i < statements.size(); i++) {
+            bool statementTail = (i + 1 == statements.size() && blockTail)
+                || (i + 2 == statements.size() && IsReturnNull(*statements[i + 1]));
+            TailCallStatement(environment, statementTail).Handle(*statements[i]);
+        }
+    }
+    void HandleExpression(Expression& type) {
+        FunctionLiteralProcess([this](Function& item) {
+            TailCallFunction(environment.tailCalls, item.functionBlock, optional<wstring>(), item.idList);
+        }).Handle(type);
+    }
+    void Visit(StatementDefineFunction& type) override {
+        TailCallFunction(environment.tailCalls, type.functionBlock, type.id, type.idList);
+    }
+    void Visit(StatementCall& type) override {
+        HandleExpression(*type.specialOperationList);
+        if (tail && environment.returnNull && IsSelfCall(*type.specialOperationList, environment.name.value())) {
+            environment.tailCalls.insert(static_cast<FunctionCall*>(type.specialOperationList->specialOperations[0].get()));
+        }
+    }
+    void Visit(StatementIf& type) override {
+        HandleExpression(*type.condition);
+        HandleBlock(type.ifBlock, tail);
+        HandleBlock(type.elseBlock, tail);
+    }
+    void Visit(StatementWhile& type) override {
+        HandleExpression(*type.condition);
+        HandleBlock(type.whileBlock, false);
+    }
+    void Visit(StatementReturn& type) override {
+        HandleExpression(*type.expression);
+        if (auto list = dynamic_cast<SpecialOperationList*>(type.expression.get())) {
+            if (list->specialOperations.empty() == false) {
+                if (auto call = dynamic_cast<FunctionCall*>(list->specialOperations.back().get())) {
+                    environment.tailCalls.insert(call);
+                }
+            }
+        }
+    }
+    void VisitStatement(Statement& type) override {
+        StatementChildren([this](unique_ptr<Expression>& item) {
+            HandleExpression(*item);
+        }, [this](unique_ptr<SpecialOperationList>& item) {
+            HandleExpression(*item);
+        }, [](StatementBlock& item) {}).Handle(type);
+    }
+private:
+    TailCallEnvironment& environment;
+    bool tail;
+};
+
+void TailCallFunction(set<const FunctionCall*>& tailCalls, StatementBlock& type, optional<wstring> name, const vector<wstring>& idList) {
+    TailCallEnvironment environment{ tailCalls, name };
+    if (name.has_value() && std::find(idList.begin(), idList.end(), name.value()) == idList.end()) {
+        environment.returnNull = ReturnNullProcess(name.value()).Handle(type);
+    }
+    TailCallStatement(environment, false).HandleBlock(type, false);
+}
+
+set<const FunctionCall*> TailCallAnalysis(MainBlock& root) {
+    set<const FunctionCall*> tailCalls;
+    TailCallFunction(tailCalls, root, optional<wstring>(), vector<wstring>());
+    return tailCalls;
+}
+
+void TailCallAnalysisFunction(FunctionBlock& type, const vector<wstring>& idList, set<const FunctionCall*>& tailCalls) {
+    TailCallFunction(tailCalls, type, optional<wstring>(), idList);
+}
+
+/*
+    definitions бĴ (   ע)
+    assigned ¸ֵ
+    ֻһβûб¸ֵ ܿĵطͬһֵ
+*/
+struct InlineNameInfo {
+    map<wstring, int32_t> definitions;
+    set<wstring> assigned;
+    bool IsConstant(const wstring& idName) const {
+        auto find = definitions.find(idName);
+        return find != definitions.end() && find->second == 1 && assigned.find(idName) == assigned.end();
+    }
+};
+
+class InlineNameProcess : public AbstractSyntaxVisitor {
+public:
+    InlineNameProcess(InlineNameInfo& info) : info(info) {}
+    void HandleFunction(StatementBlock& type, const vector<wstring>& idList) {
+        for (auto& idName : idList) {
+            Define(idName);
+        }
+        HandleBlock(type);
+    }
+    void HandleBlock(StatementBlock& type) {
+        for (auto& item : type.statements) {
+            item->Accept(*this);
+            StatementChildren([this](unique_ptr<Expression>& item) {
+                HandleExpression(*item);
+            }, [this](unique_ptr<SpecialOperationList>& item) {
+                HandleExpression(*item);
+            }, [this](StatementBlock& item) {
+                HandleBlock(item);
+            }).Handle(*item);
+        }
+    }
+    void HandleExpression(Expression& type) {
+        type.Accept(*this);
+        ExpressionChildren([this](unique_ptr<Expression>& item) {
+            HandleExpression(*item);
+        }).Handle(type);
+    }
+    void VisitStatement(Statement& type) override {}
+    void VisitExpression(Expression& type) override {}
+    void VisitBinaryOperation(BinaryOperation& type) override {}
+    void VisitUnaryOperation(UnaryOperation& type) override {}
+    void Visit(StatementDefineVariable& type) override {
+        Define(type.id);
+    }
+    void Visit(StatementDefineFunction& type) override {
+        Define(type.id);
+        HandleFunction(type.functionBlock, type.idList);
+    }
+    void Visit(StatementAssignmentId& type) override {
+        info.assigned.insert(type.id);
+    }
+    void Visit(Function& type) override {
+        HandleFunction(type.functionBlock, type.idList);
+    }
+private:
+    void Define(const wstring& idName) {
+        info.definitions[idName] += 1;
+    }
+    InlineNameInfo& info;
+};
+
+/*
+    ͳƺĴС ֺ ĺ岻
+*/
+class InlineBodyProcess : public AbstractSyntaxVisitor {
+public:
+    InlineBodyProcess() : size(0), valid(true) {}
+    void Handle(Expression& type) {
+        size += 1;
+        type.Accept(*this);
+        ExpressionChildren([this](unique_ptr<Expression>& item) {
+            Handle(*item);
+        }).Handle(type);
+    }
+    bool Valid() {
+        return valid && size <= inlineSizeMax;
+    }
+    void VisitExpression(Expression& type) override {}
+    void VisitBinaryOperation(BinaryOperation& type) override {}
+    void VisitUnaryOperation(UnaryOperation& type) override {}
+    void Visit(Function& type) override {
+        valid = false;
+    }
+    void Visit(SpecialOperationList& type) override {
+        for (auto& item : type.specialOperations) {
+            size += 1;
+            if (typeid(*item) == typeid(FunctionCall)) {
+                valid = false;
+            }
+        }
+    }
+private:
+    int32_t size;
+    bool valid;
+};
+
+/*
+    ĺ
+    1.ͺõıհеֵֻһ ûб¸ֵ (ôֵ뺯ʱֵͬ)
+    2.Ϊ var   return ûк (Ҳݹ)
+*/
+bool InlineCandidate(StatementDefineFunction& type, const InlineNameInfo& info) {
+    if (info.IsConstant(type.id) == false) {
+        return false;
+    }
+    for (auto& idName : type.functionBlock.closure) {
+        if (idName == type.id || info.IsConstant(idName) == false) {
+            return false;
+        }
+    }
+    auto& statements = type.functionBlock.statements;
+    InlineBodyProcess body;
+    for (size_t i = 0; i < statements.size(); i++) {
+        if (i + 1 == statements.size()) {
+            auto ret = dynamic_cast<StatementReturn*>(statements[i].get());
+            if (ret == nullptr) {
+                return false;
+            }
+            body.Handle(*ret->expression);
+        } else {
+            auto define = dynamic_cast<StatementDefineVariable*>(statements[i].get());
+            if (define == nullptr) {
+                return false;
+            }
+            body.Handle(*define->expression);
+        }
+    }
+    return body.Valid();
+}
+
+/*
+    һӦһ candidates ΪǰѾĿĺ
+    ֻڶ庯ĺڲ (ﺯõıհеֵһԷ)
+*/
+struct InlineEnvironment {
+    const InlineNameInfo& info;
+    int32_t& inlineCount;
+    map<wstring, StatementDefineFunction*> candidates;
+};
+
+/*
+    ֵ˳һеıʽ ĺ֮ǰִ
+    Ĵûк ֻ֮ǰûִйʱǰ (ÿ޸Ķ )
+    ·ұ߲һִ 
+*/
+class InlineCallProcess {
+public:
+    InlineCallProcess(InlineEnvironment& environment, vector<unique_ptr<Statement>>& prefix)
+        : environment(environment), prefix(prefix), callSeen(false) {}
+    template<typename T>
+    void Handle(unique_ptr<T>& type, bool conditional) {
+        if (auto binary = dynamic_cast<BinaryOperation*>(type.get())) {
+            bool shortCircuit = typeid(*binary) == typeid(Or) || typeid(*binary) == typeid(And);
+            Handle(binary->left, conditional);
+            Handle(binary->right, conditional || shortCircuit);
+        } else if (auto unary = dynamic_cast<UnaryOperation*>(type.get())) {
+            Handle(unary->expression, conditional);
+        } else if (auto array = dynamic_cast<Array*>(type.get())) {
+            Handle(array->length, conditional);
+        } else if (auto list = dynamic_cast<SpecialOperationList*>(type.get())) {
+            auto& operations = list->specialOperations;
+            size_t begin = 0;
+            auto call = operations.empty() ? nullptr : dynamic_cast<FunctionCall*>(operations[0].get());
+            if (call != nullptr) {
+                HandleCall(*call, conditional);
+                auto function = FindCandidate(*list, *call);
+                if (conditional || callSeen || function == nullptr) {
+                    callSeen = true;
+                    begin = 1;
+                } else {
+                    wstring name = L"#inline" + to_wstring(environment.inlineCount);
+                    environment.inlineCount += 1;
+                    auto result = Inline(*function, *call, name, list->line);
+                    operations.erase(operations.begin());
+                    if constexpr (std::is_same_v<T, Expression>) {
+                        if (operations.empty()) {
+                            type = std::move(result);
+                            return;
+                        }
+                    }
+                    //кĲ ȱڱ
+                    auto define = make_unique<StatementDefineVariable>();
+                    define->line = result->line;
+                    define->id = name;
+                    define->expression = std::move(result);
+                    prefix.push_back(std::move(define));
+                    list->id = name;
+                }
+            }
+            for (size_t i = begin; i < operations.size(); i++) {
+                if (auto call = dynamic_cast<FunctionCall*>(operations[i].get())) {
+                    HandleCall(*call, conditional);
+                    callSeen = true;
+                } else if (auto array = dynamic_cast<AccessArray*>(operations[i].get())) {
+                    Handle(array->index, conditional);
+                }
+            }
+        }
+    }
+private:
+    void HandleCall(FunctionCall& type, bool conditional) {
+        for (auto& item : type.expressionList) {
+            Handle(item, conditional);
+        }
+    }
+    StatementDefineFunction* FindCandidate(SpecialOperationList& list, FunctionCall& call) {
+        auto find = environment.candidates.find(list.id);
+        if (find == environment.candidates.end() || find->second->idList.size() != call.expressionList.size()) {
+            return nullptr;
+        }
+        return find->second;
+    }
+    //ͺеıΪ name_  return ıʽ
+    unique_ptr<Expression> Inline(StatementDefineFunction& function, FunctionCall& call, const wstring& name, int line) {
+        map<wstring, wstring> rename;
+        for (size_t i = 0; i < function.idList.size(); i++) {
+            rename[function.idList[i]] = name + L"_" + function.idList[i];
+            auto define = make_unique<StatementDefineVariable>();
+            define->line = line;
+            define->id = rename[function.idList[i]];
+            define->expression = std::move(call.expressionList[i]);
+            prefix.push_back(std::move(define));
+        }
+        auto& statements = function.functionBlock.statements;
+        for (size_t i = 0; i + 1 < statements.size(); i++) {
+            auto& source = static_cast<StatementDefineVariable&>(*statements[i]);
+            auto define = make_unique<StatementDefineVariable>();
+            define->line = source.line;
+            define->expression = ExpressionClone(rename).Handle(*source.expression);
+            rename[source.id] = name + L"_" + source.id;
+            define->id = rename[source.id];
+            prefix.push_back(std::move(define));
+        }
+        auto& ret = static_cast<StatementReturn&>(*statements.back());
+        return ExpressionClone(rename).Handle(*ret.expression);
+    }
+    InlineEnvironment& environment;
+    vector<unique_ptr<Statement>>& prefix;
+    bool callSeen;
+};
+
+void FunctionInlineBlock(InlineEnvironment& environment, StatementBlock& type);
+
+void FunctionInlineFunction(const InlineNameInfo& info, int32_t& inlineCount, StatementBlock& type) {
+    InlineEnvironment environment{ info, inlineCount };
+    FunctionInlineBlock(environment, type);
+}
+
+class FunctionInlineStatement : public AbstractSyntaxVisitor {
+public:
+    FunctionInlineStatement(InlineEnvironment& environment, vector<unique_ptr<Statement>>& prefix)
+        : environment(environment), call(environment, prefix) {}
+    void Handle(Statement& type) {
+        //ȴĺ ƶĴк󲻻ٱ
+        auto literal = FunctionLiteralProcess([this](Function& item) {
+            FunctionInlineFunction(environment.info, environment.inlineCount, item.functionBlock);
+        });
+        StatementChildren([&](unique_ptr<Expression>& item) {
+            literal.Handle(*item);
+        }, [&](unique_ptr<SpecialOperationList>& item) {
+            literal.Handle(*item);
+        }, [](StatementBlock& item) {}).Handle(type);
+        type.Accept(*this);
+    }
+    void Visit(StatementDefineFunction& type) override {
+        FunctionInlineFunction(environment.info, environment.inlineCount, type.functionBlock);
+        if (InlineCandidate(type, environment.info)) {
+            environment.candidates[type.id] = &type;
+        }
+    }
+    //ѭÿѭִ ܷѭ֮ǰ
+    void Visit(StatementWhile& type) override {
+        FunctionInlineBlock(environment, type.whileBlock);
+    }
+    void VisitStatement(Statement& type) override {
+        StatementChildren([this](unique_ptr<Expression>& item) {
+            call.Handle(item, false);
+        }, [this](unique_ptr<SpecialOperationList>& item) {
+            call.Handle(item, false);
+        }, [this](StatementBlock& item) {
+            FunctionInlineBlock(environment, item);
+        }).Handle(type);
+    }
+private:
+    InlineEnvironment& environment;
+    InlineCallProcess call;
+};
+
+void FunctionInlineBlock(InlineEnvironment& environment, StatementBlock& type) {
+    auto& statements = type.statements;
+    for (size_t i = 0; i < statements.size(); i++) {
+        vector<unique_ptr<Statement>> prefix;
+        FunctionInlineStatement(environment, prefix).Handle(*statements[i]);
+        statements.insert(statements.begin() + i, std::make_move_iterator(prefix.begin()), std::make_move_iterator(prefix.end()));
+        i += prefix.size();
+    }
+}
+
+void FunctionInline(MainBlock& root) {
+    InlineNameInfo info;
+    for (auto& idName : root.closure) {
+        info.definitions[idName] += 1;
+    }
+    InlineNameProcess(info).HandleFunction(root, vector<wstring>());
+    int32_t inlineCount = 0;
+    FunctionInlineFunction(info, inlineCount, root);
+}
+
+/*
+    ±ַ ֻ  Լǵ names ¼õı
+*/
+class AccessIndexKeyProcess : public AbstractSyntaxVisitor {
+public:
+    AccessIndexKeyProcess(set<wstring>& names) : names(names) {}
+    optional<wstring> Handle(Expression& type) {
+        type.Accept(*this);
+        return std::move(key);
+    }
+    void VisitBinaryOperation(BinaryOperation& type) override {
+        auto left = AccessIndexKeyProcess(names).Handle(*type.left);
+        auto right = AccessIndexKeyProcess(names).Handle(*type.right);
+        if (left.has_value() && right.has_value()) {
+            key = L"(" + to_wstring(type_index(typeid(type)).hash_code()) + L" " + left.value() + L" " + right.value() + L")";
+        }
+    }
+    void Visit(Not& type) override {
+        auto expression = AccessIndexKeyProcess(names).Handle(*type.expression);
+        if (expression.has_value()) {
+            key = L"(! " + expression.value() + L")";
+        }
+    }
+    void Visit(Bool& type) override {
+        key = type.value ? L"true" : L"false";
+    }
+    void Visit(Char& type) override {
+        key = L"c" + to_wstring(static_cast<int32_t>(type.value));
+    }
+    void Visit(Int& type) override {
+        key = L"i" + to_wstring(type.value);
+    }
+    void Visit(SpecialOperationList& type) override {
+        if (type.specialOperations.empty()) {
+            names.insert(type.id);
+            key = L"v" + type.id;
+        }
+    }
+    void VisitExpression(Expression& type) override {}
+private:
+    optional<wstring> key;
+    set<wstring>& names;
+};
+
+/*
+     a.b[i].c õı ֶ Ƿ жϸֵǷʧЧ
+*/
+struct AccessChain {
+    set<wstring> names;
+    set<wstring> fields;
+    bool array = false;
+};
+
+/*
+    һ˳ִе Ĺǰ׺ֻһ  #cseN 
+    var x = a.b.c.x + a.b.c.y; => var #cse0 = a.b.c; var x = #cse0.x + #cse0.y;
+    һͳÿǰ׺ֵĴ ڶѳֶεǰ׺滻Ϊ
+    ֵ ֶθֵ 鸳ֵ õǵǰ׺ʧЧ  if while ǰ׺ʧЧ
+    ͬ ֻûִйʱ ܰǰ׺ļŵ֮ǰ
+*/
+class CommonSubexpressionBlock {
+public:
+    CommonSubexpressionBlock(int32_t& temporaryCount) : temporaryCount(temporaryCount), counting(true), callSeen(false) {}
+    void Handle(StatementBlock& type) {
+        for (auto& item : type.statements) {
+            HandleNested(*item);
+        }
+        counting = true;
+        Run(type);
+        counting = false;
+        generations.clear();
+        chains.clear();
+        Run(type);
+    }
+private:
+    template<typename T>
+    void Handle(unique_ptr<T>& type, bool conditional) {
+        if (auto binary = dynamic_cast<BinaryOperation*>(type.get())) {
+            bool shortCircuit = typeid(*binary) == typeid(Or) || typeid(*binary) == typeid(And);
+            Handle(binary->left, conditional);
+            Handle(binary->right, conditional || shortCircuit);
+        } else if (auto unary = dynamic_cast<UnaryOperation*>(type.get())) {
+            Handle(unary->expression, conditional);
+        } else if (auto array = dynamic_cast<Array*>(type.get())) {
+            Handle(array->length, conditional);
+        } else if (auto list = dynamic_cast<SpecialOperationList*>(type.get())) {
+            HandleList(*list, conditional);
+        }
+    }
+    //if while е  
+    void HandleNested(Statement& type) {
+        auto literal = FunctionLiteralProcess([this](Function& item) {
+            CommonSubexpressionBlock(temporaryCount).Handle(item.functionBlock);
+        });
+        StatementChildren([&](unique_ptr<Expression>& item) {
+            literal.Handle(*item);
+        }, [&](unique_ptr<SpecialOperationList>& item) {
+            literal.Handle(*item);
+        }, [this](StatementBlock& item) {
+            CommonSubexpressionBlock(temporaryCount).Handle(item);
+        }).Handle(type);
+        if (auto define = dynamic_cast<StatementDefineFunction*>(&type)) {
+            CommonSubexpressionBlock(temporaryCount).Handle(define->functionBlock);
+        }
+    }
+    void Run(StatementBlock& type) {
+        auto& statements = type.statements;
+        for (size_t i = 0; i < statements.size(); i++) {
+            auto& statement = *statements[i];
+            callSeen = false;
+            prefix.clear();
+            if (dynamic_cast<StatementWhile*>(&statement) != nullptr) {
+                InvalidateAll();
+                continue;
+            }
+            if (auto statementIf = dynamic_cast<StatementIf*>(&statement)) {
+                Handle(statementIf->condition, false);
+                InvalidateAll();
+            } else {
+                StatementChildren([this](unique_ptr<Expression>& item) {
+                    Handle(item, false);
+                }, [this](unique_ptr<SpecialOperationList>& item) {
+                    Handle(item, false);
+                }, [](StatementBlock& item) {}).Handle(statement);
+                Effect(statement);
+            }
+            statements.insert(statements.begin() + i, std::make_move_iterator(prefix.begin()), std::make_move_iterator(prefix.end()));
+            i += prefix.size();
+        }
+    }
+    //ִ֮Ӱ
+    void Effect(Statement& type) {
+        if (auto define = dynamic_cast<StatementDefineVariable*>(&type)) {
+            InvalidateName(define->id);
+        } else if (auto define = dynamic_cast<StatementDefineFunction*>(&type)) {
+            InvalidateName(define->id);
+        } else if (auto assignment = dynamic_cast<StatementAssignmentId*>(&type)) {
+            InvalidateName(assignment->id);
+        } else if (auto assignment = dynamic_cast<StatementAssignmentField*>(&type)) {
+            InvalidateField(assignment->field);
+        } else if (dynamic_cast<StatementAssignmentArray*>(&type) != nullptr) {
+            InvalidateArray();
+        } else if (dynamic_cast<StatementCall*>(&type) == nullptr) {
+            InvalidateAll();
+        }
+    }
+    void HandleList(SpecialOperationList& type, bool conditional) {
+        auto& operations = type.specialOperations;
+        //ǰ׺ a.b a.b.c ... ַ û޷Ƚϵ±Ϊֹ
+        vector<wstring> keys;
+        AccessChain chain;
+        chain.names.insert(type.id);
+        wstring key = L"v" + type.id;
+        for (auto& item : operations) {
+            if (auto field = dynamic_cast<AccessField*>(item.get())) {
+                chain.fields.insert(field->id);
+                key += L"." + field->id;
+            } else if (auto array = dynamic_cast<AccessArray*>(item.get())) {
+                auto index = AccessIndexKeyProcess(chain.names).Handle(*array->index);
+                if (index.has_value() == false) {
+                    break;
+                }
+                chain.array = true;
+                key += L"[" + index.value() + L"]";
+            } else {
+                break;
+            }
+            chains[key] = chain;
+            keys.push_back(key);
+        }
+        if (counting) {
+            for (auto& item : keys) {
+                counts[Generation(item)] += 1;
+            }
+        } else {
+            for (size_t length = keys.size(); length > 0; length--) {
+                auto current = Generation(keys[length - 1]);
+                if (counts[current] < 2) {
+                    continue;
+                }
+                auto find = temporaries.find(current);
+                if (find == temporaries.end()) {
+                    if (conditional || callSeen) {
+                        continue;
+                    }
+                    wstring name = L"#cse" + to_wstring(temporaryCount);
+                    temporaryCount += 1;
+                    auto access = make_unique<SpecialOperationList>();
+                    access->line = type.line;
+                    access->id = type.id;
+                    std::move(operations.begin(), operations.begin() + length, std::back_inserter(access->specialOperations));
+                    auto define = make_unique<StatementDefineVariable>();
+                    define->line = type.line;
+                    define->id = name;
+                    define->expression = std::move(access);
+                    prefix.push_back(std::move(define));
+                    find = temporaries.insert(pair(current, name)).first;
+                }
+                type.id = find->second;
+                operations.erase(operations.begin(), operations.begin() + length);
+                break;
+            }
+        }
+        for (auto& item : operations) {
+            if (auto call = dynamic_cast<FunctionCall*>(item.get())) {
+                for (auto& expression : call->expressionList) {
+                    Handle(expression, conditional);
+                }
+                callSeen = true;
+                InvalidateAll();
+            } else if (auto array = dynamic_cast<AccessArray*>(item.get())) {
+                Handle(array->index, conditional);
+            }
+        }
+    }
+    //ʧЧ֮ͬһǰ׺ʹµı õ֮ǰı
+    wstring Generation(const wstring& key) {
+        return key + L"#" + to_wstring(generations[key]);
+    }
+    void InvalidateAll() {
+        for (auto& [key, chain] : chains) {
+            generations[key] += 1;
+        }
+    }
+    void InvalidateName(const wstring& idName) {
+        for (auto& [key, chain] : chains) {
+            if (chain.names.find(idName) != chain.names.end()) {
+                generations[key] += 1;
+            }
+        }
+    }
+    void InvalidateField(const wstring& field) {
+        for (auto& [key, chain] : chains) {
+            if (chain.fields.find(field) != chain.fields.end()) {
+                generations[key] += 1;
+            }
+        }
+    }
+    void InvalidateArray() {
+        for (auto& [key, chain] : chains) {
+            if (chain.array) {
+                generations[key] += 1;
+            }
+        }
+    }
+    int32_t& temporaryCount;
+    bool counting;
+    bool callSeen;
+    map<wstring, int32_t> generations;
+    map<wstring, AccessChain> chains;
+    map<wstring, int32_t> counts;
+    map<wstring, wstring> temporaries;
+    vector<unique_ptr<Statement>> prefix;
+};
+
+void CommonSubexpressionElimination(MainBlock& root) {
+    int32_t temporaryCount = 0;
+    CommonSubexpressionBlock(temporaryCount).Handle(root);
+}
+
+/*
+    Ա滻ľֲ var p = object;  var p = array[];
+    fields õֶ
+*/
+struct ScalarCandidate {
+    StatementDefineVariable* define = nullptr;
+    bool array = false;
+    int32_t length = 0;
+    set<wstring> fields;
+    bool valid = true;
+    wstring name;
+    wstring ScalarName(const wstring& field) const {
+        return name + L"_" + field;
+    }
+    wstring ScalarName(int32_t index) const {
+        return name + L"_" + to_wstring(index);
+    }
+};
+
+optional<int32_t> IntLiteral(Expression& type) {
+    auto value = dynamic_cast<Int*>(&type);
+    if (value == nullptr) {
+        return optional<int32_t>();
+    }
+    return value->value;
+}
+
+/*
+    ͳƺ(ڲ)ÿֵĶ ҵѡĶ 
+*/
+class ScalarCandidateProcess : public AbstractSyntaxVisitor {
+public:
+    ScalarCandidateProcess(map<wstring, int32_t>& definitions, map<wstring, ScalarCandidate>& candidates)
+        : definitions(definitions), candidates(candidates) {}
+    void HandleBlock(StatementBlock& type) {
+        for (auto& item : type.statements) {
+            item->Accept(*this);
+            StatementChildren([](unique_ptr<Expression>& item) {}, [](unique_ptr<SpecialOperationList>& item) {},
+                [this](StatementBlock& item) {
+                HandleBlock(item);
+            }).Handle(*item);
+        }
+    }
+    void VisitStatement(Statement& type) override {}
+    void Visit(StatementDefineVariable& type) override {
+        definitions[type.id] += 1;
+        ScalarCandidate candidate;
+        candidate.define = &type;
+        if (dynamic_cast<Object*>(type.expression.get()) != nullptr) {
+            candidates[type.id] = candidate;
+        } else if (auto array = dynamic_cast<Array*>(type.expression.get())) {
+            auto length = IntLiteral(*array->length);
+            if (length.has_value() && length.value() >= 1 && length.value() <= scalarArrayMax) {
+                candidate.array = true;
+                candidate.length = length.value();
+                candidates[type.id] = candidate;
+            }
+        }
+    }
+    void Visit(StatementDefineFunction& type) override {
+        definitions[type.id] += 1;
+    }
+private:
+    map<wstring, int32_t>& definitions;
+    map<wstring, ScalarCandidate>& candidates;
+};
+
+/*
+    ִ˳ѡÿһʹ
+    ֻ p.f  p.f = e ȡֶα·Ѿֵ (ԭ׳쳣)
+    ֻ p[]  p[] = e ±ڷΧ
+    ʹ (Ϊֵ ֵ ڲ) Ϊ
+    assigned ΪÿڵǰλһѾֵֶ
+*/
+class ScalarUseProcess : public AbstractSyntaxVisitor {
+public:
+    ScalarUseProcess(map<wstring, ScalarCandidate>& candidates) : candidates(candidates) {}
+    void HandleBlock(StatementBlock& type) {
+        for (auto& item : type.statements) {
+            item->Accept(*this);
+        }
+    }
+    void HandleExpression(Expression& type) {
+        type.Accept(*this);
+        ExpressionChildren([this](unique_ptr<Expression>& item) {
+            HandleExpression(*item);
+        }).Handle(type);
+    }
+    void VisitExpression(Expression& type) override {}
+    void VisitBinaryOperation(BinaryOperation& type) override {}
+    void VisitUnaryOperation(UnaryOperation& type) override {}
+    void Visit(Function& type) override {
+        Capture(type.functionBlock.closure);
+    }
+    void Visit(SpecialOperationList& type) override {
+        auto candidate = Find(type.id);
+        if (candidate == nullptr) {
+            return;
+        }
+        if (type.specialOperations.empty()) {
+            candidate->valid = false;
+        } else if (auto field = dynamic_cast<AccessField*>(type.specialOperations[0].get())) {
+            auto fields = assigned.find(type.id);
+            if (candidate->array || fields == assigned.end() || fields->second.find(field->id) == fields->second.end()) {
+                candidate->valid = false;
+            }
+        } else if (auto array = dynamic_cast<AccessArray*>(type.specialOperations[0].get())) {
+            CheckIndex(*candidate, type.id, *array->index);
+        } else {
+            candidate->valid = false;
+        }
+    }
+    void Visit(StatementDefineVariable& type) override {
+        HandleExpression(*type.expression);
+        auto candidate = Find(type.id);
+        if (candidate != nullptr && candidate->define == &type) {
+            assigned[type.id] = set<wstring>();
+        }
+    }
+    void Visit(StatementDefineFunction& type) override {
+        Capture(type.functionBlock.closure);
+    }
+    void Visit(StatementAssignmentId& type) override {
+        HandleExpression(*type.expression);
+        if (auto candidate = Find(type.id)) {
+            candidate->valid = false;
+        }
+    }
+    void Visit(StatementAssignmentArray& type) override {
+        auto candidate = Find(type.specialOperationList->id);
+        if (candidate != nullptr && type.specialOperationList->specialOperations.empty()) {
+            CheckIndex(*candidate, type.specialOperationList->id, *type.index);
+        } else {
+            HandleExpression(*type.specialOperationList);
+            HandleExpression(*type.index);
+        }
+        HandleExpression(*type.expression);
+    }
+    void Visit(StatementAssignmentField& type) override {
+        auto candidate = Find(type.specialOperationList->id);
+        HandleExpression(*type.expression);
+        if (candidate != nullptr && type.specialOperationList->specialOperations.empty()) {
+            if (candidate->array || InScope(type.specialOperationList->id) == false) {
+                candidate->valid = false;
+                return;
+            }
+            candidate->fields.insert(type.field);
+            assigned[type.specialOperationList->id].insert(type.field);
+        } else {
+            HandleExpression(*type.specialOperationList);
+        }
+    }
+    void Visit(StatementCall& type) override {
+        HandleExpression(*type.specialOperationList);
+    }
+    void Visit(StatementIf& type) override {
+        HandleExpression(*type.condition);
+        auto begin = assigned;
+        HandleBlock(type.ifBlock);
+        auto ifEnd = std::move(assigned);
+        assigned = std::move(begin);
+        HandleBlock(type.elseBlock);
+        //ֵֶ֧
+        map<wstring, set<wstring>> end;
+        for (auto& [idName, fields] : assigned) {
+            auto find = ifEnd.find(idName);
+            if (find == ifEnd.end()) {
+                continue;
+            }
+            auto& result = end[idName];
+            for (auto& field : fields) {
+                if (find->second.find(field) != find->second.end()) {
+                    result.insert(field);
+                }
+            }
+        }
+        assigned = std::move(end);
+    }
+    //ѭһζִ
+    void Visit(StatementWhile& type) override {
+        HandleExpression(*type.condition);
+        auto begin = assigned;
+        HandleBlock(type.whileBlock);
+        assigned = std::move(begin);
+    }
+    void Visit(StatementBreak& type) override {}
+    void Visit(StatementContinue& type) override {}
+    void Visit(StatementReturn& type) override {
+        HandleExpression(*type.expression);
+    }
+private:
+    ScalarCandidate* Find(const wstring& idName) {
+        auto find = candidates.find(idName);
+        return find == candidates.end() ? nullptr : &find->second;
+    }
+    //뿪ڵ֮ ͬǱհеֵ
+    bool InScope(const wstring& idName) {
+        return assigned.find(idName) != assigned.end();
+    }
+    void CheckIndex(ScalarCandidate& candidate, const wstring& idName, Expression& index) {
+        auto value = IntLiteral(index);
+        if (candidate.array == false || InScope(idName) == false || value.has_value() == false || value.value() < 0 || value.value() >= candidate.length) {
+            candidate.valid = false;
+        }
+    }
+    void Capture(const set<wstring>& closure) {
+        for (auto& idName : closure) {
+            if (auto candidate = Find(idName)) {
+                candidate->valid = false;
+            }
+        }
+    }
+    map<wstring, ScalarCandidate>& candidates;
+    map<wstring, set<wstring>> assigned;
+};
+
+/*
+    Ѻѡʹ滻Ϊ
+*/
+class ScalarTransform {
+public:
+    ScalarTransform(map<wstring, ScalarCandidate>& candidates) : candidates(candidates) {}
+    void HandleBlock(StatementBlock& type) {
+        vector<unique_ptr<Statement>> statements;
+        for (auto& item : type.statements) {
+            HandleStatement(item, statements);
+        }
+        type.statements = std::move(statements);
+    }
+private:
+    void HandleStatement(unique_ptr<Statement>& type, vector<unique_ptr<Statement>>& statements) {
+        if (auto define = dynamic_cast<StatementDefineVariable*>(type.get())) {
+            auto candidate = Find(define->id);
+            if (candidate != nullptr && candidate->define == define) {
+                if (candidate->array) {
+                    for (int32_t i = 0; i < candidate->length; i++) {
+                        statements.push_back(DefineNull(candidate->ScalarName(i), define->line));
+                    }
+                } else {
+                    for (auto& field : candidate->fields) {
+                        statements.push_back(DefineNull(candidate->ScalarName(field), define->line));
+                    }
+                }
+                return;
+            }
+        } else if (auto assignment = dynamic_cast<StatementAssignmentField*>(type.get())) {
+            auto candidate = Find(assignment->specialOperationList->id);
+            if (candidate != nullptr && assignment->specialOperationList->specialOperations.empty()) {
+                Handle(assignment->expression);
+                statements.push_back(Assign(candidate->ScalarName(assignment->field), std::move(assignment->expression), assignment->line));
+                return;
+            }
+        } else if (auto assignment = dynamic_cast<StatementAssignmentArray*>(type.get())) {
+            auto candidate = Find(assignment->specialOperationList->id);
+            if (candidate != nullptr && assignment->specialOperationList->specialOperations.empty()) {
+                Handle(assignment->expression);
+                auto index = IntLiteral(*assignment->index).value();
+                statements.push_back(Assign(candidate->ScalarName(index), std::move(assignment->expression), assignment->line));
+                return;
+            }
+        }
+        StatementChildren([this](unique_ptr<Expression>& item) {
+            Handle(item);
+        }, [this](unique_ptr<SpecialOperationList>& item) {
+            Handle(item);
+        }, [this](StatementBlock& item) {
+            HandleBlock(item);
+        }).Handle(*type);
+        statements.push_back(std::move(type));
+    }
+    template<typename T>
+    void Handle(unique_ptr<T>& type) {
+        if (auto list = dynamic_cast<SpecialOperationList*>(type.get())) {
+            auto candidate = Find(list->id);
+            if (candidate != nullptr) {
+                auto& operations = list->specialOperations;
+                if (auto field = dynamic_cast<AccessField*>(operations[0].get())) {
+                    list->id = candidate->ScalarName(field->id);
+                } else {
+                    auto& array = static_cast<AccessArray&>(*operations[0]);
+                    list->id = candidate->ScalarName(IntLiteral(*array.index).value());
+                }
+                operations.erase(operations.begin());
+            }
+        }
+        ExpressionChildren([this](unique_ptr<Expression>& item) {
+            Handle(item);
+        }).Handle(*type);
+    }
+    unique_ptr<Statement> DefineNull(const wstring& idName, int line) {
+        auto define = make_unique<StatementDefineVariable>();
+        define->line = line;
+        define->id = idName;
+        define->expression = make_unique<Null>();
+        define->expression->line = line;
+        return std::move(define);
+    }
+    unique_ptr<Statement> Assign(const wstring& idName, unique_ptr<Expression> expression, int line) {
+        auto assignment = make_unique<StatementAssignmentId>();
+        assignment->line = line;
+        assignment->id = idName;
+        assignment->expression = std::move(expression);
+        return std::move(assignment);
+    }
+    ScalarCandidate* Find(const wstring& idName) {
+        auto find = candidates.find(idName);
+        return find == candidates.end() ? nullptr : &find->second;
+    }
+    map<wstring, ScalarCandidate>& candidates;
+};
+
+void ScalarReplacementFunction(StatementBlock& type, const vector<wstring>& idList, int32_t& scalarCount);
+
+/*
+    ڲ
+*/
+class ScalarFunctionProcess : public AbstractSyntaxVisitor {
+public:
+    ScalarFunctionProcess(int32_t& scalarCount) : scalarCount(scalarCount) {}
+    void HandleBlock(StatementBlock& type) {
+        auto literal = FunctionLiteralProcess([this](Function& item) {
+            ScalarReplacementFunction(item.functionBlock, item.idList, scalarCount);
+        });
+        for (auto& item : type.statements) {
+            if (auto define = dynamic_cast<StatementDefineFunction*>(item.get())) {
+                ScalarReplacementFunction(define->functionBlock, define->idList, scalarCount);
+            }
+            StatementChildren([&](unique_ptr<Expression>& item) {
+                literal.Handle(*item);
+            }, [&](unique_ptr<SpecialOperationList>& item) {
+                literal.Handle(*item);
+            }, [this](StatementBlock& item) {
+                HandleBlock(item);
+            }).Handle(*item);
+        }
+    }
+private:
+    int32_t& scalarCount;
+};
+
+void ScalarReplacementFunction(StatementBlock& type, const vector<wstring>& idList, int32_t& scalarCount) {
+    ScalarFunctionProcess(scalarCount).HandleBlock(type);
+
+    map<wstring, int32_t> definitions;
+    map<wstring, ScalarCandidate> candidates;
+    for (auto& idName : idList) {
+        definitions[idName] += 1;
+    }
+    ScalarCandidateProcess(definitions, candidates).HandleBlock(type);
+    ScalarUseProcess(candidates).HandleBlock(type);
+
+    map<wstring, ScalarCandidate> result;
+    for (auto& [idName, candidate] : candidates) {
+        if (candidate.valid && definitions[idName] == 1) {
+            candidate.name = L"#sra" + to_wstring(scalarCount);
+            scalarCount += 1;
+            result.insert(pair(idName, std::move(candidate)));
+        }
+    }
+    if (result.empty() == false) {
+        ScalarTransform(result).HandleBlock(type);
+    }
+}
+
+void ScalarReplacement(MainBlock& root) {
+    int32_t scalarCount = 0;
+    ScalarReplacementFunction(root, vector<wstring>(), scalarCount);
+}
+
+int32_t captureReadMin = 2;
+
+/*
+     (ڲ) ÿʽλ
+    listAction 滻Ϊʽλ (ֵ )
+    loop ʾǷѭ
+*/
+class ExpressionSlotProcess {
+public:
+    ExpressionSlotProcess(function<void(unique_ptr<Expression>&, bool)> action, function<void(SpecialOperationList&, bool)> listAction)
+        : action(std::move(action)), listAction(std::move(listAction)) {}
+    void HandleBlock(StatementBlock& type, bool loop) {
+        for (auto& item : type.statements) {
+            bool inWhile = loop || typeid(*item) == typeid(StatementWhile);
+            StatementChildren([&](unique_ptr<Expression>& item) {
+                HandleExpression(item, inWhile);
+            }, [&](unique_ptr<SpecialOperationList>& item) {
+                listAction(*item, inWhile);
+                ExpressionChildren([&](unique_ptr<Expression>& item) {
+                    HandleExpression(item, inWhile);
+                }).Handle(*item);
+            }, [&](StatementBlock& item) {
+                HandleBlock(item, inWhile);
+            }).Handle(*item);
+        }
+    }
+private:
+    void HandleExpression(unique_ptr<Expression>& type, bool loop) {
+        action(type, loop);
+        ExpressionChildren([&](unique_ptr<Expression>& item) {
+            HandleExpression(item, loop);
+        }).Handle(*type);
+    }
+    function<void(unique_ptr<Expression>&, bool)> action;
+    function<void(SpecialOperationList&, bool)> listAction;
+};
+
+/*
+    ֱӶĺ ( ) Щĺ
+    name Ϊĺ
+*/
+void NestedFunctionProcess(StatementBlock& type, function<void(FunctionBlock&, const vector<wstring>&, optional<wstring>)> action) {
+    auto literal = FunctionLiteralProcess([&](Function& item) {
+        action(item.functionBlock, item.idList, optional<wstring>());
+    });
+    for (auto& item : type.statements) {
+        if (auto define = dynamic_cast<StatementDefineFunction*>(item.get())) {
+            action(define->functionBlock, define->idList, define->id);
+        }
+        StatementChildren([&](unique_ptr<Expression>& item) {
+            literal.Handle(*item);
+        }, [&](unique_ptr<SpecialOperationList>& item) {
+            literal.Handle(*item);
+        }, [&](StatementBlock& item) {
+            NestedFunctionProcess(item, action);
+        }).Handle(*item);
+    }
+}
+
+//вεڲ
+void AllNestedFunctionProcess(StatementBlock& type, const function<void(FunctionBlock&)>& action) {
+    NestedFunctionProcess(type, [&](FunctionBlock& item, const vector<wstring>& idList, optional<wstring> name) {
+        action(item);
+        AllNestedFunctionProcess(item, action);
+    });
+}
+
+/*
+     (ڲ) ı
+*/
+class LiteralDefinitionProcess : public AbstractSyntaxVisitor {
+public:
+    LiteralDefinitionProcess(map<wstring, Expression*>& literals) : literals(literals) {}
+    void HandleBlock(StatementBlock& type) {
+        for (auto& item : type.statements) {
+            if (auto define = dynamic_cast<StatementDefineVariable*>(item.get())) {
+                define->expression->Accept(*this);
+                if (literal) {
+                    literals[define->id] = define->expression.get();
+                }
+            }
+            StatementChildren([](unique_ptr<Expression>& item) {}, [](unique_ptr<SpecialOperationList>& item) {},
+                [this](StatementBlock& item) {
+                HandleBlock(item);
+            }).Handle(*item);
+        }
+    }
+    void VisitExpression(Expression& type) override {
+        literal = false;
+    }
+    void VisitBinaryOperation(BinaryOperation& type) override {
+        literal = false;
+    }
+    void VisitUnaryOperation(UnaryOperation& type) override {
+        literal = false;
+    }
+    void Visit(Null& type) override {
+        literal = true;
+    }
+    void Visit(Bool& type) override {
+        literal = true;
+    }
+    void Visit(Char& type) override {
+        literal = true;
+    }
+    void Visit(Int& type) override {
+        literal = true;
+    }
+    void Visit(Float& type) override {
+        literal = true;
+    }
+private:
+    bool literal = false;
+    map<wstring, Expression*>& literals;
+};
+
+/*
+    ֵ ֮󲻻ٸı ڲֱʹ ٷհ
+    1.ںֻһ (ڲҲûͬĶ) ûб¸ֵ
+    2.ڲֻȡֵ (û x.f x[i] x(...) Щ ʱһ ԭΪ)
+*/
+void ConstantCaptureFunction(StatementBlock& type, const vector<wstring>& idList, const set<wstring>& closure) {
+    InlineNameInfo info;
+    InlineNameProcess(info).HandleFunction(type, idList);
+    map<wstring, Expression*> literals;
+    LiteralDefinitionProcess(literals).HandleBlock(type);
+    for (auto iter = literals.begin(); iter != literals.end();) {
+        if (info.IsConstant(iter->first) && closure.find(iter->first) == closure.end()) {
+            iter++;
+        } else {
+            iter = literals.erase(iter);
+        }
+    }
+
+    auto remove = [&](SpecialOperationList& item, bool loop) {
+        literals.erase(item.id);
+    };
+    AllNestedFunctionProcess(type, [&](FunctionBlock& item) {
+        ExpressionSlotProcess([&](unique_ptr<Expression>& item, bool loop) {
+            auto list = dynamic_cast<SpecialOperationList*>(item.get());
+            if (list != nullptr && list->specialOperations.empty() == false) {
+                literals.erase(list->id);
+            }
+        }, remove).HandleBlock(item, false);
+    });
+
+    if (literals.empty() == false) {
+        AllNestedFunctionProcess(type, [&](FunctionBlock& item) {
+            ExpressionSlotProcess([&](unique_ptr<Expression>& item, bool loop) {
+                auto list = dynamic_cast<SpecialOperationList*>(item.get());
+                if (list == nullptr) {
+                    return;
+                }
+                auto find = literals.find(list->id);
+                if (find != literals.end()) {
+                    int line = item->line;
+                    item = ExpressionClone().Handle(*find->second);
+                    item->line = line;
+                }
+            }, [](SpecialOperationList& item, bool loop) {}).HandleBlock(item, false);
+            for (auto& [idName, literal] : literals) {
+                item.closure.erase(idName);
+            }
+        });
+    }
+
+    NestedFunctionProcess(type, [](FunctionBlock& item, const vector<wstring>& idList, optional<wstring> name) {
+        ConstantCaptureFunction(item, idList, item.closure);
+    });
+}
+
+/*
+    жζȡ (ѭжȡ) Ҳ޸ĵıհеֵ ںʼʱƵֲ
+    var #cap0 = x; ֮ȡֲ ÿηʱհ
+     עֲ ( غõʶ)
+*/
+void CaptureCopyFunction(StatementBlock& type, const vector<wstring>& idList, const set<wstring>& closure,
+    optional<wstring> name, const set<wstring>& registered, int32_t& captureCount) {
+    NestedFunctionProcess(type, [&](FunctionBlock& item, const vector<wstring>& idList, optional<wstring> name) {
+        CaptureCopyFunction(item, idList, item.closure, name, registered, captureCount);
+    });
+
+    InlineNameInfo info;
+    InlineNameProcess(info).HandleFunction(type, idList);
+    map<wstring, int32_t> reads;
+    auto count = [&](const wstring& idName, bool loop) {
+        if (closure.find(idName) != closure.end()) {
+            reads[idName] += loop ? captureReadMin : 1;
+        }
+    };
+    ExpressionSlotProcess([&](unique_ptr<Expression>& item, bool loop) {
+        if (auto list = dynamic_cast<SpecialOperationList*>(item.get())) {
+            count(list->id, loop);
+        }
+    }, [&](SpecialOperationList& item, bool loop) {
+        count(item.id, loop);
+    }).HandleBlock(type, false);
+
+    map<wstring, wstring> rename;
+    vector<unique_ptr<Statement>> defines;
+    for (auto& [idName, read] : reads) {
+        if (read < captureReadMin || idName == name || registered.find(idName) != registered.end()
+            || info.definitions[idName] != 0 || info.assigned.find(idName) != info.assigned.end()) {
+            continue;
+        }
+        rename[idName] = L"#cap" + to_wstring(captureCount);
+        captureCount += 1;
+        auto define = make_unique<StatementDefineVariable>();
+        define->line = type.line;
+        define->id = rename[idName];
+        auto list = make_unique<SpecialOperationList>();
+        list->line = type.line;
+        list->id = idName;
+        define->expression = std::move(list);
+        defines.push_back(std::move(define));
+    }
+    if (rename.empty()) {
+        return;
+    }
+    auto replace = [&](SpecialOperationList& item) {
+        auto find = rename.find(item.id);
+        if (find != rename.end()) {
+            item.id = find->second;
+        }
+    };
+    ExpressionSlotProcess([&](unique_ptr<Expression>& item, bool loop) {
+        if (auto list = dynamic_cast<SpecialOperationList*>(item.get())) {
+            replace(*list);
+        }
+    }, [&](SpecialOperationList& item, bool loop) {
+        replace(item);
+    }).HandleBlock(type, false);
+    type.statements.insert(type.statements.begin(), std::make_move_iterator(defines.begin()), std::make_move_iterator(defines.end()));
+}
+
+void ClosureCaptureAnalysis(MainBlock& root) {
+    ConstantCaptureFunction(root, vector<wstring>(), root.closure);
+    int32_t captureCount = 0;
+    CaptureCopyFunction(root, vector<wstring>(), set<wstring>(), optional<wstring>(), root.closure, captureCount);
+}
+
+
+/*
+    հеֵκʱ򴴽ͬĺ
+    1.ע ûͬĶ ûб¸ֵ
+    2.ĺ ûб¸ֵ (հеֵ)
+*/
+void StaticFunctionProcess(StatementBlock& type, const InlineNameInfo& info, const set<wstring>& registered,
+    set<const FunctionBlock*>& result) {
+    NestedFunctionProcess(type, [&](FunctionBlock& item, const vector<wstring>& idList, optional<wstring> name) {
+        bool valid = true;
+        for (auto& idName : item.closure) {
+            if (info.assigned.find(idName) != info.assigned.end()) {
+                valid = false;
+            } else if (idName == name) {
+                continue;
+            } else if (registered.find(idName) == registered.end() || info.definitions.find(idName) != info.definitions.end()) {
+                valid = false;
+            }
+        }
+        if (valid) {
+            result.insert(&item);
+        }
+        StaticFunctionProcess(item, info, registered, result);
+    });
+}
+
+set<const FunctionBlock*> StaticFunctionAnalysis(MainBlock& root) {
+    InlineNameInfo info;
+    InlineNameProcess(info).HandleFunction(root, vector<wstring>());
+    set<const FunctionBlock*> result;
+    StaticFunctionProcess(root, info, root.closure, result);
+    return result;
+}
+
+set<wstring> NativeFunctionAnalysis(MainBlock& root) {
+    InlineNameInfo info;
+    InlineNameProcess(info).HandleFunction(root, vector<wstring>());
+    set<wstring> result;
+    for (auto& idName : root.closure) {
+        if (info.definitions.find(idName) == info.definitions.end() && info.assigned.find(idName) == info.assigned.end()) {
+            result.insert(idName);
+        }
+    }
+    return result;
+}
+
+void SelfCallFunction(StatementBlock& type, const InlineNameInfo& info, set<const FunctionCall*>& result) {
+    NestedFunctionProcess(type, [&](FunctionBlock& item, const vector<wstring>& idList, optional<wstring> name) {
+        if (name.has_value() && info.IsConstant(name.value())) {
+            auto check = [&](SpecialOperationList& list) {
+                if (list.id != name.value() || list.specialOperations.empty()) {
+                    return;
+                }
+                auto call = dynamic_cast<FunctionCall*>(list.specialOperations[0].get());
+                if (call != nullptr && call->expressionList.size() == idList.size()) {
+                    result.insert(call);
+                }
+            };
+            ExpressionSlotProcess([&](unique_ptr<Expression>& item, bool loop) {
+                if (auto list = dynamic_cast<SpecialOperationList*>(item.get())) {
+                    check(*list);
+                }
+            }, [&](SpecialOperationList& item, bool loop) {
+                check(item);
+            }).HandleBlock(item, false);
+        }
+        SelfCallFunction(item, info, result);
+    });
+}
+
+set<const FunctionCall*> SelfCallAnalysis(MainBlock& root) {
+    InlineNameInfo info;
+    InlineNameProcess(info).HandleFunction(root, vector<wstring>());
+    set<const FunctionCall*> result;
+    SelfCallFunction(root, info, result);
+    return result;
+}
+
+map<wstring, InstructionEnum> IntrinsicAnalysis(MainBlock& root) {
+    static const map<wstring, InstructionEnum> intrinsics{
+        { L"ArrayLength", InstructionEnum::ArrayLength },
+        { L"ObjectFieldCount", InstructionEnum::ObjectFieldCount },
+        { L"TypeOf", InstructionEnum::TypeOf },
+        { L"CharToInt", InstructionEnum::CharToInt },
+        { L"IntToChar", InstructionEnum::IntToChar },
+    };
+    map<wstring, InstructionEnum> result;
+    for (auto& idName : NativeFunctionAnalysis(root)) {
+        auto find = intrinsics.find(idName);
+        if (find != intrinsics.end()) {
+            result.insert(*find);
+        }
+    }
+    return result;
+}
+
+void AllFunctionProcessBlock(StatementBlock& type,
+    const function<void(FunctionBlock&, const vector<wstring>&, optional<wstring>)>& functionAction,
+    const function<void(Expression&)>& expressionAction) {
+    ExpressionSlotProcess([&](unique_ptr<Expression>& item, bool loop) {
+        expressionAction(*item);
+    }, [](SpecialOperationList& item, bool loop) {}).HandleBlock(type, false);
+    NestedFunctionProcess(type, [&](FunctionBlock& item, const vector<wstring>& idList, optional<wstring> name) {
+        functionAction(item, idList, name);
+        AllFunctionProcessBlock(item, functionAction, expressionAction);
+    });
+}
+
+void AllFunctionProcess(MainBlock& root,
+    const function<void(FunctionBlock&, const vector<wstring>&, optional<wstring>)>& functionAction,
+    const function<void(Expression&)>& expressionAction) {
+    AllFunctionProcessBlock(root, functionAction, expressionAction);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include"AbstractSyntaxType.h"
+#include"CodeGenerate.h"
+#include<functional>
+#include<optional>
+#include<map>
+
+/*
+    ﷨ϵŻ ֮ ֮ǰ
+*/
+
+/*
+    հ Ż֮ǰ
+    1.ı岢Ҳٸı ڲֱʹ ٷհ (հΪ ٷ)
+    2.жζȡ (ѭжȡ) Ҳ޸ĵıհеֵ ںʼʱƵֲ
+*/
+void ClosureCaptureAnalysis(AbstractSyntax::MainBlock& root);
+
+/*
+    Сĺ ѭ֮ǰ
+    f(a, b) => var #inline0_x = a; var #inline0_y = b; ... е var ...  Ȼ return ıʽ
+    Ĵ뱣ек
+*/
+void FunctionInline(AbstractSyntax::MainBlock& root);
+
+/*
+    ݷ 滻 ֮
+    ֻںڲͨ p.f p[] ʵĶ  滻Ϊ ٷڴ
+    var p = object; p.x = 1; s = p.x; => var #sra0_x = null; #sra0_x = 1; s = #sra0_x;
+*/
+void ScalarReplacement(AbstractSyntax::MainBlock& root);
+
+/*
+    Ĺӱʽ ֮ ѭ֮ǰ
+    a.b.c.x = a.b.c.x + a.b.c.y => var #cse0 = a.b.c; #cse0.x = #cse0.x + #cse0.y
+*/
+void CommonSubexpressionElimination(AbstractSyntax::MainBlock& root);
+
+/*
+    ѭ
+    while(c){ ... e ... } => if(c){ var #licm0 = e; while(c){ ... #licm0 ... } }
+*/
+void LoopInvariantCodeMotion(AbstractSyntax::MainBlock& root);
+
+/*
+    β÷ еĵ TailCall õǰջ֡
+    1.return f(...)
+    2.f(...);  return null  f ǵǰ ǰе return Ϊ null  return f(...)
+      (ʱ f(...) Ľһ null  return null ͬ)
+*/
+set<const AbstractSyntax::FunctionCall*> TailCallAnalysis(AbstractSyntax::MainBlock& root);
+//ֻһ (еĺ)  tailCalls Ԥĺ֮ʹ ֪ 2
+void TailCallAnalysisFunction(AbstractSyntax::FunctionBlock& type, const vector<wstring>& idList, set<const AbstractSyntax::FunctionCall*>& tailCalls);
+
+/*
+    жĵ  CallSelf ֱʹõǰջ֡ıհ ȡհеĺ 
+    ֻһ ûб¸ֵ (еʼָ) ͬ
+    βĵȻ TailCall
+*/
+set<const AbstractSyntax::FunctionCall*> SelfCallAnalysis(AbstractSyntax::MainBlock& root);
+
+/*
+    Ԥȷĺ հΪ ֻע ĺ (ᱻ¸ֵ)
+    ʼʱյ Function ֵʱ LoadStaticFunction ֱȡ ٷհͺ
+    ͬһʽÿֵõĺͬ == Ľ O0 ͬ ( OptimizeLevel)
+*/
+set<const AbstractSyntax::FunctionBlock*> StaticFunctionAnalysis(AbstractSyntax::MainBlock& root);
+
+/*
+    ֱӵõıغ ע ûͬĶ ûб¸ֵ
+    ʱ CallNative ֱӵ ٶȡհ ټ LocalFunction
+*/
+set<wstring> NativeFunctionAnalysis(AbstractSyntax::MainBlock& root);
+
+/*
+    滻Ϊúָıغ  NativeFunctionAnalysis  Ϊ
+    ArrayLength ObjectFieldCount TypeOf CharToInt IntToChar
+    ֻһĵɶӦָ ΪֵʹʱȻעıغ (Ϊͬ)
+*/
+std::map<wstring, InstructionEnum> IntrinsicAnalysis(AbstractSyntax::MainBlock& root);
+
+/*
+    вεڲ ӳɴʱԤȷ䳣ͺ
+    functionAction ÿڲ name Ϊĺ
+    expressionAction ÿеÿʽ (ӱʽ)
+*/
+void AllFunctionProcess(AbstractSyntax::MainBlock& root,
+    const std::function<void(AbstractSyntax::FunctionBlock&, const vector<wstring>&, std::optional<wstring>)>& functionAction,
+    const std::function<void(AbstractSyntax::Expression&)>& expressionAction);
\ No newline at end of file
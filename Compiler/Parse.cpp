@@ -1165,17 +1165,36 @@ GenerateSATypeFunctionMap CreateDefaultGenerateSATypeFunctionMap() {
 
 class CreateParseTreeProcess {
 public:
-    CreateParseTreeProcess(const PredictiveParsingTable& table, const GenerateSATypeFunctionMap& generateMap, NotBlankLATypeResult&& result)
-        : table(table), generateMap(generateMap), terminalList(std::move(result)), index(0) {}
+    CreateParseTreeProcess(const PredictiveParsingTable& table, const GenerateSATypeFunctionMap& generateMap, NotBlankLATypeResult&& result, bool preParse)
+        : table(table), generateMap(generateMap), terminalList(std::move(result)), index(0), preParse(preParse) {}
     ParseTree operator()()&& {
         auto root = Recursive(table.start);
         return ParseTree(std::move(root));
     }
+    //սΪһ { ... }
+    unique_ptr<ParseType> StatementBlockRecursive() {
+        auto select = PredictiveParsingTableSelect(type_index(typeid(StatementBlock)), type_index(typeid(ParentheseBigLeft)));
+        auto find = table.table.find(select);
+        if (terminalList.resultList.empty() || find == table.table.end()) {
+            throw CompilerError();
+        }
+        auto result = Recursive(*find->second);
+        if (static_cast<size_t>(index) != terminalList.resultList.size()) {
+            throw ParseException(MessageHead(result->line) + "﷨");
+        }
+        return result;
+    }
     unique_ptr<ParseType> Recursive(const Production& production) {
         //ʽ
         //жϵǰ ս  
         auto ptr = generateMap.generateMap.find(production.head)->second();
         for (auto& item : production.result) {
+            //Ԥʱֻƥ
+            if (preParse && item == type_index(typeid(StatementBlock)) &&
+                (production.head == type_index(typeid(FunctionType)) || production.head == type_index(typeid(StatementDefineFunction)))) {
+                ptr->parseTypes.push_back(PreParseStatementBlock());
+                continue;
+            }
             //սֱͬӼ
             auto& iter = *terminalList.resultList[index];
             if (item == type_index(typeid(iter))) {
@@ -1197,15 +1216,38 @@ public:
         }
         return std::move(ptr);
     }
+    unique_ptr<ParseType> PreParseStatementBlock() {
+        auto ptr = make_unique<StatementBlock>();
+        ptr->preParsed = true;
+        ptr->line = terminalList.resultList[index]->line;
+        if (typeid(*terminalList.resultList[index]) != typeid(ParentheseBigLeft)) {
+            throw ParseException(MessageHead(ptr->line) + "﷨");
+        }
+        int depth = 0;
+        do {
+            auto& iter = *terminalList.resultList[index];
+            if (typeid(iter) == typeid(TextEnd)) {
+                throw ParseException(MessageHead(iter.line) + "Ųƥ");
+            } else if (typeid(iter) == typeid(ParentheseBigLeft)) {
+                depth += 1;
+            } else if (typeid(iter) == typeid(ParentheseBigRight)) {
+                depth -= 1;
+            }
+            ptr->parseTypes.push_back(std::move(terminalList.resultList[index]));
+            index += 1;
+        } while (depth != 0);
+        return std::move(ptr);
+    }
 private:
     const PredictiveParsingTable& table;
     const GenerateSATypeFunctionMap& generateMap;
     NotBlankLATypeResult terminalList;
     int index;
+    bool preParse;
 };
 
-ParseTree CreateParseTree(const PredictiveParsingTable& table, const GenerateSATypeFunctionMap& generateMap, NotBlankLATypeResult&& result) {
-    return CreateParseTreeProcess(table, generateMap, std::move(result))();
+ParseTree CreateParseTree(const PredictiveParsingTable& table, const GenerateSATypeFunctionMap& generateMap, NotBlankLATypeResult&& result, bool preParse) {
+    return CreateParseTreeProcess(table, generateMap, std::move(result), preParse)();
 }
 
 
@@ -1285,10 +1327,28 @@ public:
         return std::move(result);
     }
     void Visit(StatementBlock& type) override {
+        if (type.preParsed) {
+            PreParsed(type);
+            return;
+        }
         for (auto& item : type.parseTypes) {
             item->Accept(*this);
         }
     }
+    //սʱʹ ¼ڼհ
+    void PreParsed(StatementBlock& type) {
+        result.preParsed = make_unique<AbstractSyntax::PreParsedBlock>();
+        bool field = false;
+        for (auto& item : type.parseTypes) {
+            auto id = dynamic_cast<Id*>(item.get());
+            if (id != nullptr && field == false) {
+                result.preParsed->names.insert(id->value);
+            }
+            field = typeid(*item) == typeid(Period);
+            result.preParsed->tokens.push_back(unique_ptr<LAType>(static_cast<LAType*>(item.release())));
+        }
+        type.parseTypes.clear();
+    }
 private:
     AbstractSyntax::FunctionBlock result;
 };
@@ -2184,4 +2244,15 @@ RegisteredNameList CreateRegisteredNameList(const DFA& dfa, const vector<wstring
     return RegisteredNameList(std::move(nameList));
 }
 
-//------------------------------------------------------------------------------
\ No newline at end of file
+//------------------------------------------------------------------------------
+
+void CreatePreParsedFunctionBlock(const PredictiveParsingTable& table, const GenerateSATypeFunctionMap& generateMap, AbstractSyntax::FunctionBlock& functionBlock) {
+    if (functionBlock.preParsed == nullptr) {
+        throw CompilerError();
+    }
+    auto preParsed = std::move(functionBlock.preParsed);
+    auto block = CreateParseTreeProcess(table, generateMap, NotBlankLATypeResult(std::move(preParsed->tokens)), true).StatementBlockRecursive();
+    auto result = FunctionBlockBuilder()(*block);
+    functionBlock.statements = std::move(result.statements);
+    functionBlock.line = result.line;
+}
\ No newline at end of file
@@ -30,7 +30,10 @@ struct ParseTree;
 
 AbstractSyntaxTree CreateAbstractSyntaxTree(const ParseTree& parseTree);
 RegisteredNameList CreateRegisteredNameList(const DFA& dfa, const vector<wstring>& registeredNames);
-ParseTree CreateParseTree(const PredictiveParsingTable& table, const GenerateSATypeFunctionMap& generateMap, NotBlankLATypeResult&& result);
+//preParse Ϊ true ʱֻƥ ( Parse::StatementBlock)
+ParseTree CreateParseTree(const PredictiveParsingTable& table, const GenerateSATypeFunctionMap& generateMap, NotBlankLATypeResult&& result, bool preParse = false);
+//Ԥĺ﷨ ɺĳ﷨ еĺȻֻԤ
+void CreatePreParsedFunctionBlock(const PredictiveParsingTable& table, const GenerateSATypeFunctionMap& generateMap, AbstractSyntax::FunctionBlock& functionBlock);
 GenerateSATypeFunctionMap CreateDefaultGenerateSATypeFunctionMap();
 PredictiveParsingTable CreateDefaultPredictiveParsingTable();
 PredictiveParsingTable CreatePredictiveParsingTable(NullableFirstFollowTable&& table, vector<Production>&& productions, int startIndex);
@@ -245,7 +245,6 @@ namespace Parse {
 	DerivedSAType(StatementContinue);
 	DerivedSAType(StatementReturn);
 	DerivedSAType(StatementNext);
-	DerivedSAType(StatementBlock);
 	DerivedSAType(StatementNullable);
 	DerivedSAType(Statement);
 	DerivedSAType(Condition);
@@ -279,6 +278,14 @@ namespace Parse {
 	DerivedSAType(IdListNextNullable);
 #undef DerivedSAType
 
+	/*
+		preParsed Ϊ true ʱԤĺ ֻƥ˴ parseTypes Ϊ { ... } еս
+	*/
+	struct StatementBlock : public SAType {
+		virtual void Accept(ParseVisitor& visitor);
+		bool preParsed = false;
+	};
+
 	struct ParseVisitor {
 		~ParseVisitor() = default;
 		virtual void VisitParseType(ParseType& type);
@@ -0,0 +1,353 @@
+#include "TypeInference.h"
+#include "CompilerException.h"
+#include <optional>
+using std::optional;
+using std::pair;
+using namespace AbstractSyntax;
+
+/*
+    types вڵıʾδ֪
+    reachable == false ʾ break continue return ֮󲻿ɴĴ
+*/
+struct TypeState {
+    bool reachable = true;
+    map<int32_t, HeapEnum> types;
+};
+
+inline bool operator==(const TypeState& l, const TypeState& r) {
+    return l.reachable == r.reachable && l.types == r.types;
+}
+
+TypeState TypeStateJoin(const TypeState& l, const TypeState& r) {
+    if (l.reachable == false) {
+        return r;
+    }
+    if (r.reachable == false) {
+        return l;
+    }
+    TypeState result;
+    for (auto& [id, type] : l.types) {
+        auto find = r.types.find(id);
+        if (find != r.types.end() && find->second == type) {
+            result.types.insert(pair(id, type));
+        }
+    }
+    return result;
+}
+
+TypeState TypeStateUnreachable() {
+    TypeState state;
+    state.reachable = false;
+    return state;
+}
+
+struct TypeInferenceLoop {
+    vector<TypeState> breakStates;
+    vector<TypeState> continueStates;
+};
+
+/*
+    һӦһ  ʱұ˳һ
+    ǰҲıǱհеֵ δ֪
+*/
+class TypeInferenceEnvironment {
+public:
+    TypeInferenceEnvironment(TypeInferenceResult& result) : result(result), variableCount(0) {
+        scopes.push_back(map<wstring, int32_t>());
+    }
+    void EnterBlock() {
+        scopes.push_back(map<wstring, int32_t>());
+    }
+    void ExitBlock() {
+        for (auto& [idName, id] : scopes.back()) {
+            state.types.erase(id);
+        }
+        scopes.pop_back();
+    }
+    void DefineVariable(const wstring& idName, optional<HeapEnum> type) {
+        int32_t id = variableCount;
+        variableCount += 1;
+        scopes.back()[idName] = id;
+        SetType(id, type);
+    }
+    optional<int32_t> FindVariable(const wstring& idName) {
+        for (auto iter = scopes.rbegin(); iter < scopes.rend(); iter += 1) {
+            auto find = iter->find(idName);
+            if (find != iter->end()) {
+                return find->second;
+            }
+        }
+        return optional<int32_t>();
+    }
+    optional<HeapEnum> GetType(const wstring& idName) {
+        auto id = FindVariable(idName);
+        if (id.has_value() == false) {
+            return optional<HeapEnum>();
+        }
+        auto find = state.types.find(id.value());
+        if (find == state.types.end()) {
+            return optional<HeapEnum>();
+        }
+        return find->second;
+    }
+    void SetType(int32_t id, optional<HeapEnum> type) {
+        if (state.reachable && type.has_value()) {
+            state.types[id] = type.value();
+        } else {
+            state.types.erase(id);
+        }
+    }
+    //ѭеĴᱻ һ(Ѿȶ)ĽΪ׼
+    void SetOperandType(const BinaryOperation& type, optional<HeapEnum> operandType) {
+        if (state.reachable && operandType.has_value()) {
+            result.operandTypes[&type] = operandType.value();
+        } else {
+            result.operandTypes.erase(&type);
+        }
+    }
+public:
+    TypeInferenceResult& result;
+    TypeState state;
+    vector<TypeInferenceLoop> loops;
+private:
+    int32_t variableCount;
+    vector<map<wstring, int32_t>> scopes;
+};
+
+class FunctionBlockTypeInference {
+public:
+    FunctionBlockTypeInference(TypeInferenceResult& result) : environment(result) {}
+    void Handle(StatementBlock& type, const vector<wstring>& idList);
+private:
+    TypeInferenceEnvironment environment;
+};
+
+class ExpressionTypeInference : public AbstractSyntaxVisitor {
+public:
+    ExpressionTypeInference(TypeInferenceEnvironment& environment) : environment(environment) {}
+    optional<HeapEnum> Handle(Expression& type) {
+        type.Accept(*this);
+        return result;
+    }
+    //Int Int õ Int һ Float õ Float
+    void Arithmetic(BinaryOperation& type) {
+        auto left = ExpressionTypeInference(environment).Handle(*type.left);
+        auto right = ExpressionTypeInference(environment).Handle(*type.right);
+        environment.SetOperandType(type, SameNumber(left, right));
+        if (IsNumber(left) && IsNumber(right)) {
+            if (left == HeapEnum::Int && right == HeapEnum::Int) {
+                result = HeapEnum::Int;
+            } else {
+                result = HeapEnum::Float;
+            }
+        }
+    }
+    void Compare(BinaryOperation& type) {
+        auto left = ExpressionTypeInference(environment).Handle(*type.left);
+        auto right = ExpressionTypeInference(environment).Handle(*type.right);
+        environment.SetOperandType(type, SameNumber(left, right));
+    }
+    void Visit(Multiply& type) override {
+        Arithmetic(type);
+    }
+    void Visit(Divide& type) override {
+        Arithmetic(type);
+    }
+    void Visit(Modulus& type) override {
+        Arithmetic(type);
+    }
+    void Visit(Add& type) override {
+        Arithmetic(type);
+    }
+    void Visit(Subtract& type) override {
+        Arithmetic(type);
+    }
+    void Visit(Less& type) override {
+        Compare(type);
+    }
+    void Visit(LessEquals& type) override {
+        Compare(type);
+    }
+    void Visit(Greater& type) override {
+        Compare(type);
+    }
+    void Visit(GreaterEquals& type) override {
+        Compare(type);
+    }
+    void VisitBinaryOperation(BinaryOperation& type) override {
+        ExpressionTypeInference(environment).Handle(*type.left);
+        ExpressionTypeInference(environment).Handle(*type.right);
+    }
+    void VisitUnaryOperation(UnaryOperation& type) override {
+        ExpressionTypeInference(environment).Handle(*type.expression);
+    }
+    void Visit(SpecialOperationList& type) override;
+    void Visit(Null& type) override {}
+    void Visit(Bool& type) override {}
+    void Visit(Char& type) override {}
+    void Visit(Int& type) override {
+        result = HeapEnum::Int;
+    }
+    void Visit(Float& type) override {
+        result = HeapEnum::Float;
+    }
+    void Visit(String& type) override {}
+    void Visit(Array& type) override {
+        ExpressionTypeInference(environment).Handle(*type.length);
+    }
+    void Visit(Function& type) override {
+        FunctionBlockTypeInference(environment.result).Handle(type.functionBlock, type.idList);
+    }
+    void Visit(Object& type) override {}
+private:
+    static bool IsNumber(optional<HeapEnum> type) {
+        return type == HeapEnum::Int || type == HeapEnum::Float;
+    }
+    static optional<HeapEnum> SameNumber(optional<HeapEnum> left, optional<HeapEnum> right) {
+        if (IsNumber(left) && left == right) {
+            return left;
+        }
+        return optional<HeapEnum>();
+    }
+    optional<HeapEnum> result;
+    TypeInferenceEnvironment& environment;
+};
+
+class SpecialOperationTypeInference : public AbstractSyntaxVisitor {
+public:
+    SpecialOperationTypeInference(TypeInferenceEnvironment& environment) : environment(environment) {}
+    void Handle(SpecialOperation& type) {
+        type.Accept(*this);
+    }
+    void Visit(FunctionCall& type) override {
+        for (auto& item : type.expressionList) {
+            ExpressionTypeInference(environment).Handle(*item);
+        }
+    }
+    void Visit(AccessArray& type) override {
+        ExpressionTypeInference(environment).Handle(*type.index);
+    }
+    void Visit(AccessField& type) override {}
+private:
+    TypeInferenceEnvironment& environment;
+};
+
+void ExpressionTypeInference::Visit(SpecialOperationList& type) {
+    if (type.specialOperations.empty()) {
+        result = environment.GetType(type.id);
+    }
+    for (auto& item : type.specialOperations) {
+        SpecialOperationTypeInference(environment).Handle(*item);
+    }
+}
+
+class StatementTypeInference : public AbstractSyntaxVisitor {
+public:
+    StatementTypeInference(TypeInferenceEnvironment& environment) : environment(environment) {}
+    void Handle(Statement& type) {
+        type.Accept(*this);
+    }
+    void Block(StatementBlock& type) {
+        environment.EnterBlock();
+        for (auto& item : type.statements) {
+            StatementTypeInference(environment).Handle(*item);
+        }
+        environment.ExitBlock();
+    }
+    void Visit(StatementDefineVariable& type) override {
+        auto variableType = ExpressionTypeInference(environment).Handle(*type.expression);
+        environment.DefineVariable(type.id, variableType);
+    }
+    void Visit(StatementDefineFunction& type) override {
+        environment.DefineVariable(type.id, optional<HeapEnum>());
+        FunctionBlockTypeInference(environment.result).Handle(type.functionBlock, type.idList);
+    }
+    void Visit(StatementAssignmentId& type) override {
+        auto variableType = ExpressionTypeInference(environment).Handle(*type.expression);
+        auto id = environment.FindVariable(type.id);
+        if (id.has_value()) {
+            environment.SetType(id.value(), variableType);
+        }
+    }
+    void Visit(StatementAssignmentArray& type) override {
+        ExpressionTypeInference(environment).Handle(*type.specialOperationList);
+        ExpressionTypeInference(environment).Handle(*type.index);
+        ExpressionTypeInference(environment).Handle(*type.expression);
+    }
+    void Visit(StatementAssignmentField& type) override {
+        ExpressionTypeInference(environment).Handle(*type.specialOperationList);
+        ExpressionTypeInference(environment).Handle(*type.expression);
+    }
+    void Visit(StatementCall& type) override {
+        ExpressionTypeInference(environment).Handle(*type.specialOperationList);
+    }
+    void Visit(StatementIf& type) override {
+        ExpressionTypeInference(environment).Handle(*type.condition);
+        TypeState begin = environment.state;
+        Block(type.ifBlock);
+        TypeState ifEnd = std::move(environment.state);
+        environment.state = std::move(begin);
+        Block(type.elseBlock);
+        environment.state = TypeStateJoin(ifEnd, environment.state);
+    }
+    //ѭʼ = ѭʱ  ÿλصʼʱ͵Ľ ظֱٱ仯
+    void Visit(StatementWhile& type) override {
+        TypeState head = environment.state;
+        while (true) {
+            environment.loops.push_back(TypeInferenceLoop());
+            environment.state = head;
+            ExpressionTypeInference(environment).Handle(*type.condition);
+            Block(type.whileBlock);
+            TypeInferenceLoop loop = std::move(environment.loops.back());
+            environment.loops.pop_back();
+
+            TypeState back = environment.state;
+            for (auto& state : loop.continueStates) {
+                back = TypeStateJoin(back, state);
+            }
+            TypeState newHead = TypeStateJoin(head, back);
+            if (newHead == head) {
+                TypeState exit = head;
+                for (auto& state : loop.breakStates) {
+                    exit = TypeStateJoin(exit, state);
+                }
+                environment.state = std::move(exit);
+                return;
+            }
+            head = std::move(newHead);
+        }
+    }
+    void Visit(StatementBreak& type) override {
+        environment.loops.back().breakStates.push_back(environment.state);
+        environment.state = TypeStateUnreachable();
+    }
+    void Visit(StatementContinue& type) override {
+        environment.loops.back().continueStates.push_back(environment.state);
+        environment.state = TypeStateUnreachable();
+    }
+    void Visit(StatementReturn& type) override {
+        ExpressionTypeInference(environment).Handle(*type.expression);
+        environment.state = TypeStateUnreachable();
+    }
+private:
+    TypeInferenceEnvironment& environment;
+};
+
+void FunctionBlockTypeInference::Handle(StatementBlock& type, const vector<wstring>& idList) {
+    for (auto& idName : idList) {
+        environment.DefineVariable(idName, optional<HeapEnum>());
+    }
+    for (auto& item : type.statements) {
+        StatementTypeInference(environment).Handle(*item);
+    }
+}
+
+TypeInferenceResult TypeInference(MainBlock& root) {
+    TypeInferenceResult result;
+    FunctionBlockTypeInference(result).Handle(root, vector<wstring>());
+    return result;
+}
+
+void TypeInferenceFunction(FunctionBlock& type, const vector<wstring>& idList, TypeInferenceResult& result) {
+    FunctionBlockTypeInference(result).Handle(type, idList);
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+#include"AbstractSyntaxType.h"
+#include"CodeGenerate.h"
+#include<map>
+using std::map;
+
+/*
+    ڲƵ ֻ Int Float
+    հֵ ޷޸ĵߵľֲ ֻҪڲ
+    ¼ҲͶѾ֤ͬĶԪ ʱѡ AddInt AddFloat ָ
+*/
+struct TypeInferenceResult {
+    map<const AbstractSyntax::BinaryOperation*, HeapEnum> operandTypes;
+};
+
+TypeInferenceResult TypeInference(AbstractSyntax::MainBlock& root);
+
+//ֻƵһ (еĺ)  result Ԥĺ֮ʹ
+void TypeInferenceFunction(AbstractSyntax::FunctionBlock& type, const vector<wstring>& idList, TypeInferenceResult& result);
\ No newline at end of file
@@ -5,14 +5,16 @@ using std::optional;
 using std::pair;
 int32_t stackMin = 1024;
 int32_t heapMin = 4096;
+int32_t smallIntegerCacheMin = -128;
+int32_t smallIntegerCacheMax = 255;
 int8_t recycleMark = 0b00000001;
 int8_t neverRecycleMark = 0b00000010;
 
 VirtualMachineBuilder::VirtualMachineBuilder(VMRuntimeData data)
-    : stackMax(stackMin), heapMax(heapMin), registeredNames(std::move(data.registeredNames)),
-    instruction(std::move(data.instruction)), instructionLine(std::move(data.instructionLine)),
+    : profile(false), stackMax(stackMin), heapMax(heapMin), smallIntegerMin(smallIntegerCacheMin), smallIntegerMax(smallIntegerCacheMax), registeredNames(std::move(data.registeredNames)),
+    instruction(std::move(data.instruction)), constantPool(std::move(data.constantPool)), instructionLine(std::move(data.instructionLine)),
     staticString(std::move(data.staticString)), mainClosureOffest(std::move(data.mainClosureOffest)),
-    stringMap(std::move(data.stringMap)) {
+    stringMap(std::move(data.stringMap)), staticFunction(std::move(data.staticFunction)), lazyCompile(std::move(data.lazyCompile)) {
     auto list = vector<function<int32_t(VirtualMachine*, int16_t parameterCount)>>(
         registeredNames.size(), [](VirtualMachine* vm, int16_t parameterCount) -> int32_t {
         throw ConfigurationException(MessageHead(vm->instructionLine[vm->programCounter]) + "غδע");
@@ -43,14 +45,25 @@ void VirtualMachineBuilder::SetHeapMax(int32_t value) {
     heapMax = value;
 }
 
+void VirtualMachineBuilder::SetSmallIntegerCache(int32_t min, int32_t max) {
+    //min > max ʱʹû Χ Build ʱյĶѴС
+    smallIntegerMin = min;
+    smallIntegerMax = max;
+}
+
+void VirtualMachineBuilder::SetProfile(bool value) {
+    profile = value;
+}
+
 int32_t VMStringCreate(VirtualMachine& vm, const wchar_t* data1, int16_t length1, const wchar_t* data2, int16_t length2) {
     int16_t length = (length1 + length2);
-    int16_t memoryLength = 2 + (length + 1) / 2;
+    int16_t memoryLength = 3 + (length + 1) / 2;
     int32_t heapPointerString = VMAllocateHeapMemory(vm, HeapEnum::String, memoryLength);
     auto heapPointerStringPtr = VMHeapMemory(vm, heapPointerString);
     heapPointerStringPtr[1].value.stringLengthOrIndex.type = StringDataType::Length;
     heapPointerStringPtr[1].value.stringLengthOrIndex.lengthOrIndex = length;
-    wchar_t* charPtr = reinterpret_cast<wchar_t*>(heapPointerStringPtr + 2);
+    heapPointerStringPtr[2].value.intValue = 0;
+    wchar_t* charPtr = reinterpret_cast<wchar_t*>(heapPointerStringPtr + 3);
     int16_t index = 0;
     while (index < length1) {
         charPtr[index] = data1[index];
@@ -71,13 +84,33 @@ wstring_view VMStringGet(VirtualMachine& vm, HeapType* str) {
         return wstring_view(vm.StaticString[index]);
     } else if (type == StringDataType::Length) {
         int16_t length = str[1].value.stringLengthOrIndex.lengthOrIndex;
-        wchar_t* charPtr = reinterpret_cast<wchar_t*>(str + 2);
+        wchar_t* charPtr = reinterpret_cast<wchar_t*>(str + 3);
         return wstring_view(charPtr, length);
     } else {
         throw CompilerError();
     }
 }
 
+/*
+    ַĹϣֵ һμ֮ String  0 ʾδ
+*/
+int32_t VMStringHash(VirtualMachine& vm, HeapType* str) {
+    int32_t hash = str[2].value.intValue;
+    if (hash != 0) {
+        return hash;
+    }
+    uint32_t value = 2166136261u;
+    for (wchar_t c : VMStringGet(vm, str)) {
+        value = (value ^ static_cast<uint32_t>(c)) * 16777619u;
+    }
+    hash = static_cast<int32_t>(value);
+    if (hash == 0) {
+        hash = 1;
+    }
+    str[2].value.intValue = hash;
+    return hash;
+}
+
 StackType* VMLocalFunctionParamete(VirtualMachine& vm, int16_t parameterCount) {
     return VMStackMemory(vm) + 1 - parameterCount;
 }
@@ -121,7 +154,7 @@ wstring_view VMLocalFunctionGetStringData(VirtualMachine& vm, HeapType* str) {
         return wstring_view(vm.StaticString[index]);
     } else if (type == StringDataType::Length) {
         auto length = lengthOrIndex;
-        wchar_t* data = &str[2].value.word[0];
+        wchar_t* data = &str[3].value.word[0];
         return wstring_view(data, length);
     } else {
         throw CompilerError();
@@ -145,17 +178,34 @@ int32_t VMNullToHeapPointer() {
     return 0;
 }
 
+int32_t VMIntToHeapPointer(VirtualMachine& vm, int32_t value) {
+    if (value >= vm.smallIntegerMin && value <= vm.smallIntegerMax) {
+        return vm.smallIntegerPointer + (value - vm.smallIntegerMin) * 2;
+    }
+    int32_t heapPointerResult = VMAllocateHeapMemory(vm, HeapEnum::Int, 2);
+    VMHeapMemory(vm, heapPointerResult)[1].value.intValue = value;
+    return heapPointerResult;
+}
+
+int32_t VMCharToHeapPointer(VirtualMachine& vm, wchar_t value) {
+    int32_t heapPointerResult = VMAllocateHeapMemory(vm, HeapEnum::Char, 2);
+    VMHeapMemory(vm, heapPointerResult)[1].value.word[0] = value;
+    return heapPointerResult;
+}
+
 void VMProgramCounterInc(VirtualMachine& vm) {
     vm.programCounter += 1;
 }
 
 VirtualMachine VirtualMachineBuilder::Build() {
+    //ÿСռ2 תָͳ֮ǰ ʧܺȻ޸ Build
+    if (smallIntegerMin <= smallIntegerMax && (static_cast<int64_t>(smallIntegerMax) - smallIntegerMin + 1) * 2 > heapMax) {
+        throw ConfigurationException("С淶Χ");
+    }
     map<OperationKey, function<int32_t(VirtualMachine& vm, HeapType*, HeapType*)>> opMap;
     opMap.insert(pair(OperationKey(InstructionEnum::Multiply, HeapEnum::Int, HeapEnum::Int), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         int32_t value = left[1].value.intValue * right[1].value.intValue;
-        int32_t heapPointerResult = VMAllocateHeapMemory(vm, HeapEnum::Int, 2);
-        VMHeapMemory(vm, heapPointerResult)[1].value.intValue = value;
-        return heapPointerResult;
+        return VMIntToHeapPointer(vm, value);
     }));
     opMap.insert(pair(OperationKey(InstructionEnum::Multiply, HeapEnum::Int, HeapEnum::Float), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         float value = static_cast<float>(left[1].value.intValue) * right[1].value.floatValue;
@@ -178,9 +228,7 @@ VirtualMachine VirtualMachineBuilder::Build() {
 
     opMap.insert(pair(OperationKey(InstructionEnum::Divide, HeapEnum::Int, HeapEnum::Int), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         int32_t value = left[1].value.intValue / right[1].value.intValue;
-        int32_t heapPointerResult = VMAllocateHeapMemory(vm, HeapEnum::Int, 2);
-        VMHeapMemory(vm, heapPointerResult)[1].value.intValue = value;
-        return heapPointerResult;
+        return VMIntToHeapPointer(vm, value);
     }));
     opMap.insert(pair(OperationKey(InstructionEnum::Divide, HeapEnum::Int, HeapEnum::Float), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         float value = static_cast<float>(left[1].value.intValue) / right[1].value.floatValue;
@@ -203,9 +251,7 @@ VirtualMachine VirtualMachineBuilder::Build() {
 
     opMap.insert(pair(OperationKey(InstructionEnum::Modulus, HeapEnum::Int, HeapEnum::Int), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         int32_t value = left[1].value.intValue % right[1].value.intValue;
-        int32_t heapPointerResult = VMAllocateHeapMemory(vm, HeapEnum::Int, 2);
-        VMHeapMemory(vm, heapPointerResult)[1].value.intValue = value;
-        return heapPointerResult;
+        return VMIntToHeapPointer(vm, value);
     }));
     opMap.insert(pair(OperationKey(InstructionEnum::Modulus, HeapEnum::Int, HeapEnum::Float), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         float value = fmodf(static_cast<float>(left[1].value.intValue), right[1].value.floatValue);
@@ -228,9 +274,7 @@ VirtualMachine VirtualMachineBuilder::Build() {
 
     opMap.insert(pair(OperationKey(InstructionEnum::Add, HeapEnum::Int, HeapEnum::Int), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         int32_t value = left[1].value.intValue + right[1].value.intValue;
-        int32_t heapPointerResult = VMAllocateHeapMemory(vm, HeapEnum::Int, 2);
-        VMHeapMemory(vm, heapPointerResult)[1].value.intValue = value;
-        return heapPointerResult;
+        return VMIntToHeapPointer(vm, value);
     }));
     opMap.insert(pair(OperationKey(InstructionEnum::Add, HeapEnum::Int, HeapEnum::Float), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         float value = static_cast<float>(left[1].value.intValue) + right[1].value.floatValue;
@@ -279,9 +323,7 @@ VirtualMachine VirtualMachineBuilder::Build() {
 
     opMap.insert(pair(OperationKey(InstructionEnum::Subtract, HeapEnum::Int, HeapEnum::Int), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         int32_t value = left[1].value.intValue - right[1].value.intValue;
-        int32_t heapPointerResult = VMAllocateHeapMemory(vm, HeapEnum::Int, 2);
-        VMHeapMemory(vm, heapPointerResult)[1].value.intValue = value;
-        return heapPointerResult;
+        return VMIntToHeapPointer(vm, value);
     }));
     opMap.insert(pair(OperationKey(InstructionEnum::Subtract, HeapEnum::Int, HeapEnum::Float), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         float value = static_cast<float>(left[1].value.intValue) - right[1].value.floatValue;
@@ -429,6 +471,9 @@ VirtualMachine VirtualMachineBuilder::Build() {
     eqMap.insert(pair(EqualsKey(HeapEnum::Function, HeapEnum::Function), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         return left == right;
     }));
+    eqMap.insert(pair(EqualsKey(HeapEnum::Map, HeapEnum::Map), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
+        return left == right;
+    }));
     eqMap.insert(pair(EqualsKey(HeapEnum::Array, HeapEnum::Array), [](VirtualMachine& vm, HeapType* left, HeapType* right) ->int32_t {
         if (left == right) {
             return true;
@@ -463,11 +508,22 @@ VirtualMachine VirtualMachineBuilder::Build() {
         virtualMachine.localFunctionList.push_back(localFunctionList[offest]);
     }
     virtualMachine.StaticString = std::move(staticString);
+    virtualMachine.constantPool = std::move(constantPool);
+    virtualMachine.smallIntegerMin = smallIntegerMin;
+    virtualMachine.smallIntegerMax = smallIntegerMax;
     virtualMachine.instructionLine = std::move(instructionLine);
     virtualMachine.operationMap = std::move(opMap);
     virtualMachine.equalsMap = std::move(eqMap);
     virtualMachine.compareMap = std::move(compareMap);
     virtualMachine.stringMap = std::move(stringMap);
+    virtualMachine.staticFunction = std::move(staticFunction);
+    virtualMachine.lazyCompile = std::move(lazyCompile);
+    if (profile) {
+        virtualMachine.instructionCount = vector<int64_t>(virtualMachine.program.size(), 0);
+    }
+    virtualMachine.callCache = vector<VMCallCache>(virtualMachine.program.size());
+    virtualMachine.fieldCache = vector<VMFieldCache>(virtualMachine.program.size());
+    virtualMachine.shapes = vector<VMShape>(1);
     return virtualMachine;
 }
 
@@ -478,7 +534,29 @@ void VirtualMachineInit(VirtualMachine& virtualMachine) {
     int32_t lengthMainClosureItem = static_cast<int32_t>(virtualMachine.localFunctionList.size()) * 2;
     int32_t lengthMainClosure = 2 + static_cast<int32_t>(virtualMachine.localFunctionList.size());
     int32_t lengthMainFunction = 3;
-    int32_t lengthTotal = lengthNullFalseTrue + lengthMainClosureItem + lengthMainClosure + lengthMainFunction;
+    const int32_t smallIntegerMin = virtualMachine.smallIntegerMin;
+    const int32_t smallIntegerMax = virtualMachine.smallIntegerMax;
+    auto isSmallInteger = [&](int32_t value) {
+        return value >= smallIntegerMin && value <= smallIntegerMax;
+    };
+    int32_t lengthSmallInteger = smallIntegerMin <= smallIntegerMax ? (smallIntegerMax - smallIntegerMin + 1) * 2 : 0;
+    int32_t lengthConstantPool = 0;
+    for (auto& constant : virtualMachine.constantPool) {
+        if (constant.type == HeapEnum::String) {
+            lengthConstantPool += 3;
+        } else if (constant.type != HeapEnum::Int || !isSmallInteger(constant.value.intValue)) {
+            lengthConstantPool += 2;
+        }
+    }
+    int32_t lengthStaticFunction = 0;
+    for (auto& function : virtualMachine.staticFunction) {
+        lengthStaticFunction += 4;
+        if (function.closureItem.empty() == false) {
+            lengthStaticFunction += 2 + static_cast<int32_t>(function.closureItem.size());
+        }
+    }
+    int32_t lengthTotal = lengthNullFalseTrue + lengthMainClosureItem + lengthMainClosure + lengthMainFunction
+        + lengthSmallInteger + lengthConstantPool + lengthStaticFunction;
 
     int32_t heapSize = static_cast<int32_t>(virtualMachine.heap.size());
     if (heapSize <= lengthTotal) {
@@ -557,6 +635,98 @@ void VirtualMachineInit(VirtualMachine& virtualMachine) {
     virtualMachine.heap[heapPosition].value.intValue = 0;
     heapPosition += 1;
 
+    //С һλڶѵ GCʱƶ
+    const int16_t smallIntegerMemoryLength = 2;
+    virtualMachine.smallIntegerPointer = heapPosition;
+    for (int64_t value = smallIntegerMin; value <= smallIntegerMax; value++) {
+        HeapType smallIntegerType;
+        smallIntegerType.value.typeHead.type = HeapEnum::Int;
+        smallIntegerType.value.typeHead.reserved = neverRecycleMark;
+        smallIntegerType.value.typeHead.memorylength = smallIntegerMemoryLength;
+        virtualMachine.heap[heapPosition] = smallIntegerType;
+        heapPosition += 1;
+
+        virtualMachine.heap[heapPosition].value.intValue = static_cast<int32_t>(value);
+        heapPosition += 1;
+    }
+
+    // ڻ淶Χʱֱʹû
+    const int16_t constantMemoryLength = 2;
+    const int16_t stringConstantMemoryLength = 3;
+    virtualMachine.constantPoolPointer.clear();
+    for (auto& constant : virtualMachine.constantPool) {
+        if (constant.type == HeapEnum::Int && isSmallInteger(constant.value.intValue)) {
+            virtualMachine.constantPoolPointer.push_back(VMIntToHeapPointer(virtualMachine, constant.value.intValue));
+            continue;
+        }
+        HeapType constantType;
+        constantType.value.typeHead.type = constant.type;
+        constantType.value.typeHead.reserved = neverRecycleMark;
+        constantType.value.typeHead.memorylength = constant.type == HeapEnum::String ? stringConstantMemoryLength : constantMemoryLength;
+        virtualMachine.heap[heapPosition] = constantType;
+        virtualMachine.constantPoolPointer.push_back(heapPosition);
+        heapPosition += 1;
+
+        auto& constantValue = virtualMachine.heap[heapPosition].value;
+        switch (constant.type) {
+            case HeapEnum::Char:
+                constantValue.word[0] = constant.value.word;
+                break;
+            case HeapEnum::Int:
+                constantValue.intValue = constant.value.intValue;
+                break;
+            case HeapEnum::Float:
+                constantValue.floatValue = constant.value.floatValue;
+                break;
+            case HeapEnum::String:
+                constantValue.stringLengthOrIndex.type = StringDataType::Index;
+                constantValue.stringLengthOrIndex.lengthOrIndex = static_cast<int16_t>(constant.value.intValue);
+                heapPosition += 1;
+                virtualMachine.heap[heapPosition].value.intValue = 0;
+                break;
+            default:
+                throw CompilerError();
+        }
+        heapPosition += 1;
+    }
+
+    //Ԥȷĺ հΪʱʹ null
+    virtualMachine.staticFunctionPointer.clear();
+    for (auto& function : virtualMachine.staticFunction) {
+        int16_t closureLength = static_cast<int16_t>(function.closureItem.size());
+        int32_t closurePointer = VMNullToHeapPointer();
+        if (closureLength != 0) {
+            closurePointer = heapPosition;
+            heapPosition += heapTypeHeadAndLength + closureLength;
+        }
+        int32_t functionPointer = heapPosition;
+        heapPosition += heapTypeHeadAndClosurePositionAndProgramPosition;
+
+        if (closureLength != 0) {
+            HeapType closureType;
+            closureType.value.typeHead.type = HeapEnum::Closure;
+            closureType.value.typeHead.reserved = neverRecycleMark;
+            closureType.value.typeHead.memorylength = heapTypeHeadAndLength + closureLength;
+            virtualMachine.heap[closurePointer] = closureType;
+            virtualMachine.heap[closurePointer + 1].value.length = closureLength;
+            for (int16_t i = 0; i < closureLength; i++) {
+                int16_t item = function.closureItem[i];
+                int32_t itemPointer = item == -1 ? functionPointer : heapPositionStart + localFunctionItemClosureMemoryLength * item;
+                virtualMachine.heap[closurePointer + heapTypeHeadAndLength + i].value.intValue = itemPointer;
+            }
+        }
+
+        HeapType functionType;
+        functionType.value.typeHead.type = HeapEnum::Function;
+        functionType.value.typeHead.reserved = neverRecycleMark;
+        functionType.value.typeHead.memorylength = heapTypeHeadAndClosurePositionAndProgramPosition;
+        virtualMachine.heap[functionPointer] = functionType;
+        virtualMachine.heap[functionPointer + 1].value.length = function.parameterCount;
+        virtualMachine.heap[functionPointer + 2].value.intValue = closurePointer;
+        virtualMachine.heap[functionPointer + 3].value.intValue = function.programPosition;
+        virtualMachine.staticFunctionPointer.push_back(functionPointer);
+    }
+
     virtualMachine.stack[0].intValue = stackbuttom;
     virtualMachine.heapOffest = heapPosition;
 }
@@ -568,17 +738,30 @@ void VirtualMachineReset(VirtualMachine& virtualMachine) {
     for (auto& item : virtualMachine.heap) {
         item = HeapType();
     }
+    for (auto& item : virtualMachine.callCache) {
+        item = VMCallCache();
+    }
+    for (auto& item : virtualMachine.fieldCache) {
+        item = VMFieldCache();
+    }
 
     virtualMachine.programCounter = 0;
     virtualMachine.stackPointer = 0;
     virtualMachine.stackOffest = 0;
     virtualMachine.heapOffest = 0;
+    virtualMachine.allocationCount = 0;
+    virtualMachine.gcCount = 0;
+    virtualMachine.callCacheMiss = 0;
+    virtualMachine.fieldCacheMiss = 0;
 }
 
 void VirtualMachineStart(VirtualMachine& virtualMachine) {
     VMFunctionCall(virtualMachine, 0, 0);
     while (virtualMachine.stackPointer != 0) {
         Instruction instruction = virtualMachine.program[virtualMachine.programCounter];
+        if (!virtualMachine.instructionCount.empty()) {
+            virtualMachine.instructionCount[virtualMachine.programCounter] += 1;
+        }
         InstructionEnum type = instruction.type;
         int16_t offest = instruction.offest;
         VMCheckStackOverflow(virtualMachine, offest);
@@ -594,6 +777,9 @@ void VirtualMachineStart(VirtualMachine& virtualMachine) {
             case InstructionEnum::GetTrue:
                 VMGetTrue(virtualMachine, offest);
                 break;
+            case InstructionEnum::LoadConstant:
+                VMLoadConstant(virtualMachine, offest, instruction.value.intValue);
+                break;
             case InstructionEnum::CreateChar:
                 VMCreateChar(virtualMachine, offest, instruction.value.word);
                 break;
@@ -621,6 +807,12 @@ void VirtualMachineStart(VirtualMachine& virtualMachine) {
             case InstructionEnum::AddRecursiveFunctionItem:
                 VMAddRecursiveFunctionItem(virtualMachine, offest, instruction.value.offestOrLength);
                 break;
+            case InstructionEnum::LoadStaticFunction:
+                VMLoadStaticFunction(virtualMachine, offest, instruction.value.intValue);
+                break;
+            case InstructionEnum::CompileFunction:
+                VMCompileFunction(virtualMachine, offest, instruction.value.intValue);
+                break;
             case InstructionEnum::GetVariableByOffest:
                 VMGetVariableByOffest(virtualMachine, offest, instruction.value.offestOrLength);
                 break;
@@ -648,6 +840,30 @@ void VirtualMachineStart(VirtualMachine& virtualMachine) {
             case InstructionEnum::FunctionCall:
                 VMFunctionCall(virtualMachine, offest, instruction.value.offestOrLength);
                 break;
+            case InstructionEnum::TailCall:
+                VMTailCall(virtualMachine, offest, instruction.value.offestOrLength);
+                break;
+            case InstructionEnum::CallNative:
+                VMCallNative(virtualMachine, offest, instruction.reserved, instruction.value.intValue);
+                break;
+            case InstructionEnum::CallSelf:
+                VMCallSelf(virtualMachine, offest, instruction.reserved, instruction.value.intValue);
+                break;
+            case InstructionEnum::ArrayLength:
+                VMArrayLength(virtualMachine, offest);
+                break;
+            case InstructionEnum::ObjectFieldCount:
+                VMObjectFieldCount(virtualMachine, offest);
+                break;
+            case InstructionEnum::TypeOf:
+                VMTypeOf(virtualMachine, offest);
+                break;
+            case InstructionEnum::CharToInt:
+                VMCharToInt(virtualMachine, offest);
+                break;
+            case InstructionEnum::IntToChar:
+                VMIntToChar(virtualMachine, offest);
+                break;
             case InstructionEnum::Jump:
                 VMJump(virtualMachine, offest, instruction.value.intValue);
                 break;
@@ -683,6 +899,47 @@ void VirtualMachineStart(VirtualMachine& virtualMachine) {
             case InstructionEnum::Not:
                 VMNot(virtualMachine, offest);
                 break;
+            case InstructionEnum::MultiplyImmediate:
+            case InstructionEnum::DivideImmediate:
+            case InstructionEnum::ModulusImmediate:
+            case InstructionEnum::AddImmediate:
+            case InstructionEnum::SubtractImmediate:
+                VMBinaryOperationImmediate(virtualMachine, offest, type, instruction);
+                break;
+            case InstructionEnum::LessImmediate:
+            case InstructionEnum::LessEqualsImmediate:
+            case InstructionEnum::GreaterImmediate:
+            case InstructionEnum::GreaterEqualsImmediate:
+            case InstructionEnum::EqualsImmediate:
+            case InstructionEnum::NotEqualsImmediate:
+                VMCompareOperationImmediate(virtualMachine, offest, type, instruction);
+                break;
+            case InstructionEnum::MultiplyInt:
+            case InstructionEnum::DivideInt:
+            case InstructionEnum::ModulusInt:
+            case InstructionEnum::AddInt:
+            case InstructionEnum::SubtractInt:
+                VMBinaryOperationInt(virtualMachine, offest, type);
+                break;
+            case InstructionEnum::LessInt:
+            case InstructionEnum::LessEqualsInt:
+            case InstructionEnum::GreaterInt:
+            case InstructionEnum::GreaterEqualsInt:
+                VMCompareOperationInt(virtualMachine, offest, type);
+                break;
+            case InstructionEnum::MultiplyFloat:
+            case InstructionEnum::DivideFloat:
+            case InstructionEnum::ModulusFloat:
+            case InstructionEnum::AddFloat:
+            case InstructionEnum::SubtractFloat:
+                VMBinaryOperationFloat(virtualMachine, offest, type);
+                break;
+            case InstructionEnum::LessFloat:
+            case InstructionEnum::LessEqualsFloat:
+            case InstructionEnum::GreaterFloat:
+            case InstructionEnum::GreaterEqualsFloat:
+                VMCompareOperationFloat(virtualMachine, offest, type);
+                break;
             default:
                 throw CompilerError();
                 break;
@@ -729,7 +986,7 @@ void VMGCRecursiveMark(VirtualMachine& vm, int32_t heapPointer) {
             int16_t length = ptr[1].value.length;
             auto itemPtr = ptr + 2;
             for (int16_t i = 0; i < length; i++) {
-                VMGCRecursiveMark(vm, itemPtr[i * 2 + 1].value.intValue);
+                VMGCRecursiveMark(vm, itemPtr[i].value.intValue);
             }
             break;
         }
@@ -745,6 +1002,32 @@ void VMGCRecursiveMark(VirtualMachine& vm, int32_t heapPointer) {
         case HeapEnum::Function:
             VMGCRecursiveMark(vm, ptr[2].value.intValue);
             break;
+        case HeapEnum::ObjectHashTable:
+        {
+            int16_t capacity = (ptr->value.typeHead.memorylength - 2) / 2;
+            auto itemPtr = ptr + 2;
+            for (int16_t i = 0; i < capacity; i++) {
+                if (itemPtr[2 * i].value.intValue != -1) {
+                    VMGCRecursiveMark(vm, itemPtr[2 * i + 1].value.intValue);
+                }
+            }
+            break;
+        }
+        case HeapEnum::Map:
+            VMGCRecursiveMark(vm, ptr[1].value.intValue);
+            break;
+        case HeapEnum::MapTable:
+        {
+            int16_t capacity = (ptr->value.typeHead.memorylength - 3) / 3;
+            auto itemPtr = ptr + 3;
+            for (int16_t i = 0; i < capacity; i++) {
+                if (itemPtr[3 * i + 1].value.intValue >= 0) {
+                    VMGCRecursiveMark(vm, itemPtr[3 * i + 1].value.intValue);
+                    VMGCRecursiveMark(vm, itemPtr[3 * i + 2].value.intValue);
+                }
+            }
+            break;
+        }
         default:
             throw CompilerError();
     }
@@ -797,10 +1080,9 @@ void VMGCRecursiveClearMark(VirtualMachine& vm, int32_t heapPointer, const map<i
             int16_t length = ptr[1].value.length;
             auto itemPtr = ptr + 2;
             for (int16_t i = 0; i < length; i++) {
-                int32_t offest = i * 2 + 1;
-                auto oldHeapPointer = ptr[offest].value.intValue;
+                auto oldHeapPointer = itemPtr[i].value.intValue;
                 auto newHeapPointer = pointerMap.find(oldHeapPointer)->second.value();
-                ptr[offest].value.intValue = newHeapPointer;
+                itemPtr[i].value.intValue = newHeapPointer;
                 VMGCRecursiveClearMark(vm, newHeapPointer, pointerMap);
             }
             break;
@@ -826,13 +1108,74 @@ void VMGCRecursiveClearMark(VirtualMachine& vm, int32_t heapPointer, const map<i
             VMGCRecursiveClearMark(vm, newHeapPointer, pointerMap);
             break;
         }
+        case HeapEnum::ObjectHashTable:
+        {
+            int16_t capacity = (ptr->value.typeHead.memorylength - 2) / 2;
+            auto itemPtr = ptr + 2;
+            for (int16_t i = 0; i < capacity; i++) {
+                if (itemPtr[2 * i].value.intValue == -1) {
+                    continue;
+                }
+                auto oldHeapPointer = itemPtr[2 * i + 1].value.intValue;
+                auto newHeapPointer = pointerMap.find(oldHeapPointer)->second.value();
+                itemPtr[2 * i + 1].value.intValue = newHeapPointer;
+                VMGCRecursiveClearMark(vm, newHeapPointer, pointerMap);
+            }
+            break;
+        }
+        case HeapEnum::Map:
+        {
+            auto oldHeapPointer = ptr[1].value.intValue;
+            auto newHeapPointer = pointerMap.find(oldHeapPointer)->second.value();
+            ptr[1].value.intValue = newHeapPointer;
+            VMGCRecursiveClearMark(vm, newHeapPointer, pointerMap);
+            break;
+        }
+        case HeapEnum::MapTable:
+        {
+            int16_t capacity = (ptr->value.typeHead.memorylength - 3) / 3;
+            auto itemPtr = ptr + 3;
+            for (int16_t i = 0; i < capacity; i++) {
+                if (itemPtr[3 * i + 1].value.intValue < 0) {
+                    continue;
+                }
+                for (int16_t j = 1; j <= 2; j++) {
+                    auto oldHeapPointer = itemPtr[3 * i + j].value.intValue;
+                    auto newHeapPointer = pointerMap.find(oldHeapPointer)->second.value();
+                    itemPtr[3 * i + j].value.intValue = newHeapPointer;
+                    VMGCRecursiveClearMark(vm, newHeapPointer, pointerMap);
+                }
+            }
+            break;
+        }
         default:
             throw CompilerError();
     }
 }
 
+/*
+    ÿͷλ
+    ǰԤ SP PC հλòд ֮ǰµֵ ջָֻͷֵŵָ
+    һλ֮еĶ ֵָĶ󱻱һλ 
+*/
+static vector<bool> VMGCObjectStart(VirtualMachine& vm) {
+    vector<bool> result(vm.heapOffest, false);
+    int32_t heapOffest = 0;
+    while (heapOffest < vm.heapOffest) {
+        result[heapOffest] = true;
+        heapOffest += VMHeapMemory(vm, heapOffest)->value.typeHead.memorylength;
+    }
+    return result;
+}
+
+static bool VMGCIsObjectStart(const vector<bool>& objectStart, int32_t heapPointer) {
+    return heapPointer >= 0 && heapPointer < static_cast<int32_t>(objectStart.size()) && objectStart[heapPointer];
+}
+
 void VirtualMachineGC(VirtualMachine& virtualMachine) {
+    virtualMachine.gcCount += 1;
     const int32_t pushStackOffest = 2;
+    const vector<bool> objectStart = VMGCObjectStart(virtualMachine);
     //
     {
         int32_t stackPointer = virtualMachine.stackPointer;
@@ -841,7 +1184,9 @@ void VirtualMachineGC(VirtualMachine& virtualMachine) {
             while (stackOffest >= pushStackOffest) {
                 int32_t stackPosition = stackPointer + stackOffest;
                 int32_t heapPointer = virtualMachine.stack[stackPosition].intValue;
-                VMGCRecursiveMark(virtualMachine, heapPointer);
+                if (VMGCIsObjectStart(objectStart, heapPointer)) {
+                    VMGCRecursiveMark(virtualMachine, heapPointer);
+                }
                 stackOffest -= 1;
             }
             int32_t newStackPointer = virtualMachine.stack[stackPointer].intValue;
@@ -879,10 +1224,10 @@ void VirtualMachineGC(VirtualMachine& virtualMachine) {
             int16_t memoryLength = oldHeapPtr->value.typeHead.memorylength;
             auto newPosition = pointerMap.find(oldHeapOffest)->second;
             if (newPosition.has_value()) {
-                int16_t newHeapOffest = newPosition.value();
+                int32_t newHeapOffest = newPosition.value();
                 auto newHeapPtr = VMHeapMemory(virtualMachine, newHeapOffest);
                 for (int16_t i = 0; i < memoryLength; i++) {
-                    newHeapPtr[i].value.intValue = oldHeapPtr[i].value.intValue;
+                    newHeapPtr[i] = oldHeapPtr[i];
                 }
             }
             oldHeapOffest += memoryLength;
@@ -896,9 +1241,11 @@ void VirtualMachineGC(VirtualMachine& virtualMachine) {
             while (stackOffest >= pushStackOffest) {
                 int32_t stackPosition = stackPointer + stackOffest;
                 int32_t oldHeapPointer = virtualMachine.stack[stackPosition].intValue;
-                int32_t newHeapPointer = pointerMap.find(oldHeapPointer)->second.value();
-                virtualMachine.stack[stackPosition].intValue = newHeapPointer;
-                VMGCRecursiveClearMark(virtualMachine, newHeapPointer, pointerMap);
+                if (VMGCIsObjectStart(objectStart, oldHeapPointer)) {
+                    int32_t newHeapPointer = pointerMap.find(oldHeapPointer)->second.value();
+                    virtualMachine.stack[stackPosition].intValue = newHeapPointer;
+                    VMGCRecursiveClearMark(virtualMachine, newHeapPointer, pointerMap);
+                }
                 stackOffest -= 1;
             }
             int32_t newStackPointer = virtualMachine.stack[stackPointer].intValue;
@@ -906,6 +1253,19 @@ void VirtualMachineGC(VirtualMachine& virtualMachine) {
             stackPointer = newStackPointer;
         }
     }
+    //ôĻ ʱָ (հ һ) 
+    for (auto& cache : virtualMachine.callCache) {
+        if (cache.function == -1) {
+            continue;
+        }
+        auto& newFunction = pointerMap.find(cache.function)->second;
+        if (newFunction.has_value()) {
+            cache.function = newFunction.value();
+            cache.closure = pointerMap.find(cache.closure)->second.value();
+        } else {
+            cache = VMCallCache();
+        }
+    }
     //תƶ
     virtualMachine.heapOffest = newHeapOffest;
 }
@@ -949,9 +1309,12 @@ int32_t VMAllocateHeapMemory(VirtualMachine& vm, HeapEnum type, int16_t value) {
             throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "ڴ泬");
         }
     }
+    vm.allocationCount += 1;
     int32_t position = vm.heapOffest;
     auto* ptr = VMHeapMemory(vm, position);
+    //֮Ѷ֮ƶ֮ǰĶ λҲҪ
     ptr->value.typeHead.type = type;
+    ptr->value.typeHead.reserved = 0;
     ptr->value.typeHead.memorylength = value;
     vm.heapOffest += value;
     return position;
@@ -983,6 +1346,12 @@ void VMGetTrue(VirtualMachine& vm, int16_t offest) {
     VMProgramCounterInc(vm);
 }
 
+void VMLoadConstant(VirtualMachine& vm, int16_t offest, int32_t index) {
+    VMSetUpNewOffest(vm, offest);
+    VMStackMemory(vm)->intValue = vm.constantPoolPointer[index];
+    VMProgramCounterInc(vm);
+}
+
 void VMCreateChar(VirtualMachine& vm, int16_t offest, wchar_t value) {
     int32_t heapPointer = VMAllocateHeapMemory(vm, HeapEnum::Char, 2);
     VMHeapMemory(vm, heapPointer + 1)->value.word[0] = value;
@@ -992,8 +1361,7 @@ void VMCreateChar(VirtualMachine& vm, int16_t offest, wchar_t value) {
 }
 
 void VMCreateInt(VirtualMachine& vm, int16_t offest, int32_t value) {
-    int32_t heapPointer = VMAllocateHeapMemory(vm, HeapEnum::Int, 2);
-    VMHeapMemory(vm, heapPointer + 1)->value.intValue = value;
+    int32_t heapPointer = VMIntToHeapPointer(vm, value);
     VMSetUpNewOffest(vm, offest);
     VMStackMemory(vm)->intValue = heapPointer;
     VMProgramCounterInc(vm);
@@ -1008,10 +1376,11 @@ void VMCreateFloat(VirtualMachine& vm, int16_t offest, float value) {
 }
 
 void VMCreateString(VirtualMachine& vm, int16_t offest, int32_t index) {
-    int32_t heapPointer = VMAllocateHeapMemory(vm, HeapEnum::String, 2);
+    int32_t heapPointer = VMAllocateHeapMemory(vm, HeapEnum::String, 3);
     auto heapPointerStringDataType = VMHeapMemory(vm, heapPointer + 1);
     heapPointerStringDataType->value.stringLengthOrIndex.type = StringDataType::Index;
     heapPointerStringDataType->value.stringLengthOrIndex.lengthOrIndex = static_cast<int16_t>(index);
+    heapPointerStringDataType[1].value.intValue = 0;
     VMSetUpNewOffest(vm, offest);
     VMStackMemory(vm)->intValue = heapPointer;
     VMProgramCounterInc(vm);
@@ -1043,10 +1412,12 @@ void VMCreateArray(VirtualMachine& vm, int16_t offest) {
     VMProgramCounterInc(vm);
 }
 
+//µĶʹÿյ״ (0)
 void VMCreateObject(VirtualMachine& vm, int16_t offest) {
     const int16_t headAndOtherData = 2;
+    const int16_t objectMemory = 3;
     const int16_t objectFieldListInitCapacity = 16;
-    const int16_t objectFieldListMemory = headAndOtherData + objectFieldListInitCapacity * headAndOtherData;
+    const int16_t objectFieldListMemory = headAndOtherData + objectFieldListInitCapacity;
     int32_t heapPointerObjectFieldList = VMAllocateHeapMemory(vm, HeapEnum::ObjectFieldList, objectFieldListMemory);
     auto heapPointerObjectFieldListPtr = VMHeapMemory(vm, heapPointerObjectFieldList);
     heapPointerObjectFieldListPtr[1].value.length = 0;
@@ -1054,9 +1425,11 @@ void VMCreateObject(VirtualMachine& vm, int16_t offest) {
 
     VMSetUpNewOffest(vm, offest);
     VMStackMemory(vm)->intValue = heapPointerObjectFieldList;
-    int32_t heapPointerObject = VMAllocateHeapMemory(vm, HeapEnum::Object, headAndOtherData);
+    int32_t heapPointerObject = VMAllocateHeapMemory(vm, HeapEnum::Object, objectMemory);
     auto heapPointerObjectPtr = VMHeapMemory(vm, heapPointerObject);
-    heapPointerObjectPtr[1].value.intValue = heapPointerObjectFieldList;
+    //ʱܷ ObjectFieldList ƶ֮λջ
+    heapPointerObjectPtr[1].value.intValue = VMStackMemory(vm)->intValue;
+    heapPointerObjectPtr[2].value.intValue = 0;
     VMStackMemory(vm)->intValue = heapPointerObject;
     VMProgramCounterInc(vm);
 }
@@ -1103,6 +1476,48 @@ void VMAddRecursiveFunctionItem(VirtualMachine& vm, int16_t offest, int16_t clos
     VMProgramCounterInc(vm);
 }
 
+void VMLoadStaticFunction(VirtualMachine& vm, int16_t offest, int32_t index) {
+    VMSetUpNewOffest(vm, offest);
+    VMStackMemory(vm)->intValue = vm.staticFunctionPointer[index];
+    VMProgramCounterInc(vm);
+}
+
+/*
+    һα ɺ岢ڳĩβ
+    ָ滻Ϊת ֮ǰĺҲֱִ
+    ָú CreateFunction ԤȷĺΪֱָ
+*/
+void VMCompileFunction(VirtualMachine& vm, int16_t offest, int32_t function) {
+    VMSetUpNewOffest(vm, offest);
+    if (!vm.lazyCompile) {
+        throw CompilerError();
+    }
+    int32_t position = static_cast<int32_t>(vm.program.size());
+    LazyCompileResult result = vm.lazyCompile(function, position);
+    vm.program.insert(vm.program.end(), result.instruction.begin(), result.instruction.end());
+    vm.instructionLine.insert(vm.instructionLine.end(), result.instructionLine.begin(), result.instructionLine.end());
+    if (!vm.instructionCount.empty()) {
+        vm.instructionCount.resize(vm.program.size(), 0);
+    }
+    vm.callCache.resize(vm.program.size());
+    vm.fieldCache.resize(vm.program.size());
+    for (auto& str : result.staticString) {
+        vm.stringMap.insert(std::pair(str, static_cast<int32_t>(vm.StaticString.size())));
+        vm.StaticString.push_back(std::move(str));
+    }
+    for (auto createFunction : result.createFunction) {
+        vm.program[createFunction].value.intValue = position;
+    }
+    if (result.staticFunction != -1) {
+        vm.staticFunction[result.staticFunction].programPosition = position;
+        VMHeapMemory(vm, vm.staticFunctionPointer[result.staticFunction])[3].value.intValue = position;
+    }
+    auto& stub = vm.program[vm.programCounter];
+    stub.type = InstructionEnum::Jump;
+    stub.value.intValue = position;
+    vm.programCounter = position;
+}
+
 void VMGetVariableByOffest(VirtualMachine& vm, int16_t offest, int16_t variableOffest) {
     VMSetUpNewOffest(vm, offest);
     VMStackMemory(vm)->intValue = VMStackMemoryByOffest(vm, variableOffest)->intValue;
@@ -1160,6 +1575,29 @@ void VMAccessArray(VirtualMachine& vm, int16_t offest) {
     VMProgramCounterInc(vm);
 }
 
+/*
+    ObjectHashTable вֶ ֶڵλû̽⵽ĵһλ ( ObjectHashTable Ŀʼ)
+    Ϊ 2  пλ ̽һ
+*/
+static int32_t VMObjectHashTableProbe(HeapType* heapPointerObjectHashTablePtr, int32_t index) {
+    const int32_t typeHeadAndOther = 2;
+    uint32_t mask = (heapPointerObjectHashTablePtr->value.typeHead.memorylength - typeHeadAndOther) / 2 - 1;
+    uint32_t hash = static_cast<uint32_t>(index) * 2654435769u;
+    uint32_t position = (hash ^ (hash >> 16)) & mask;
+    while (true) {
+        int32_t key = heapPointerObjectHashTablePtr[typeHeadAndOther + 2 * position].value.intValue;
+        if ((key == index) || (key == -1)) {
+            return typeHeadAndOther + 2 * position;
+        }
+        position = (position + 1) & mask;
+    }
+}
+
+/*
+    ֶ ObjectFieldList еλɶ״
+    ָһε״λ ״ͬʱֻȽһ ֱӶȡ
+    ֶν϶Ķʹ ObjectHashTable ÿβ
+*/
 void VMAccessField(VirtualMachine& vm, int16_t offest, int32_t index) {
     const int32_t typeHeadAndOther = 2;
     VMSetUpNewOffest(vm, offest);
@@ -1168,29 +1606,30 @@ void VMAccessField(VirtualMachine& vm, int16_t offest, int32_t index) {
     if (heapPointerObjectPtr->value.typeHead.type != HeapEnum::Object) {
         throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "ͲΪObject");
     }
-
-    int32_t heapPointerObjectFieldList = heapPointerObjectPtr[1].value.intValue;
-    auto heapPointerObjectFieldListPtr = VMHeapMemory(vm, heapPointerObjectFieldList);
-    int16_t fieldListSize = heapPointerObjectFieldListPtr[1].value.length;
-    auto heapPointerObjectFieldItemPtr = heapPointerObjectFieldListPtr + typeHeadAndOther;
-
-    //TODO ĳɶֲ
-    int16_t arrayIndex = 0;
-    while (arrayIndex != fieldListSize) {
-        int16_t fieldOffest = arrayIndex * 2;
-        int32_t stringIndex = heapPointerObjectFieldItemPtr[fieldOffest].value.intValue;
-        int32_t fieldValue = heapPointerObjectFieldItemPtr[fieldOffest + 1].value.intValue;
-        if (stringIndex < index) {
-            arrayIndex += 1;
-        } else if (stringIndex == index) {
-            VMStackMemory(vm)->intValue = fieldValue;
+    int32_t shape = heapPointerObjectPtr[2].value.intValue;
+    auto& cache = vm.fieldCache[vm.programCounter];
+    if (cache.shape != shape) {
+        if (shape == VMObjectHashTableShape) {
+            auto heapPointerObjectHashTablePtr = VMHeapMemory(vm, heapPointerObjectPtr[1].value.intValue);
+            int32_t position = VMObjectHashTableProbe(heapPointerObjectHashTablePtr, index);
+            if (heapPointerObjectHashTablePtr[position].value.intValue == -1) {
+                throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "objectв id: " + WstringToString(vm.StaticString[index]));
+            }
+            VMStackMemory(vm)->intValue = heapPointerObjectHashTablePtr[position + 1].value.intValue;
             VMProgramCounterInc(vm);
             return;
-        } else {
-            break;
         }
+        vm.fieldCacheMiss += 1;
+        auto& slot = vm.shapes[shape].slot;
+        auto find = slot.find(index);
+        if (find == slot.end()) {
+            throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "objectв id: " + WstringToString(vm.StaticString[index]));
+        }
+        cache = VMFieldCache{ shape, find->second, -1 };
     }
-    throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "objectв id: " + WstringToString(vm.StaticString[index]));
+    auto heapPointerObjectFieldListPtr = VMHeapMemory(vm, heapPointerObjectPtr[1].value.intValue);
+    VMStackMemory(vm)->intValue = heapPointerObjectFieldListPtr[typeHeadAndOther + cache.slot].value.intValue;
+    VMProgramCounterInc(vm);
 }
 
 void VMAssignmentArray(VirtualMachine& vm, int16_t offest) {
@@ -1219,126 +1658,309 @@ void VMAssignmentArray(VirtualMachine& vm, int16_t offest) {
     VMProgramCounterInc(vm);
 }
 
+/*
+    ״мֶ ͬ״ֶͬεõͬһ״
+*/
+static int32_t VMShapeTransition(VirtualMachine& vm, int32_t shape, int32_t index) {
+    auto find = vm.shapes[shape].transition.find(index);
+    if (find != vm.shapes[shape].transition.end()) {
+        return find->second;
+    }
+    VMShape child;
+    child.fieldCount = vm.shapes[shape].fieldCount + 1;
+    child.slot = vm.shapes[shape].slot;
+    child.slot.insert(pair(index, vm.shapes[shape].fieldCount));
+    int32_t result = static_cast<int32_t>(vm.shapes.size());
+    vm.shapes.push_back(std::move(child));
+    vm.shapes[shape].transition.insert(pair(index, result));
+    return result;
+}
+
+/*
+    ʹ ObjectHashTable Ķдֶ ״еֶθѾﵽ VMObjectHashTableThreshold ʱµֶ
+    ֶθ 3/4 ߶Ȼʹ ObjectFieldList ʱ µ ObjectHashTable ·ֶ
+    ֮´ջжȡֵ
+*/
+static void VMObjectHashTableAssignment(VirtualMachine& vm, int16_t offest, int32_t index) {
+    const int32_t typeHeadAndOther = 2;
+    const int32_t capacityMin = 16;
+    const int32_t capacityMax = 8192;
+    auto heapPointerObjectPtr = VMHeapMemory(vm, VMStackMemoryByOffest(vm, offest)->intValue);
+    int32_t shape = heapPointerObjectPtr[2].value.intValue;
+    int32_t fieldCount = 0;
+    if (shape == VMObjectHashTableShape) {
+        auto heapPointerObjectHashTablePtr = VMHeapMemory(vm, heapPointerObjectPtr[1].value.intValue);
+        int32_t capacity = (heapPointerObjectHashTablePtr->value.typeHead.memorylength - typeHeadAndOther) / 2;
+        int32_t position = VMObjectHashTableProbe(heapPointerObjectHashTablePtr, index);
+        fieldCount = heapPointerObjectHashTablePtr[1].value.length;
+        bool exist = heapPointerObjectHashTablePtr[position].value.intValue == index;
+        if (exist || ((fieldCount + 1) * 4 <= capacity * 3)) {
+            if (!exist) {
+                heapPointerObjectHashTablePtr[position].value.intValue = index;
+                heapPointerObjectHashTablePtr[1].value.length = fieldCount + 1;
+            }
+            heapPointerObjectHashTablePtr[position + 1].value.intValue = VMStackMemoryByOffest(vm, offest + 1)->intValue;
+            return;
+        }
+    } else {
+        fieldCount = vm.shapes[shape].fieldCount;
+    }
+    int32_t newCapacity = capacityMin;
+    while ((fieldCount + 1) * 4 > newCapacity * 3) {
+        newCapacity *= 2;
+    }
+    if (newCapacity > capacityMax) {
+        throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "objectֶθ");
+    }
+    int32_t heapPointerNewObjectHashTable = VMAllocateHeapMemory(vm, HeapEnum::ObjectHashTable, typeHeadAndOther + newCapacity * 2);
+    heapPointerObjectPtr = VMHeapMemory(vm, VMStackMemoryByOffest(vm, offest)->intValue);
+    auto heapPointerOldPtr = VMHeapMemory(vm, heapPointerObjectPtr[1].value.intValue);
+    auto heapPointerNewObjectHashTablePtr = VMHeapMemory(vm, heapPointerNewObjectHashTable);
+    for (int32_t i = 0; i < newCapacity; i++) {
+        heapPointerNewObjectHashTablePtr[typeHeadAndOther + 2 * i].value.intValue = -1;
+    }
+    auto insert = [heapPointerNewObjectHashTablePtr](int32_t key, int32_t heapPointerValue) {
+        int32_t position = VMObjectHashTableProbe(heapPointerNewObjectHashTablePtr, key);
+        heapPointerNewObjectHashTablePtr[position].value.intValue = key;
+        heapPointerNewObjectHashTablePtr[position + 1].value.intValue = heapPointerValue;
+    };
+    if (shape == VMObjectHashTableShape) {
+        int32_t capacity = (heapPointerOldPtr->value.typeHead.memorylength - typeHeadAndOther) / 2;
+        for (int32_t i = 0; i < capacity; i++) {
+            int32_t key = heapPointerOldPtr[typeHeadAndOther + 2 * i].value.intValue;
+            if (key != -1) {
+                insert(key, heapPointerOldPtr[typeHeadAndOther + 2 * i + 1].value.intValue);
+            }
+        }
+    } else {
+        for (auto& [key, slot] : vm.shapes[shape].slot) {
+            insert(key, heapPointerOldPtr[typeHeadAndOther + slot].value.intValue);
+        }
+    }
+    insert(index, VMStackMemoryByOffest(vm, offest + 1)->intValue);
+    heapPointerNewObjectHashTablePtr[1].value.length = static_cast<int16_t>(fieldCount + 1);
+    heapPointerObjectPtr[1].value.intValue = heapPointerNewObjectHashTable;
+    heapPointerObjectPtr[2].value.intValue = VMObjectHashTableShape;
+}
+
+/*
+    еֱֶд µֶμ ObjectFieldList ĩβ ת״
+    ObjectFieldList ʱӱ ֮´ջжȡֵ
+    ָ (״ λ ״) ״ͬʱҪ
+    ֶν϶Ķʹ ObjectHashTable ÿβ
+*/
 void VMAssignmentField(VirtualMachine& vm, int16_t offest, int32_t index) {
     const int16_t typeHeadAndOther = 2;
-    const int16_t objectFieldListItemLength = 2;
     int32_t heapPointerObject = VMStackMemoryByOffest(vm, offest)->intValue;
     auto heapPointerObjectPtr = VMHeapMemory(vm, heapPointerObject);
     if (heapPointerObjectPtr->value.typeHead.type != HeapEnum::Object) {
         throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "ͲΪObject");
     }
-
-    int32_t heapPointerExpression = VMStackMemoryByOffest(vm, offest + 1)->intValue;
-    int32_t heapPointerObjectFieldList = heapPointerObjectPtr[1].value.intValue;
-    auto heapPointerObjectFieldListPtr = VMHeapMemory(vm, heapPointerObjectFieldList);
-    int16_t fieldListSize = heapPointerObjectFieldListPtr[1].value.length;
-    auto heapPointerObjectFieldItemPtr = heapPointerObjectFieldListPtr + typeHeadAndOther;
-
-    //TODO ĳɶֲ 
-    int16_t arrayIndex = 0;
-    while (arrayIndex != fieldListSize) {
-        int16_t fieldOffest = arrayIndex * objectFieldListItemLength;
-        int32_t stringIndex = heapPointerObjectFieldItemPtr[fieldOffest].value.intValue;
-        if (stringIndex < index) {
-            arrayIndex += 1;
-        } else if (stringIndex == index) {
-            heapPointerObjectFieldItemPtr[fieldOffest + 1].value.intValue = heapPointerExpression;
+    int32_t shape = heapPointerObjectPtr[2].value.intValue;
+    auto& cache = vm.fieldCache[vm.programCounter];
+    if (cache.shape != shape) {
+        bool hashTable = shape == VMObjectHashTableShape;
+        if (!hashTable) {
+            vm.fieldCacheMiss += 1;
+            auto& slot = vm.shapes[shape].slot;
+            auto find = slot.find(index);
+            int16_t fieldCount = vm.shapes[shape].fieldCount;
+            if (find != slot.end()) {
+                cache = VMFieldCache{ shape, find->second, -1 };
+            } else if (fieldCount < VMObjectHashTableThreshold) {
+                cache = VMFieldCache{ shape, fieldCount, VMShapeTransition(vm, shape, index) };
+            } else {
+                hashTable = true;
+            }
+        }
+        if (hashTable) {
+            VMObjectHashTableAssignment(vm, offest, index);
             VMSetUpNewOffest(vm, offest);
             VMProgramCounterInc(vm);
             return;
-        } else {
-            break;
         }
     }
-
-    //
-
-    int16_t prevousCapacity = heapPointerObjectFieldListPtr->value.typeHead.memorylength;
-    int16_t prevousLength = heapPointerObjectFieldListPtr[1].value.length;
-    bool objectFieldListIsFull = (prevousCapacity == (prevousLength * objectFieldListItemLength + typeHeadAndOther));
-    if (objectFieldListIsFull) {
-        const int16_t addtion = 16;
-        int16_t currentCapacity = prevousCapacity + addtion * objectFieldListItemLength;
-        int16_t currentLength = prevousLength + 1;
-
-        int32_t heapPointerNewObjectFieldList = VMAllocateHeapMemory(vm, HeapEnum::ObjectFieldList, currentCapacity);
-        auto heapPointerNewObjectFieldListPtr = VMHeapMemory(vm, heapPointerNewObjectFieldList);
-        heapPointerNewObjectFieldListPtr[1].value.length = currentLength;
-        auto heapPointerNewObjectFieldItemPtr = heapPointerNewObjectFieldListPtr + typeHeadAndOther;
-
-        int16_t copyIndex = 0;
-        while (copyIndex != arrayIndex) {
-            int16_t fieldOffest = copyIndex * objectFieldListItemLength;
-            heapPointerNewObjectFieldItemPtr[fieldOffest].value.intValue = heapPointerObjectFieldItemPtr[fieldOffest].value.intValue;
-            heapPointerNewObjectFieldItemPtr[fieldOffest + 1].value.intValue = heapPointerObjectFieldItemPtr[fieldOffest + 1].value.intValue;
-            copyIndex += 1;
+    const int16_t fieldSlot = cache.slot;
+    const int32_t transition = cache.transition;
+    auto heapPointerObjectFieldListPtr = VMHeapMemory(vm, heapPointerObjectPtr[1].value.intValue);
+    if (transition != -1) {
+        int16_t capacity = heapPointerObjectFieldListPtr->value.typeHead.memorylength - typeHeadAndOther;
+        if (fieldSlot == capacity) {
+            const int16_t capacityMax = INT16_MAX - typeHeadAndOther;
+            if (capacity == capacityMax) {
+                throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "objectֶθ");
+            }
+            int16_t newCapacity = static_cast<int16_t>(std::min<int32_t>(capacity * 2, capacityMax));
+            int32_t heapPointerNewObjectFieldList = VMAllocateHeapMemory(vm, HeapEnum::ObjectFieldList, typeHeadAndOther + newCapacity);
+            heapPointerObjectPtr = VMHeapMemory(vm, VMStackMemoryByOffest(vm, offest)->intValue);
+            heapPointerObjectFieldListPtr = VMHeapMemory(vm, heapPointerObjectPtr[1].value.intValue);
+            auto heapPointerNewObjectFieldListPtr = VMHeapMemory(vm, heapPointerNewObjectFieldList);
+            for (int16_t i = 0; i < fieldSlot; i++) {
+                heapPointerNewObjectFieldListPtr[typeHeadAndOther + i].value.intValue = heapPointerObjectFieldListPtr[typeHeadAndOther + i].value.intValue;
+            }
+            heapPointerObjectPtr[1].value.intValue = heapPointerNewObjectFieldList;
+            heapPointerObjectFieldListPtr = heapPointerNewObjectFieldListPtr;
         }
+        heapPointerObjectFieldListPtr[1].value.length = fieldSlot + 1;
+        heapPointerObjectPtr[2].value.intValue = transition;
+    }
+    int32_t heapPointerExpression = VMStackMemoryByOffest(vm, offest + 1)->intValue;
+    heapPointerObjectFieldListPtr[typeHeadAndOther + fieldSlot].value.intValue = heapPointerExpression;
+    VMSetUpNewOffest(vm, offest);
+    VMProgramCounterInc(vm);
+}
 
-        int16_t insertOffest = arrayIndex * 2;
-        heapPointerNewObjectFieldItemPtr[insertOffest].value.intValue = index;
-        heapPointerNewObjectFieldItemPtr[insertOffest + 1].value.intValue = heapPointerExpression;
-
-        while (copyIndex != prevousLength) {
-            int16_t fieldOffest = copyIndex * objectFieldListItemLength;
-            int16_t fieldToOffest = fieldOffest + objectFieldListItemLength;
-            heapPointerNewObjectFieldItemPtr[fieldToOffest].value.intValue = heapPointerObjectFieldItemPtr[fieldOffest].value.intValue;
-            heapPointerNewObjectFieldItemPtr[fieldToOffest + 1].value.intValue = heapPointerObjectFieldItemPtr[fieldOffest + 1].value.intValue;
-            copyIndex += 1;
-        }
+/*
+    µջ֡ λ offest Ԥ SP PC հ֮
+*/
+static void VMEnterFunction(VirtualMachine& vm, int16_t offest, int16_t parameterCount, int32_t heapPointerClosure, int32_t programPosition) {
+    const int32_t stackPointerAndProgramCounterAndClosureOffest = 3;
+    int32_t stackPointer = vm.stackPointer;
+    int32_t programCounter = vm.programCounter + 1;
+
+    vm.stackPointer = vm.stackPointer + offest + 1;
+    vm.programCounter = programPosition;
+    vm.stackOffest = stackPointerAndProgramCounterAndClosureOffest + parameterCount;
+    VMStackMemoryByOffest(vm, 0)->intValue = stackPointer;
+    VMStackMemoryByOffest(vm, 1)->intValue = programCounter;
+    VMStackMemoryByOffest(vm, 2)->intValue = heapPointerClosure;
+}
 
-        heapPointerObjectPtr[1].value.intValue = heapPointerNewObjectFieldList;
-    } else {
-        int16_t currentLength = prevousLength + 1;
-        heapPointerObjectFieldListPtr[1].value.length = currentLength;;
-        //
-        int16_t copyIndex = prevousLength;
-        while (copyIndex != arrayIndex) {
-            int16_t fieldOffest = copyIndex * 2 - 2;
-            int16_t fieldToOffest = copyIndex * 2;
-            heapPointerObjectFieldItemPtr[fieldToOffest].value.intValue = heapPointerObjectFieldItemPtr[fieldOffest].value.intValue;
-            heapPointerObjectFieldItemPtr[fieldToOffest + 1].value.intValue = heapPointerObjectFieldItemPtr[fieldOffest + 1].value.intValue;
-            copyIndex -= 1;
-        }
-        int16_t fieldOffest = arrayIndex * 2;
-        heapPointerObjectFieldItemPtr[fieldOffest].value.intValue = index;
-        heapPointerObjectFieldItemPtr[fieldOffest + 1].value.intValue = heapPointerExpression;
+/*
+    ôĻջеĺͬʱػ ͺͲ ¼
+    LocalFunction ¼  nullptr
+*/
+static VMCallCache* VMCallCacheLookup(VirtualMachine& vm, int32_t heapPointerFunction, int16_t parameterCount) {
+    auto& cache = vm.callCache[vm.programCounter];
+    if (cache.function == heapPointerFunction) {
+        return &cache;
+    }
+    vm.callCacheMiss += 1;
+    auto heapPointerFunctionPtr = VMHeapMemory(vm, heapPointerFunction);
+    auto type = heapPointerFunctionPtr->value.typeHead.type;
+    if (type == HeapEnum::LocalFunction) {
+        return nullptr;
+    }
+    if (type != HeapEnum::Function) {
+        throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "ͲΪ Function  LocalFuntion");
+    }
+    int16_t functionParameterCount = heapPointerFunctionPtr[1].value.length;
+    if (functionParameterCount != parameterCount) {
+        throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "ȷ");
     }
+    cache.function = heapPointerFunction;
+    cache.closure = heapPointerFunctionPtr[2].value.intValue;
+    cache.programPosition = heapPointerFunctionPtr[3].value.intValue;
+    return &cache;
+}
+
+static void VMCallLocalFunction(VirtualMachine& vm, int16_t offest, int16_t parameterCount, int32_t heapPointerFunction) {
+    int32_t localFunctionIndex = VMHeapMemory(vm, heapPointerFunction)[1].value.intValue;
+    VMStackMemoryByOffest(vm, offest)->intValue = vm.localFunctionList[localFunctionIndex](&vm, parameterCount);
     VMSetUpNewOffest(vm, offest);
     VMProgramCounterInc(vm);
 }
 
+/*
+    ͬһôٴεͬһʱ ֻȽһκָ հͺλôӻжȡ
+*/
 void VMFunctionCall(VirtualMachine& vm, int16_t offest, int16_t parameterCount) {
     int32_t heapPointerFunction = VMStackMemoryByOffest(vm, offest)->intValue;
-    auto heapPointerFunctionPtr = VMHeapMemory(vm, heapPointerFunction);
-    auto type = heapPointerFunctionPtr->value.typeHead.type;
-    if (type == HeapEnum::LocalFunction) {
-        int32_t localFunctionIndex = heapPointerFunctionPtr[1].value.intValue;
-        VMStackMemoryByOffest(vm, offest)->intValue = vm.localFunctionList[localFunctionIndex](&vm, parameterCount);
-        VMSetUpNewOffest(vm, offest);
-        VMProgramCounterInc(vm);
-    } else if (type == HeapEnum::Function) {
-        int16_t functionParameterCount = heapPointerFunctionPtr[1].value.length;
-        if (functionParameterCount != parameterCount) {
-            throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "ȷ");
-        }
-        const int32_t stackPointerAndProgramCounterAndClosureOffest = 3;
+    auto cache = VMCallCacheLookup(vm, heapPointerFunction, parameterCount);
+    if (cache == nullptr) {
+        VMCallLocalFunction(vm, offest, parameterCount, heapPointerFunction);
+        return;
+    }
+    VMEnterFunction(vm, offest, parameterCount, cache->closure, cache->programPosition);
+}
 
-        int32_t stackPointer = vm.stackPointer;
-        int32_t programCounter = vm.programCounter + 1;
-        int32_t heapPointerClosure = heapPointerFunctionPtr[2].value.intValue;
+/*
+    return f(...) ٴµջ֡ úֱʹõǰջ֡
+    ԭ ջָ صַ ֻ滻հͲ ʱֱӻصǰĵ
+    غʹջ ͨô ֮ Return ָؽ
+*/
+void VMTailCall(VirtualMachine& vm, int16_t offest, int16_t parameterCount) {
+    int32_t heapPointerFunction = VMStackMemoryByOffest(vm, offest)->intValue;
+    auto cache = VMCallCacheLookup(vm, heapPointerFunction, parameterCount);
+    if (cache == nullptr) {
+        VMCallLocalFunction(vm, offest, parameterCount, heapPointerFunction);
+        return;
+    }
+    const int32_t stackPointerAndProgramCounterAndClosureOffest = 3;
+    const int16_t parameterOffest = offest + 1 + stackPointerAndProgramCounterAndClosureOffest;
+
+    VMStackMemoryByOffest(vm, 2)->intValue = cache->closure;
+    for (int16_t i = 0; i < parameterCount; i++) {
+        auto from = VMStackMemoryByOffest(vm, parameterOffest + i);
+        auto to = VMStackMemoryByOffest(vm, stackPointerAndProgramCounterAndClosureOffest + i);
+        to->intValue = from->intValue;
+    }
+    vm.programCounter = cache->programPosition;
+    vm.stackOffest = stackPointerAndProgramCounterAndClosureOffest + parameterCount;
+}
 
-        int32_t newStackPointer = vm.stackPointer + offest + 1;
-        int32_t newProgramCounter = heapPointerFunctionPtr[3].value.intValue;
+/*
+    ֱӵñغ λջ ڵһλ
+    ʱѾȷָעıغ Ҫȡհͼ
+*/
+void VMCallNative(VirtualMachine& vm, int16_t offest, int8_t parameterCount, int32_t index) {
+    int32_t result = vm.localFunctionList[index](&vm, parameterCount);
+    VMSetUpNewOffest(vm, offest);
+    VMStackMemory(vm)->intValue = result;
+    VMProgramCounterInc(vm);
+}
 
-        vm.stackPointer = newStackPointer;
-        vm.programCounter = newProgramCounter;
-        vm.stackOffest = stackPointerAndProgramCounterAndClosureOffest + functionParameterCount;
-        VMStackMemoryByOffest(vm, 0)->intValue = stackPointer;
-        VMStackMemoryByOffest(vm, 1)->intValue = programCounter;
-        VMStackMemoryByOffest(vm, 2)->intValue = heapPointerClosure;
-    } else {
-        throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "ͲΪ Function  LocalFuntion");
+/*
+     ջ֡ıհ뵱ǰջ֡ͬ
+    λúͲڱʱѾȷ ȡ ͺͲ
+*/
+void VMCallSelf(VirtualMachine& vm, int16_t offest, int8_t parameterCount, int32_t programPosition) {
+    VMEnterFunction(vm, offest, parameterCount, VMStackMemoryByOffest(vm, 2)->intValue, programPosition);
+}
+
+/*
+    ú  Main עͬغΪͬ Ͳȷʱ׳ RuntimeException
+    ȡ֮ŷ ʱջ
+*/
+static HeapType* VMIntrinsicParameter(VirtualMachine& vm, int16_t offest, HeapEnum type, const string& name) {
+    VMSetUpNewOffest(vm, offest);
+    auto heapPointer = VMHeapMemory(vm, VMStackMemory(vm)->intValue);
+    if (heapPointer->value.typeHead.type != type) {
+        throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + name + " ");
     }
+    return heapPointer;
+}
+
+void VMArrayLength(VirtualMachine& vm, int16_t offest) {
+    auto heapPointerArrayPtr = VMIntrinsicParameter(vm, offest, HeapEnum::Array, "ArrayLength");
+    VMStackMemory(vm)->intValue = VMIntToHeapPointer(vm, heapPointerArrayPtr[1].value.length);
+    VMProgramCounterInc(vm);
+}
+
+void VMObjectFieldCount(VirtualMachine& vm, int16_t offest) {
+    auto heapPointerObjectPtr = VMIntrinsicParameter(vm, offest, HeapEnum::Object, "ObjectFieldCount");
+    auto heapPointerObjectFieldListPtr = VMHeapMemory(vm, heapPointerObjectPtr[1].value.intValue);
+    VMStackMemory(vm)->intValue = VMIntToHeapPointer(vm, heapPointerObjectFieldListPtr[1].value.length);
+    VMProgramCounterInc(vm);
+}
+
+void VMTypeOf(VirtualMachine& vm, int16_t offest) {
+    VMSetUpNewOffest(vm, offest);
+    auto type = VMHeapMemory(vm, VMStackMemory(vm)->intValue)->value.typeHead.type;
+    VMStackMemory(vm)->intValue = VMIntToHeapPointer(vm, static_cast<int32_t>(type));
+    VMProgramCounterInc(vm);
+}
+
+void VMCharToInt(VirtualMachine& vm, int16_t offest) {
+    auto heapPointerCharPtr = VMIntrinsicParameter(vm, offest, HeapEnum::Char, "CharToInt");
+    VMStackMemory(vm)->intValue = VMIntToHeapPointer(vm, static_cast<int32_t>(heapPointerCharPtr[1].value.word[0]));
+    VMProgramCounterInc(vm);
+}
+
+void VMIntToChar(VirtualMachine& vm, int16_t offest) {
+    auto heapPointerIntPtr = VMIntrinsicParameter(vm, offest, HeapEnum::Int, "IntToChar");
+    VMStackMemory(vm)->intValue = VMCharToHeapPointer(vm, static_cast<wchar_t>(heapPointerIntPtr[1].value.intValue));
+    VMProgramCounterInc(vm);
 }
 
 void VMJump(VirtualMachine& vm, int16_t offest, int32_t program) {
@@ -1467,4 +2089,533 @@ void VMNotEquals(VirtualMachine& vm, int16_t offest) {
         }
     }
     VMProgramCounterInc(vm);
+}
+
+InstructionEnum VMImmediateOperation(InstructionEnum op) {
+    switch (op) {
+        case InstructionEnum::MultiplyImmediate:
+            return InstructionEnum::Multiply;
+        case InstructionEnum::DivideImmediate:
+            return InstructionEnum::Divide;
+        case InstructionEnum::ModulusImmediate:
+            return InstructionEnum::Modulus;
+        case InstructionEnum::AddImmediate:
+            return InstructionEnum::Add;
+        case InstructionEnum::SubtractImmediate:
+            return InstructionEnum::Subtract;
+        case InstructionEnum::LessImmediate:
+            return InstructionEnum::Less;
+        case InstructionEnum::LessEqualsImmediate:
+            return InstructionEnum::LessEquals;
+        case InstructionEnum::GreaterImmediate:
+            return InstructionEnum::Greater;
+        case InstructionEnum::GreaterEqualsImmediate:
+            return InstructionEnum::GreaterEquals;
+        case InstructionEnum::EqualsImmediate:
+            return InstructionEnum::Equals;
+        case InstructionEnum::NotEqualsImmediate:
+            return InstructionEnum::NotEquals;
+        default:
+            throw CompilerError();
+    }
+}
+
+bool VMIsNumber(HeapEnum type) {
+    return type == HeapEnum::Int || type == HeapEnum::Float;
+}
+
+float VMGetNumber(HeapEnum type, const HeapType& value) {
+    if (type == HeapEnum::Int) {
+        return static_cast<float>(value.value.intValue);
+    } else {
+        return value.value.floatValue;
+    }
+}
+
+void VMBinaryOperationImmediate(VirtualMachine& vm, int16_t offest, InstructionEnum op, const Instruction& instruction) {
+    int32_t heapPointerLeft = VMStackMemoryByOffest(vm, offest)->intValue;
+    auto left = VMHeapMemory(vm, heapPointerLeft);
+    auto leftType = left->value.typeHead.type;
+    auto rightType = static_cast<HeapEnum>(instruction.reserved);
+    //նеĲַʱڴ  operationMap Ĳһ
+    HeapType right[2];
+    right[0].value.typeHead.type = rightType;
+    right[1].value.intValue = instruction.value.intValue;
+
+    int32_t heapPointerResult;
+    if (leftType == HeapEnum::Int && rightType == HeapEnum::Int) {
+        int32_t leftValue = left[1].value.intValue;
+        int32_t rightValue = right[1].value.intValue;
+        int32_t value;
+        switch (op) {
+            case InstructionEnum::MultiplyImmediate:
+                value = leftValue * rightValue;
+                break;
+            case InstructionEnum::DivideImmediate:
+                value = leftValue / rightValue;
+                break;
+            case InstructionEnum::ModulusImmediate:
+                value = leftValue % rightValue;
+                break;
+            case InstructionEnum::AddImmediate:
+                value = leftValue + rightValue;
+                break;
+            case InstructionEnum::SubtractImmediate:
+                value = leftValue - rightValue;
+                break;
+            default:
+                throw CompilerError();
+        }
+        heapPointerResult = VMIntToHeapPointer(vm, value);
+    } else if (VMIsNumber(leftType) && VMIsNumber(rightType)) {
+        float leftValue = VMGetNumber(leftType, left[1]);
+        float rightValue = VMGetNumber(rightType, right[1]);
+        float value;
+        switch (op) {
+            case InstructionEnum::MultiplyImmediate:
+                value = leftValue * rightValue;
+                break;
+            case InstructionEnum::DivideImmediate:
+                value = leftValue / rightValue;
+                break;
+            case InstructionEnum::ModulusImmediate:
+                value = fmodf(leftValue, rightValue);
+                break;
+            case InstructionEnum::AddImmediate:
+                value = leftValue + rightValue;
+                break;
+            case InstructionEnum::SubtractImmediate:
+                value = leftValue - rightValue;
+                break;
+            default:
+                throw CompilerError();
+        }
+        heapPointerResult = VMAllocateHeapMemory(vm, HeapEnum::Float, 2);
+        VMHeapMemory(vm, heapPointerResult)[1].value.floatValue = value;
+    } else {
+        auto find = vm.operationMap.find(OperationKey(VMImmediateOperation(op), leftType, rightType));
+        if (find == vm.operationMap.end()) {
+            throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "Ԫ Ͳȷ");
+        }
+        heapPointerResult = find->second(vm, left, right);
+    }
+    VMSetUpNewOffest(vm, offest);
+    VMStackMemory(vm)->intValue = heapPointerResult;
+    VMProgramCounterInc(vm);
+}
+
+void VMCompareOperationImmediate(VirtualMachine& vm, int16_t offest, InstructionEnum op, const Instruction& instruction) {
+    int32_t heapPointerLeft = VMStackMemoryByOffest(vm, offest)->intValue;
+    auto left = VMHeapMemory(vm, heapPointerLeft);
+    auto leftType = left->value.typeHead.type;
+    auto rightType = static_cast<HeapEnum>(instruction.reserved);
+    HeapType right[2];
+    right[0].value.typeHead.type = rightType;
+    right[1].value.intValue = instruction.value.intValue;
+
+    bool result;
+    if (op == InstructionEnum::EqualsImmediate || op == InstructionEnum::NotEqualsImmediate) {
+        // equalsMap һ Int  Float ֮䲻
+        bool equals = false;
+        if (leftType == rightType && rightType == HeapEnum::Int) {
+            equals = left[1].value.intValue == right[1].value.intValue;
+        } else if (leftType == rightType && rightType == HeapEnum::Float) {
+            equals = left[1].value.floatValue == right[1].value.floatValue;
+        }
+        result = (op == InstructionEnum::EqualsImmediate) ? equals : !equals;
+    } else if (leftType == HeapEnum::Int && rightType == HeapEnum::Int) {
+        int32_t leftValue = left[1].value.intValue;
+        int32_t rightValue = right[1].value.intValue;
+        switch (op) {
+            case InstructionEnum::LessImmediate:
+                result = leftValue < rightValue;
+                break;
+            case InstructionEnum::LessEqualsImmediate:
+                result = leftValue <= rightValue;
+                break;
+            case InstructionEnum::GreaterImmediate:
+                result = leftValue > rightValue;
+                break;
+            case InstructionEnum::GreaterEqualsImmediate:
+                result = leftValue >= rightValue;
+                break;
+            default:
+                throw CompilerError();
+        }
+    } else {
+        auto find = vm.compareMap.find(OperationKey(VMImmediateOperation(op), leftType, rightType));
+        if (find == vm.compareMap.end()) {
+            throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "Ƚϲ Ͳȷ");
+        }
+        result = find->second(vm, left, right);
+    }
+    VMSetUpNewOffest(vm, offest);
+    VMStackMemory(vm)->intValue = VMBoolToHeapPointer(result);
+    VMProgramCounterInc(vm);
+}
+
+void VMBinaryOperationInt(VirtualMachine& vm, int16_t offest, InstructionEnum op) {
+    int32_t heapPointerLeft = VMStackMemoryByOffest(vm, offest)->intValue;
+    int32_t heapPointerRight = VMStackMemoryByOffest(vm, offest + 1)->intValue;
+    int32_t leftValue = VMHeapMemory(vm, heapPointerLeft)[1].value.intValue;
+    int32_t rightValue = VMHeapMemory(vm, heapPointerRight)[1].value.intValue;
+    int32_t value;
+    switch (op) {
+        case InstructionEnum::MultiplyInt:
+            value = leftValue * rightValue;
+            break;
+        case InstructionEnum::DivideInt:
+            value = leftValue / rightValue;
+            break;
+        case InstructionEnum::ModulusInt:
+            value = leftValue % rightValue;
+            break;
+        case InstructionEnum::AddInt:
+            value = leftValue + rightValue;
+            break;
+        case InstructionEnum::SubtractInt:
+            value = leftValue - rightValue;
+            break;
+        default:
+            throw CompilerError();
+    }
+    int32_t heapPointerResult = VMIntToHeapPointer(vm, value);
+    VMSetUpNewOffest(vm, offest);
+    VMStackMemory(vm)->intValue = heapPointerResult;
+    VMProgramCounterInc(vm);
+}
+
+void VMBinaryOperationFloat(VirtualMachine& vm, int16_t offest, InstructionEnum op) {
+    int32_t heapPointerLeft = VMStackMemoryByOffest(vm, offest)->intValue;
+    int32_t heapPointerRight = VMStackMemoryByOffest(vm, offest + 1)->intValue;
+    float leftValue = VMHeapMemory(vm, heapPointerLeft)[1].value.floatValue;
+    float rightValue = VMHeapMemory(vm, heapPointerRight)[1].value.floatValue;
+    float value;
+    switch (op) {
+        case InstructionEnum::MultiplyFloat:
+            value = leftValue * rightValue;
+            break;
+        case InstructionEnum::DivideFloat:
+            value = leftValue / rightValue;
+            break;
+        case InstructionEnum::ModulusFloat:
+            value = fmodf(leftValue, rightValue);
+            break;
+        case InstructionEnum::AddFloat:
+            value = leftValue + rightValue;
+            break;
+        case InstructionEnum::SubtractFloat:
+            value = leftValue - rightValue;
+            break;
+        default:
+            throw CompilerError();
+    }
+    int32_t heapPointerResult = VMAllocateHeapMemory(vm, HeapEnum::Float, 2);
+    VMHeapMemory(vm, heapPointerResult)[1].value.floatValue = value;
+    VMSetUpNewOffest(vm, offest);
+    VMStackMemory(vm)->intValue = heapPointerResult;
+    VMProgramCounterInc(vm);
+}
+
+void VMCompareOperationInt(VirtualMachine& vm, int16_t offest, InstructionEnum op) {
+    int32_t heapPointerLeft = VMStackMemoryByOffest(vm, offest)->intValue;
+    int32_t heapPointerRight = VMStackMemoryByOffest(vm, offest + 1)->intValue;
+    int32_t leftValue = VMHeapMemory(vm, heapPointerLeft)[1].value.intValue;
+    int32_t rightValue = VMHeapMemory(vm, heapPointerRight)[1].value.intValue;
+    bool result;
+    switch (op) {
+        case InstructionEnum::LessInt:
+            result = leftValue < rightValue;
+            break;
+        case InstructionEnum::LessEqualsInt:
+            result = leftValue <= rightValue;
+            break;
+        case InstructionEnum::GreaterInt:
+            result = leftValue > rightValue;
+            break;
+        case InstructionEnum::GreaterEqualsInt:
+            result = leftValue >= rightValue;
+            break;
+        default:
+            throw CompilerError();
+    }
+    VMSetUpNewOffest(vm, offest);
+    VMStackMemory(vm)->intValue = VMBoolToHeapPointer(result);
+    VMProgramCounterInc(vm);
+}
+
+void VMCompareOperationFloat(VirtualMachine& vm, int16_t offest, InstructionEnum op) {
+    int32_t heapPointerLeft = VMStackMemoryByOffest(vm, offest)->intValue;
+    int32_t heapPointerRight = VMStackMemoryByOffest(vm, offest + 1)->intValue;
+    float leftValue = VMHeapMemory(vm, heapPointerLeft)[1].value.floatValue;
+    float rightValue = VMHeapMemory(vm, heapPointerRight)[1].value.floatValue;
+    bool result;
+    switch (op) {
+        case InstructionEnum::LessFloat:
+            result = leftValue < rightValue;
+            break;
+        case InstructionEnum::LessEqualsFloat:
+            result = leftValue <= rightValue;
+            break;
+        case InstructionEnum::GreaterFloat:
+            result = leftValue > rightValue;
+            break;
+        case InstructionEnum::GreaterEqualsFloat:
+            result = leftValue >= rightValue;
+            break;
+        default:
+            throw CompilerError();
+    }
+    VMSetUpNewOffest(vm, offest);
+    VMStackMemory(vm)->intValue = VMBoolToHeapPointer(result);
+    VMProgramCounterInc(vm);
+}
+
+/*
+    Map ļΪ Int Char String ׳쳣
+*/
+static int32_t VMMapKeyHash(VirtualMachine& vm, HeapType* key, const string& name) {
+    switch (key->value.typeHead.type) {
+        case HeapEnum::Int:
+            return key[1].value.intValue;
+        case HeapEnum::Char:
+            return static_cast<int32_t>(key[1].value.word[0]);
+        case HeapEnum::String:
+            return VMStringHash(vm, key);
+        default:
+            throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + name + " ͱΪ Int Char String");
+    }
+}
+
+static bool VMMapKeyEquals(VirtualMachine& vm, HeapType* left, HeapType* right) {
+    auto type = left->value.typeHead.type;
+    if (type != right->value.typeHead.type) {
+        return false;
+    }
+    switch (type) {
+        case HeapEnum::Int:
+            return left[1].value.intValue == right[1].value.intValue;
+        case HeapEnum::Char:
+            return left[1].value.word[0] == right[1].value.word[0];
+        case HeapEnum::String:
+            return VMStringGet(vm, left) == VMStringGet(vm, right);
+        default:
+            throw CompilerError();
+    }
+}
+
+/*
+    MapTable вҼ ؼڵλ ( MapTable Ŀʼ) ʱ -1
+    insertPosition Ϊ nullptr ʱ¼Էλ (̽⵽ĵһɾλû߿λ)
+    ûм Map  MapTable (Ϊ null)
+*/
+static int32_t VMMapTableFind(VirtualMachine& vm, HeapType* heapPointerMapTablePtr, int32_t hash, HeapType* key, int32_t* insertPosition) {
+    const int32_t typeHeadAndOther = 3;
+    if (heapPointerMapTablePtr->value.typeHead.type != HeapEnum::MapTable) {
+        if (insertPosition != nullptr) {
+            *insertPosition = -1;
+        }
+        return -1;
+    }
+    uint32_t mask = (heapPointerMapTablePtr->value.typeHead.memorylength - typeHeadAndOther) / 3 - 1;
+    uint32_t mix = static_cast<uint32_t>(hash) * 2654435769u;
+    uint32_t position = (mix ^ (mix >> 16)) & mask;
+    int32_t deleted = -1;
+    while (true) {
+        int32_t item = typeHeadAndOther + 3 * position;
+        int32_t heapPointerKey = heapPointerMapTablePtr[item + 1].value.intValue;
+        if (heapPointerKey == -1) {
+            if (insertPosition != nullptr) {
+                *insertPosition = deleted != -1 ? deleted : item;
+            }
+            return -1;
+        }
+        if (heapPointerKey == -2) {
+            if (deleted == -1) {
+                deleted = item;
+            }
+        } else if (heapPointerMapTablePtr[item].value.intValue == hash && VMMapKeyEquals(vm, VMHeapMemory(vm, heapPointerKey), key)) {
+            return item;
+        }
+        position = (position + 1) & mask;
+    }
+}
+
+/*
+    ·ܷ count  MapTable ԭеļ ɾλ
+    ֮´ջжȡ Map
+*/
+static void VMMapTableResize(VirtualMachine& vm, int16_t parameterCount, int32_t count) {
+    const int32_t typeHeadAndOther = 3;
+    const int32_t capacityMin = 8;
+    const int32_t capacityMax = 8192;
+    int32_t newCapacity = capacityMin;
+    while (count * 4 > newCapacity * 3) {
+        newCapacity *= 2;
+    }
+    if (newCapacity > capacityMax) {
+        throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + "Map ĸ");
+    }
+    int32_t heapPointerNewMapTable = VMAllocateHeapMemory(vm, HeapEnum::MapTable, typeHeadAndOther + newCapacity * 3);
+    auto heapPointerMapPtr = VMLocalFunctionGetParameter(vm, parameterCount, 0);
+    auto heapPointerOldPtr = VMHeapMemory(vm, heapPointerMapPtr[1].value.intValue);
+    auto heapPointerNewMapTablePtr = VMHeapMemory(vm, heapPointerNewMapTable);
+    for (int32_t i = 0; i < newCapacity; i++) {
+        heapPointerNewMapTablePtr[typeHeadAndOther + 3 * i + 1].value.intValue = -1;
+    }
+    int16_t length = 0;
+    if (heapPointerOldPtr->value.typeHead.type == HeapEnum::MapTable) {
+        int32_t capacity = (heapPointerOldPtr->value.typeHead.memorylength - typeHeadAndOther) / 3;
+        for (int32_t i = 0; i < capacity; i++) {
+            auto oldItem = heapPointerOldPtr + typeHeadAndOther + 3 * i;
+            if (oldItem[1].value.intValue < 0) {
+                continue;
+            }
+            uint32_t mix = static_cast<uint32_t>(oldItem[0].value.intValue) * 2654435769u;
+            uint32_t position = (mix ^ (mix >> 16)) & (newCapacity - 1);
+            while (heapPointerNewMapTablePtr[typeHeadAndOther + 3 * position + 1].value.intValue != -1) {
+                position = (position + 1) & (newCapacity - 1);
+            }
+            auto newItem = heapPointerNewMapTablePtr + typeHeadAndOther + 3 * position;
+            for (int32_t j = 0; j < 3; j++) {
+                newItem[j].value.intValue = oldItem[j].value.intValue;
+            }
+            length += 1;
+        }
+    }
+    heapPointerNewMapTablePtr[1].value.length = length;
+    heapPointerNewMapTablePtr[2].value.intValue = length;
+    heapPointerMapPtr[1].value.intValue = heapPointerNewMapTable;
+}
+
+static HeapType* VMMapParameter(VirtualMachine& vm, int16_t parameterCount, int16_t count, const string& name) {
+    if (parameterCount != count) {
+        throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + name + " Ϊ " + std::to_string(count));
+    }
+    auto heapPointerMapPtr = VMLocalFunctionGetParameter(vm, parameterCount, 0);
+    if (heapPointerMapPtr->value.typeHead.type != HeapEnum::Map) {
+        throw RuntimeException(MessageHead(VMCurrentProgramLine(vm)) + name + " ");
+    }
+    return heapPointerMapPtr;
+}
+
+int32_t VMMapCreate(VirtualMachine* vm, int16_t parameterCount) {
+    if (parameterCount != 0) {
+        throw RuntimeException(MessageHead(VMCurrentProgramLine(*vm)) + "Map Ϊ 0");
+    }
+    int32_t heapPointerMap = VMAllocateHeapMemory(*vm, HeapEnum::Map, 2);
+    VMHeapMemory(*vm, heapPointerMap)[1].value.intValue = VMNullToHeapPointer();
+    return heapPointerMap;
+}
+
+int32_t VMMapGet(VirtualMachine* vm, int16_t parameterCount) {
+    auto heapPointerMapPtr = VMMapParameter(*vm, parameterCount, 2, "MapGet");
+    auto heapPointerKeyPtr = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+    int32_t hash = VMMapKeyHash(*vm, heapPointerKeyPtr, "MapGet");
+    auto heapPointerMapTablePtr = VMHeapMemory(*vm, heapPointerMapPtr[1].value.intValue);
+    int32_t position = VMMapTableFind(*vm, heapPointerMapTablePtr, hash, heapPointerKeyPtr, nullptr);
+    if (position == -1) {
+        return VMNullToHeapPointer();
+    }
+    return heapPointerMapTablePtr[position + 2].value.intValue;
+}
+
+/*
+    µļʱ ĸɾλó 3/4 · MapTable
+*/
+int32_t VMMapSet(VirtualMachine* vm, int16_t parameterCount) {
+    const int32_t typeHeadAndOther = 3;
+    auto heapPointerMapPtr = VMMapParameter(*vm, parameterCount, 3, "MapSet");
+    auto heapPointerKeyPtr = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+    int32_t hash = VMMapKeyHash(*vm, heapPointerKeyPtr, "MapSet");
+    auto heapPointerMapTablePtr = VMHeapMemory(*vm, heapPointerMapPtr[1].value.intValue);
+    int32_t insertPosition = -1;
+    int32_t position = VMMapTableFind(*vm, heapPointerMapTablePtr, hash, heapPointerKeyPtr, &insertPosition);
+    if (position == -1) {
+        bool resize = insertPosition == -1;
+        if (!resize && heapPointerMapTablePtr[insertPosition + 1].value.intValue == -1) {
+            int32_t capacity = (heapPointerMapTablePtr->value.typeHead.memorylength - typeHeadAndOther) / 3;
+            resize = (heapPointerMapTablePtr[2].value.intValue + 1) * 4 > capacity * 3;
+        }
+        if (resize) {
+            int32_t length = insertPosition == -1 ? 0 : heapPointerMapTablePtr[1].value.length;
+            VMMapTableResize(*vm, parameterCount, length + 1);
+            heapPointerMapPtr = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+            heapPointerKeyPtr = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+            heapPointerMapTablePtr = VMHeapMemory(*vm, heapPointerMapPtr[1].value.intValue);
+            VMMapTableFind(*vm, heapPointerMapTablePtr, hash, heapPointerKeyPtr, &insertPosition);
+        }
+        if (heapPointerMapTablePtr[insertPosition + 1].value.intValue == -1) {
+            heapPointerMapTablePtr[2].value.intValue += 1;
+        }
+        heapPointerMapTablePtr[1].value.length += 1;
+        heapPointerMapTablePtr[insertPosition].value.intValue = hash;
+        heapPointerMapTablePtr[insertPosition + 1].value.intValue = VMLocalFunctionParamete(*vm, parameterCount)[1].intValue;
+        position = insertPosition;
+    }
+    heapPointerMapTablePtr[position + 2].value.intValue = VMLocalFunctionParamete(*vm, parameterCount)[2].intValue;
+    return VMNullToHeapPointer();
+}
+
+int32_t VMMapHas(VirtualMachine* vm, int16_t parameterCount) {
+    auto heapPointerMapPtr = VMMapParameter(*vm, parameterCount, 2, "MapHas");
+    auto heapPointerKeyPtr = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+    int32_t hash = VMMapKeyHash(*vm, heapPointerKeyPtr, "MapHas");
+    auto heapPointerMapTablePtr = VMHeapMemory(*vm, heapPointerMapPtr[1].value.intValue);
+    return VMBoolToHeapPointer(VMMapTableFind(*vm, heapPointerMapTablePtr, hash, heapPointerKeyPtr, nullptr) != -1);
+}
+
+//ɾλñΪ -2 ʱ̽ Ƿ
+int32_t VMMapDelete(VirtualMachine* vm, int16_t parameterCount) {
+    auto heapPointerMapPtr = VMMapParameter(*vm, parameterCount, 2, "MapDelete");
+    auto heapPointerKeyPtr = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+    int32_t hash = VMMapKeyHash(*vm, heapPointerKeyPtr, "MapDelete");
+    auto heapPointerMapTablePtr = VMHeapMemory(*vm, heapPointerMapPtr[1].value.intValue);
+    int32_t position = VMMapTableFind(*vm, heapPointerMapTablePtr, hash, heapPointerKeyPtr, nullptr);
+    if (position == -1) {
+        return VMBoolToHeapPointer(false);
+    }
+    heapPointerMapTablePtr[position + 1].value.intValue = -2;
+    heapPointerMapTablePtr[position + 2].value.intValue = VMNullToHeapPointer();
+    heapPointerMapTablePtr[1].value.length -= 1;
+    return VMBoolToHeapPointer(true);
+}
+
+int32_t VMMapSize(VirtualMachine* vm, int16_t parameterCount) {
+    auto heapPointerMapPtr = VMMapParameter(*vm, parameterCount, 1, "MapSize");
+    auto heapPointerMapTablePtr = VMHeapMemory(*vm, heapPointerMapPtr[1].value.intValue);
+    int32_t length = 0;
+    if (heapPointerMapTablePtr->value.typeHead.type == HeapEnum::MapTable) {
+        length = heapPointerMapTablePtr[1].value.length;
+    }
+    return VMIntToHeapPointer(*vm, length);
+}
+
+// MapTable е˳ ûмʱΪΪ 0 
+int32_t VMMapKeys(VirtualMachine* vm, int16_t parameterCount) {
+    const int32_t typeHeadAndOther = 3;
+    auto heapPointerMapPtr = VMMapParameter(*vm, parameterCount, 1, "MapKeys");
+    auto heapPointerMapTablePtr = VMHeapMemory(*vm, heapPointerMapPtr[1].value.intValue);
+    int16_t length = 0;
+    if (heapPointerMapTablePtr->value.typeHead.type == HeapEnum::MapTable) {
+        length = heapPointerMapTablePtr[1].value.length;
+    }
+    int32_t heapPointerArray = VMAllocateHeapMemory(*vm, HeapEnum::Array, 2 + length);
+    auto heapPointerArrayPtr = VMHeapMemory(*vm, heapPointerArray);
+    heapPointerArrayPtr[1].value.length = length;
+    if (length == 0) {
+        return heapPointerArray;
+    }
+    heapPointerMapPtr = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+    heapPointerMapTablePtr = VMHeapMemory(*vm, heapPointerMapPtr[1].value.intValue);
+    int32_t capacity = (heapPointerMapTablePtr->value.typeHead.memorylength - typeHeadAndOther) / 3;
+    int16_t index = 0;
+    for (int32_t i = 0; i < capacity; i++) {
+        int32_t heapPointerKey = heapPointerMapTablePtr[typeHeadAndOther + 3 * i + 1].value.intValue;
+        if (heapPointerKey >= 0) {
+            heapPointerArrayPtr[2 + index].value.intValue = heapPointerKey;
+            index += 1;
+        }
+    }
+    return heapPointerArray;
 }
\ No newline at end of file
@@ -15,16 +15,25 @@ public:
     void RegistLocalFunction(const wstring& idName, function<int32_t(VirtualMachine*, int16_t)> localFunction);
     void SetStackMax(int32_t value);
     void SetHeapMax(int32_t value);
+    void SetSmallIntegerCache(int32_t min, int32_t max);
+    //¼ÿִָд ڵõȴ벼ִֵм¼
+    void SetProfile(bool value);
     VirtualMachine Build();
 private:
+    bool profile;
     int32_t stackMax;
     int32_t heapMax;
+    int32_t smallIntegerMin;
+    int32_t smallIntegerMax;
     vector<Instruction> instruction;
+    vector<ConstantData> constantPool;
     vector<int> instructionLine;
     vector<wstring> registeredNames;
     vector<wstring> staticString;
     vector<int> mainClosureOffest;
     map<wstring, int32_t> stringMap;
+    vector<StaticFunctionData> staticFunction;
+    function<LazyCompileResult(int32_t, int32_t)> lazyCompile;
     vector<function<int32_t(VirtualMachine*, int16_t)>> localFunctionList;
 };
 
@@ -46,9 +55,24 @@ HeapEnum VMLocalFunctionGetType(VirtualMachine& vm, HeapType* heapPointer);
 wstring_view VMLocalFunctionGetStringData(VirtualMachine& vm, HeapType* str);
 HeapType* VMLocalFunctionGetParameter(VirtualMachine& vm, int16_t parameterCount, int16_t parameterIndex);
 
+/*
+    Map ıغ ֱ RegistLocalFunction ע
+    Map() MapGet(map, key) MapSet(map, key, value) MapHas(map, key) MapDelete(map, key) MapSize(map) MapKeys(map)
+    Ϊ Int Char String ֵͬʱΪͬһ MapGet ڵļΪ null MapKeys мɵ
+*/
+int32_t VMMapCreate(VirtualMachine* vm, int16_t parameterCount);
+int32_t VMMapGet(VirtualMachine* vm, int16_t parameterCount);
+int32_t VMMapSet(VirtualMachine* vm, int16_t parameterCount);
+int32_t VMMapHas(VirtualMachine* vm, int16_t parameterCount);
+int32_t VMMapDelete(VirtualMachine* vm, int16_t parameterCount);
+int32_t VMMapSize(VirtualMachine* vm, int16_t parameterCount);
+int32_t VMMapKeys(VirtualMachine* vm, int16_t parameterCount);
+
 
 int32_t VMBoolToHeapPointer(bool v);
 int32_t VMNullToHeapPointer();
+int32_t VMIntToHeapPointer(VirtualMachine& vm, int32_t value);
+int32_t VMCharToHeapPointer(VirtualMachine& vm, wchar_t value);
 void VMProgramCounterInc(VirtualMachine& vm);
 void VMSetUpNewOffest(VirtualMachine& vm, int16_t offest);
 Instruction* VMProgramMemory(VirtualMachine& vm);
@@ -62,6 +86,7 @@ void VMCheckStackOverflow(VirtualMachine& vm, int16_t offest);
 void VMGetNull(VirtualMachine& vm, int16_t offest);
 void VMGetFalse(VirtualMachine& vm, int16_t offest);
 void VMGetTrue(VirtualMachine& vm, int16_t offest);
+void VMLoadConstant(VirtualMachine& vm, int16_t offest, int32_t index);
 void VMCreateChar(VirtualMachine& vm, int16_t offest, wchar_t value);
 void VMCreateInt(VirtualMachine& vm, int16_t offest, int32_t value);
 void VMCreateFloat(VirtualMachine& vm, int16_t offest, float value);
@@ -71,6 +96,8 @@ void VMCreateObject(VirtualMachine& vm, int16_t offest);
 void VMCreateClosure(VirtualMachine& vm, int16_t offest, int16_t length);
 void VMCreateFunction(VirtualMachine& vm, int16_t offest, int32_t programPointer, int8_t parameterCount);
 void VMAddRecursiveFunctionItem(VirtualMachine& vm, int16_t offest, int16_t closureItemOffest);
+void VMLoadStaticFunction(VirtualMachine& vm, int16_t offest, int32_t index);
+void VMCompileFunction(VirtualMachine& vm, int16_t offest, int32_t function);
 void VMGetVariableByOffest(VirtualMachine& vm, int16_t offest, int16_t variableOffest);
 void VMSetVariableByOffest(VirtualMachine& vm, int16_t offest, int16_t variableOffest);
 void VMGetClosureItemByOffest(VirtualMachine& vm, int16_t offest, int16_t closureOffest);
@@ -80,6 +107,14 @@ void VMAccessField(VirtualMachine& vm, int16_t offest, int32_t index);
 void VMAssignmentArray(VirtualMachine& vm, int16_t offest);
 void VMAssignmentField(VirtualMachine& vm, int16_t offest, int32_t index);
 void VMFunctionCall(VirtualMachine& vm, int16_t offest, int16_t parameterCount);
+void VMTailCall(VirtualMachine& vm, int16_t offest, int16_t parameterCount);
+void VMCallNative(VirtualMachine& vm, int16_t offest, int8_t parameterCount, int32_t index);
+void VMCallSelf(VirtualMachine& vm, int16_t offest, int8_t parameterCount, int32_t programPosition);
+void VMArrayLength(VirtualMachine& vm, int16_t offest);
+void VMObjectFieldCount(VirtualMachine& vm, int16_t offest);
+void VMTypeOf(VirtualMachine& vm, int16_t offest);
+void VMCharToInt(VirtualMachine& vm, int16_t offest);
+void VMIntToChar(VirtualMachine& vm, int16_t offest);
 void VMJump(VirtualMachine& vm, int16_t offest, int32_t program);
 void VMConditionJump(VirtualMachine& vm, int16_t offest, int32_t program);
 void VMReturn(VirtualMachine& vm, int16_t offest);
@@ -89,6 +124,12 @@ void VMCompareOperation(VirtualMachine& vm, int16_t offest, InstructionEnum op);
 void VMNot(VirtualMachine& vm, int16_t offest);
 void VMEquals(VirtualMachine& vm, int16_t offest);
 void VMNotEquals(VirtualMachine& vm, int16_t offest);
+void VMBinaryOperationImmediate(VirtualMachine& vm, int16_t offest, InstructionEnum op, const Instruction& instruction);
+void VMCompareOperationImmediate(VirtualMachine& vm, int16_t offest, InstructionEnum op, const Instruction& instruction);
+void VMBinaryOperationInt(VirtualMachine& vm, int16_t offest, InstructionEnum op);
+void VMBinaryOperationFloat(VirtualMachine& vm, int16_t offest, InstructionEnum op);
+void VMCompareOperationInt(VirtualMachine& vm, int16_t offest, InstructionEnum op);
+void VMCompareOperationFloat(VirtualMachine& vm, int16_t offest, InstructionEnum op);
 
 struct OperationKey {
     inline OperationKey(InstructionEnum op, HeapEnum left, HeapEnum right) : op(op), left(left), right(right) {}
@@ -115,6 +156,44 @@ inline bool operator<(const EqualsKey& l, const EqualsKey& r) {
     return std::tie(l.left, l.right) < std::tie(r.left, r.right);
 }
 
+/*
+    ô ¼һεõ Function Լıհͺλ
+    function Ϊ -1 ʱΪ  ָ֮ ʱ
+*/
+struct VMCallCache {
+    int32_t function = -1;
+    int32_t closure = 0;
+    int32_t programPosition = 0;
+};
+
+/*
+    ״ ֶΰռ˳ ObjectFieldList  ֶε˳ͬĶͬһ״
+    slot Ϊֶ (StaticString еλ)  ObjectFieldList λõӳ transition Ϊֶ֮״
+    ״ ڶ ᱻ 0 Ϊûֶε״
+*/
+struct VMShape {
+    int16_t fieldCount = 0;
+    map<int32_t, int16_t> slot;
+    map<int32_t, int32_t> transition;
+};
+
+/*
+    ״еֶθﵽ VMObjectHashTableThreshold ֮ټµֶ Ϊʹ ObjectHashTable
+    ֮״Ϊ VMObjectHashTableShape ת״ ҲʹָĻ
+*/
+const int16_t VMObjectHashTableThreshold = 64;
+const int32_t VMObjectHashTableShape = -2;
+
+/*
+    AccessField AssignmentField Ļ ¼һζ״ֶελ
+    transition Ϊ -1 ʱΪ AssignmentField µֶ ֮״
+*/
+struct VMFieldCache {
+    int32_t shape = -1;
+    int16_t slot = 0;
+    int32_t transition = -1;
+};
+
 struct VirtualMachine {
     vector<Instruction> program;
     vector<StackType> stack;
@@ -124,8 +203,30 @@ struct VirtualMachine {
     int32_t stackOffest = 0;
     int32_t heapOffest = 0;
 
+    //С [smallIntegerMin , smallIntegerMax]  smallIntegerPointer ʼ ÿռ2
+    int32_t smallIntegerMin = 0;
+    int32_t smallIntegerMax = -1;
+    int32_t smallIntegerPointer = 0;
+    //ͳ ڶԱȻŻЧ
+    int64_t allocationCount = 0;
+    int64_t gcCount = 0;
+    //Ϊʱ¼ÿִָд
+    vector<int64_t> instructionCount;
+    //ָλô ֻ FunctionCall TailCall ʹ
+    vector<VMCallCache> callCache;
+    int64_t callCacheMiss = 0;
+    //ָλô ֻ AccessField AssignmentField ʹ
+    vector<VMFieldCache> fieldCache;
+    int64_t fieldCacheMiss = 0;
+    vector<VMShape> shapes;
+
     vector<function<int32_t(VirtualMachine* vm, int16_t parameterCount)>> localFunctionList;
     vector<wstring> StaticString;
+    vector<ConstantData> constantPool;
+    vector<int32_t> constantPoolPointer;
+    vector<StaticFunctionData> staticFunction;
+    vector<int32_t> staticFunctionPointer;
+    function<LazyCompileResult(int32_t, int32_t)> lazyCompile;
     vector<int> instructionLine;
     map<wstring, int32_t> stringMap;
     map<OperationKey, function<int32_t(VirtualMachine& vm, HeapType*, HeapType*)>> operationMap;
@@ -736,7 +736,8 @@ TEST(VirtualMachine, StackOverFlow) {
         L"reg2",
         L"reg3",
     };
-    wstring text = L"function fun(){ fun(); } fun();";
+    //fun(); β ʹջ ʹ÷βĵ
+    wstring text = L"function fun(){ return fun() + 1; } fun();";
     auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
     auto vm = builder.Build();
     VirtualMachineInit(vm);
@@ -1127,6 +1128,36 @@ TEST(VirtualMachine, GC2) {
     VirtualMachineStart(vm);
 }
 
+TEST(VirtualMachine, GCString) {
+    vector<wstring> regNames{
+        L"reg1",
+        L"reg2",
+    };
+    //ǰպ ʱַᱻƶ
+    wstring text = wstring() +
+        L"var a = array[8];\n"
+        L"a = null;\n"
+        L"var s = \"ab\" + 'c' + \"defg\";\n"
+        L"reg1();\n"
+        L"reg2(s);\n"
+        ;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        VirtualMachineGC(*vm);
+        return VMNullToHeapPointer();
+    });
+    builder.RegistLocalFunction(L"reg2", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        EXPECT_EQ(parameterCount, 1);
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetType(*vm, heapPointer), HeapEnum::String);
+        EXPECT_EQ(VMLocalFunctionGetStringData(*vm, heapPointer), L"abcdefg");
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
 TEST(VirtualMachine, Op1) {
     vector<wstring> regNames{
         L"reg1",
@@ -1183,4 +1214,1990 @@ TEST(VirtualMachine, Op2) {
     auto vm = builder.Build();
     VirtualMachineInit(vm);
     VirtualMachineStart(vm);
+}
+TEST(VirtualMachine, ConstantPool) {
+    vector<wstring> regNames{
+        L"reg1",
+        L"reg2",
+    };
+    wstring text = wstring() +
+        L"var i = 0;\n"
+        L"while(i < 3){\n"
+        L"    reg1(100, \"abc\");\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg2(100, \"abc\");\n"
+        ;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    HeapType* intPointer = nullptr;
+    HeapType* stringPointer = nullptr;
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        EXPECT_EQ(parameterCount, 2);
+        auto intHeapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        auto stringHeapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        if (intPointer == nullptr) {
+            intPointer = intHeapPointer;
+            stringPointer = stringHeapPointer;
+        }
+        EXPECT_EQ(intPointer, intHeapPointer);
+        EXPECT_EQ(stringPointer, stringHeapPointer);
+        VirtualMachineGC(*vm);
+        return VMNullToHeapPointer();
+    });
+    builder.RegistLocalFunction(L"reg2", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        EXPECT_EQ(parameterCount, 2);
+        auto intHeapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        auto stringHeapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(intPointer, intHeapPointer);
+        EXPECT_EQ(stringPointer, stringHeapPointer);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, intHeapPointer), 100);
+        EXPECT_EQ(VMLocalFunctionGetStringData(*vm, stringHeapPointer), L"abc");
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, SmallIntegerCache) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var i = 0;\n"
+        L"var s = 0;\n"
+        L"while(i < 3000){\n"
+        L"    s = s + i % 2;\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg1(s, i);\n"
+        ;
+    auto run = [&](int32_t min, int32_t max) {
+        auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+        builder.SetHeapMax(16384);
+        builder.SetSmallIntegerCache(min, max);
+        builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+            EXPECT_EQ(parameterCount, 2);
+            auto heapPointerS = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+            auto heapPointerI = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+            EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointerS), 1500);
+            EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointerI), 3000);
+            return VMNullToHeapPointer();
+        });
+        auto vm = builder.Build();
+        VirtualMachineInit(vm);
+        VirtualMachineStart(vm);
+        return pair(vm.allocationCount, vm.gcCount);
+    };
+    auto [allocationNoCache, gcNoCache] = run(0, -1);
+    auto [allocationDefault, gcDefault] = run(-128, 255);
+    auto [allocationCache, gcCache] = run(0, 4095);
+    EXPECT_GT(gcNoCache, 0);
+    EXPECT_LT(allocationDefault, allocationNoCache);
+    EXPECT_LT(allocationCache, allocationDefault);
+    EXPECT_EQ(allocationCache, 0);
+    EXPECT_EQ(gcCache, 0);
+    EXPECT_LE(gcDefault, gcNoCache);
+}
+
+TEST(VirtualMachine, SmallIntegerCacheHeapMax) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = L"var a = 60000; reg1(a + 5000);";
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 65000);
+        return VMNullToHeapPointer();
+    });
+    //õ˳޹  Build ʱĶѴС
+    builder.SetSmallIntegerCache(-1024, 65535);
+    EXPECT_THROW(builder.Build(), ConfigurationException);
+    builder.SetSmallIntegerCache(std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max());
+    builder.SetHeapMax(1 << 20);
+    EXPECT_THROW(builder.Build(), ConfigurationException);
+    builder.SetSmallIntegerCache(-1024, 65535);
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+    EXPECT_EQ(vm.allocationCount, 0);
+}
+
+TEST(VirtualMachine, Immediate) {
+    vector<wstring> regNames{
+        L"reg1",
+        L"reg2",
+        L"reg3",
+    };
+    wstring text = wstring() +
+        L"var a = 7;\n"
+        L"var b = 2.5;\n"
+        L"reg1(a + 1, a - 10, a * 3, a / 2, a % 4);\n"
+        L"reg2(a + 0.5, b * 2, b - 1, a % 2.5);\n"
+        L"reg3(a < 8, a <= 6, a > 6.5, b >= 2.5, a == 7, a != 7, a == 7.0, b == 2.5, \"7\" == 7);\n"
+        ;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        EXPECT_EQ(parameterCount, 5);
+        vector<int32_t> expect{ 8, -3, 21, 3, 3 };
+        for (int16_t i = 0; i < parameterCount; i++) {
+            auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, i);
+            EXPECT_EQ(VMLocalFunctionGetType(*vm, heapPointer), HeapEnum::Int);
+            EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), expect[i]);
+        }
+        return VMNullToHeapPointer();
+    });
+    builder.RegistLocalFunction(L"reg2", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        EXPECT_EQ(parameterCount, 4);
+        vector<float> expect{ 7.5f, 5.0f, 1.5f, 2.0f };
+        for (int16_t i = 0; i < parameterCount; i++) {
+            auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, i);
+            EXPECT_EQ(VMLocalFunctionGetType(*vm, heapPointer), HeapEnum::Float);
+            EXPECT_EQ(VMLocalFunctionGetFloat(*vm, heapPointer), expect[i]);
+        }
+        return VMNullToHeapPointer();
+    });
+    builder.RegistLocalFunction(L"reg3", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        EXPECT_EQ(parameterCount, 9);
+        vector<HeapEnum> expect{
+            HeapEnum::True, HeapEnum::False, HeapEnum::True, HeapEnum::True, HeapEnum::True,
+            HeapEnum::False, HeapEnum::False, HeapEnum::True, HeapEnum::False,
+        };
+        for (int16_t i = 0; i < parameterCount; i++) {
+            auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, i);
+            EXPECT_EQ(VMLocalFunctionGetType(*vm, heapPointer), expect[i]);
+        }
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, ImmediateTypeError) {
+    vector<wstring> regNames{};
+    wstring text = L"var a = \"abc\"; var b = a - 1;";
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    EXPECT_THROW(VirtualMachineStart(vm), RuntimeException);
+}
+
+TEST(VirtualMachine, TypeInference) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var i = 0;\n"
+        L"var s = 0;\n"
+        L"var f = 1.5;\n"
+        L"var x = 1;\n"
+        L"while(i < 10){\n"
+        L"    s = s + i;\n"
+        L"    f = f * f;\n"
+        L"    if(i > 5){\n"
+        L"        x = 1.5;\n"
+        L"    }\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg1(s, f < f, x + x);\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    auto count = [&](InstructionEnum type) {
+        return std::count_if(data.instruction.begin(), data.instruction.end(), [&](const Instruction& instruction) {
+            return instruction.type == type;
+        });
+    };
+    EXPECT_EQ(count(InstructionEnum::AddInt), 1);
+    EXPECT_EQ(count(InstructionEnum::MultiplyFloat), 1);
+    EXPECT_EQ(count(InstructionEnum::LessFloat), 1);
+    EXPECT_EQ(count(InstructionEnum::Add), 1);
+
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        EXPECT_EQ(parameterCount, 3);
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 45);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetType(*vm, heapPointer), HeapEnum::False);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 2);
+        EXPECT_EQ(VMLocalFunctionGetFloat(*vm, heapPointer), 3.0f);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, TypeInferenceLoop) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var a = 1;\n"
+        L"var b = 2;\n"
+        L"var k = 0;\n"
+        L"while(k < 3){\n"
+        L"    reg1(a + b);\n"
+        L"    var b = 0.5;\n"
+        L"    a = b;\n"
+        L"    k = k + 1;\n"
+        L"}\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::AddInt;
+    }), 0);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    vector<HeapEnum> types;
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        types.push_back(VMLocalFunctionGetType(*vm, heapPointer));
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+    EXPECT_EQ(types, (vector<HeapEnum>{ HeapEnum::Int, HeapEnum::Float, HeapEnum::Float }));
+}
+
+
+TEST(VirtualMachine, LoopInvariant) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var a = 1.5;\n"
+        L"var b = 2.0;\n"
+        L"var o = object;\n"
+        L"o.f = 3;\n"
+        L"var i = 0;\n"
+        L"var x = 0;\n"
+        L"var y = 0;\n"
+        L"while(i < 100){\n"
+        L"    x = a * b;\n"
+        L"    y = o.f;\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg1(x, y);\n"
+        ;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetFloat(*vm, heapPointer), 3.0f);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 3);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+    //a * b ֻѭǰһ
+    EXPECT_LT(vm.allocationCount, 10);
+}
+
+TEST(VirtualMachine, LoopInvariantNotHoisted) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var o = null;\n"
+        L"var i = 0;\n"
+        L"while(i < 0){\n"
+        L"    var x = o.f;\n"
+        L"}\n"
+        L"var p = object;\n"
+        L"p.f = 0;\n"
+        L"var s = 0;\n"
+        L"while(i < 3 || p.f < 0){\n"
+        L"    s = s + p.f;\n"
+        L"    p.f = p.f + 1;\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg1(s);\n"
+        ;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 3);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, TailCall) {
+    vector<wstring> regNames{
+        L"reg1",
+        L"reg2",
+    };
+    wstring text = wstring() +
+        L"function Sum(n, s){\n"
+        L"    if(n == 0){\n"
+        L"        return s;\n"
+        L"    }\n"
+        L"    return Sum(n - 1, s + n);\n"
+        L"}\n"
+        L"function Even(n, odd){\n"
+        L"    if(n == 0){\n"
+        L"        return true;\n"
+        L"    }\n"
+        L"    return odd(n - 1, Even);\n"
+        L"}\n"
+        L"function Odd(n, even){\n"
+        L"    if(n == 0){\n"
+        L"        return false;\n"
+        L"    }\n"
+        L"    return even(n - 1, Odd);\n"
+        L"}\n"
+        L"function Count(n){\n"
+        L"    if(n != 0){\n"
+        L"        reg2();\n"
+        L"        Count(n - 1);\n"
+        L"    }\n"
+        L"}\n"
+        L"function Native(){\n"
+        L"    return reg2();\n"
+        L"}\n"
+        L"reg1(Sum(20000, 0), Even(20001, Odd), Count(20000), Native());\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    //return reg2() ֱӵñغ ʹ CallNative
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::TailCall;
+    }), 4);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.SetStackMax(1024);
+    int32_t count = 0;
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        EXPECT_EQ(parameterCount, 4);
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 200010000);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetType(*vm, heapPointer), HeapEnum::False);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 2);
+        EXPECT_EQ(VMLocalFunctionGetType(*vm, heapPointer), HeapEnum::Null);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 3);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 20001);
+        return VMNullToHeapPointer();
+    });
+    builder.RegistLocalFunction(L"reg2", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        count += 1;
+        return VMIntToHeapPointer(*vm, count);
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, TailCallReturnValue) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"function Five(n){\n"
+        L"    if(n != 0){\n"
+        L"        return 5;\n"
+        L"    }\n"
+        L"}\n"
+        L"function Call(n){\n"
+        L"    if(n != 0){\n"
+        L"        Five(n);\n"
+        L"    }\n"
+        L"}\n"
+        L"function Self(n){\n"
+        L"    if(n != 0){\n"
+        L"        Self(n - 1);\n"
+        L"    }\n"
+        L"    return n;\n"
+        L"}\n"
+        L"reg1(Call(1), Self(3));\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::TailCall;
+    }), 0);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetType(*vm, heapPointer), HeapEnum::Null);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 3);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, Inline) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var k = 3;\n"
+        L"function Square(x){\n"
+        L"    var y = x * x;\n"
+        L"    return y;\n"
+        L"}\n"
+        L"function Scale(x){\n"
+        L"    return x * k;\n"
+        L"}\n"
+        L"var s = 0;\n"
+        L"var i = 0;\n"
+        L"while(i < 10){\n"
+        L"    s = s + Square(i) + Scale(i);\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg1(s);\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    //ȫ reg1 ʹ CallNative
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::FunctionCall;
+    }), 0);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 420);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, InlineNotApplied) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var k = 1;\n"
+        L"function Add(x){\n"
+        L"    return x + k;\n"
+        L"}\n"
+        L"k = 5;\n"
+        L"function Get(o){\n"
+        L"    return o.v;\n"
+        L"}\n"
+        L"function Set(o){\n"
+        L"    o.v = 5;\n"
+        L"    return 0;\n"
+        L"}\n"
+        L"var o = object;\n"
+        L"o.v = 1;\n"
+        L"reg1(Add(1), Set(o) + Get(o));\n"
+        ;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 2);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 5);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, InlineLine) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"function Field(o){\n"
+        L"    return o.v;\n"
+        L"}\n"
+        L"reg1(Field(1));\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    //ȫ reg1 ʹ CallNative
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::FunctionCall;
+    }), 0);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    try {
+        VirtualMachineStart(vm);
+        FAIL();
+    } catch (RuntimeException& e) {
+        EXPECT_NE(string(e.what()).find(MessageHead(2)), string::npos);
+    }
+}
+
+TEST(VirtualMachine, CommonSubexpression) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"function Create(){\n"
+        L"    var c = object;\n"
+        L"    c.x = 1;\n"
+        L"    c.y = 2;\n"
+        L"    var b = object;\n"
+        L"    b.c = c;\n"
+        L"    var a = object;\n"
+        L"    a.b = b;\n"
+        L"    return a;\n"
+        L"}\n"
+        L"var a = Create();\n"
+        L"a.b.c.x = a.b.c.x + a.b.c.y;\n"
+        L"reg1(a.b.c.x);\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    //a.b.c ֻһ (2 ) ֮ .x .y .x (3 ) ֶ x ĸֵӰ a.b.c
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::AccessField;
+    }), 5);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 3);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, CommonSubexpressionInvalidate) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"function Reset(x){\n"
+        L"    x.p = 5;\n"
+        L"    return 0;\n"
+        L"}\n"
+        L"var o = object;\n"
+        L"o.p = object;\n"
+        L"o.p.v = 1;\n"
+        L"var q = object;\n"
+        L"q.v = 10;\n"
+        L"var s = o.p.v;\n"
+        L"o.p = q;\n"
+        L"s = s + o.p.v;\n"
+        L"o.p.v = 20;\n"
+        L"s = s + o.p.v;\n"
+        L"var t = o.p.v + Reset(o) + o.p;\n"
+        L"var arr = array[2];\n"
+        L"arr[0] = q;\n"
+        L"var u = arr[0].v;\n"
+        L"arr[0] = o;\n"
+        L"u = u + arr[0].p;\n"
+        L"reg1(s, t, u);\n"
+        ;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 31);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 25);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 2);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 25);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, ScalarReplacement) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"function Length(x, y){\n"
+        L"    var p = object;\n"
+        L"    p.x = x;\n"
+        L"    p.y = y;\n"
+        L"    if(x > y){\n"
+        L"        p.x = y;\n"
+        L"    }\n"
+        L"    return p.x * p.x + p.y * p.y;\n"
+        L"}\n"
+        L"var sum = array[3];\n"
+        L"sum[0] = 0;\n"
+        L"sum[1] = 1;\n"
+        L"var i = 0;\n"
+        L"while(i < 3){\n"
+        L"    sum[0] = sum[0] + i;\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg1(Length(3, 4), sum[0] + sum[1]);\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    //p sum û Ҫ 
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::CreateObject || instruction.type == InstructionEnum::CreateArray;
+    }), 0);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 25);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 4);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, ScalarReplacementEscape) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var p = object;\n"
+        L"p.x = 1;\n"
+        L"var q = array[2];\n"
+        L"q[0] = 2;\n"
+        L"var r = object;\n"
+        L"if(p.x == 1){\n"
+        L"    r.x = 3;\n"
+        L"}\n"
+        L"reg1(p, q[0]);\n"
+        L"var s = r.x;\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    //p Ϊ q ֻͨ± r.x һѾֵ
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::CreateObject || instruction.type == InstructionEnum::CreateArray;
+    }), 2);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 2);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, ClosureCapture) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var k = 10;\n"
+        L"var step = 2;\n"
+        L"step = 3;\n"
+        L"function Sum(n){\n"
+        L"    var s = 0;\n"
+        L"    var i = 0;\n"
+        L"    while(i < n){\n"
+        L"        s = s + k + step;\n"
+        L"        i = i + 1;\n"
+        L"    }\n"
+        L"    return s;\n"
+        L"}\n"
+        L"var g = function(a){\n"
+        L"    return a * k;\n"
+        L"};\n"
+        L"reg1(Sum(4), g(2));\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    //k ٷհ g Ҫհ Sum ֻڿʼʱȡһ step (reg1 ʹ CallNative ȡհ)
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::CreateClosure;
+    }), 1);
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::GetClosureItemByOffest;
+    }), 1);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 52);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 20);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, ClosureCaptureMutated) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var k = 1;\n"
+        L"function Counter(){\n"
+        L"    var c = 0;\n"
+        L"    return function(){\n"
+        L"        c = c + k;\n"
+        L"        return c;\n"
+        L"    };\n"
+        L"}\n"
+        L"var counter = Counter();\n"
+        L"counter();\n"
+        L"var n = 5;\n"
+        L"var f = function(){ return n; };\n"
+        L"n = 6;\n"
+        L"reg1(counter(), f());\n"
+        ;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 2);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 5);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, StaticFunction) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"function Fib(n){\n"
+        L"    if(n < 2){\n"
+        L"        return n;\n"
+        L"    }\n"
+        L"    return Fib(n - 1) + Fib(n - 2);\n"
+        L"}\n"
+        L"function Show(a, b){\n"
+        L"    reg1(a, b);\n"
+        L"}\n"
+        L"var s = 0;\n"
+        L"var i = 0;\n"
+        L"while(i < 3){\n"
+        L"    var g = function(x){\n"
+        L"        return x * 2;\n"
+        L"    };\n"
+        L"    s = s + g(i);\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"Show(Fib(10), s);\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    //հֻ ע Ϊ ʼʱ
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::CreateFunction || instruction.type == InstructionEnum::CreateClosure;
+    }), 0);
+    EXPECT_EQ(data.staticFunction.size(), 3);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 55);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 6);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, StaticFunctionNotApplied) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"function Get(){\n"
+        L"    return 1;\n"
+        L"}\n"
+        L"var f = function(){\n"
+        L"    return Get();\n"
+        L"};\n"
+        L"Get = function(){\n"
+        L"    return 2;\n"
+        L"};\n"
+        L"reg1(f(), Get());\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    //f  Get ¸ֵ Ҫʱհ
+    EXPECT_EQ(std::count_if(data.instruction.begin(), data.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::CreateClosure;
+    }), 1);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 1);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 2);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, IntermediateRepresentation) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var s = 0;\n"
+        L"var i = 0;\n"
+        L"var add = function(a, b){\n"
+        L"    return a + b;\n"
+        L"};\n"
+        L"while(i < 10){\n"
+        L"    i = i + 1;\n"
+        L"    if(i == 3){\n"
+        L"        continue;\n"
+        L"    }\n"
+        L"    if(i > 7){\n"
+        L"        break;\n"
+        L"    } else {\n"
+        L"        s = add(s, i);\n"
+        L"    }\n"
+        L"}\n"
+        L"reg1(s);\n"
+        ;
+    auto module = GenerateIntermediateRepresentation(text, compileData, regNames);
+    EXPECT_NO_THROW(IRVerify(module));
+    EXPECT_EQ(module.functions.size(), 2);
+    //ֵֻڶĻʹ ֲͨ
+    for (auto& function : module.functions) {
+        for (auto& block : function.blocks) {
+            EXPECT_TRUE(IRIsTerminator(block.instructions.back().operation));
+        }
+    }
+    auto builder = VirtualMachineBuilder(IREmit(module));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 1 + 2 + 4 + 5 + 6 + 7);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, IntermediateRepresentationVerify) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"var i = 0;\n"
+        L"while(i < 3){\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg1(i);\n"
+        ;
+    auto module = GenerateIntermediateRepresentation(text, compileData, regNames);
+    EXPECT_NO_THROW(IRVerify(module));
+
+    //ȱٽβ
+    auto missingTerminator = module;
+    auto& layout = missingTerminator.functions[0].layout;
+    missingTerminator.functions[0].blocks[layout.front()].instructions.pop_back();
+    EXPECT_THROW(IRVerify(missingTerminator), CompilerError);
+
+    //ֵ
+    auto redefined = module;
+    for (auto& block : redefined.functions[0].blocks) {
+        for (auto& instruction : block.instructions) {
+            if (instruction.result > 0) {
+                instruction.result = 0;
+            }
+        }
+    }
+    EXPECT_THROW(IRVerify(redefined), CompilerError);
+
+    //Fallthrough һ
+    auto reordered = module;
+    std::reverse(reordered.functions[0].layout.begin(), reordered.functions[0].layout.end());
+    EXPECT_THROW(IRVerify(reordered), CompilerError);
+}
+
+//ѱغĲתɿɱȽϵı ֻ¼
+static wstring RecordValue(VirtualMachine& vm, HeapType* heapPointer) {
+    switch (VMLocalFunctionGetType(vm, heapPointer)) {
+        case HeapEnum::Int:
+            return std::to_wstring(VMLocalFunctionGetInt(vm, heapPointer));
+        case HeapEnum::Float:
+            return std::to_wstring(VMLocalFunctionGetFloat(vm, heapPointer));
+        case HeapEnum::String:
+            return wstring(VMLocalFunctionGetStringData(vm, heapPointer));
+        default:
+            return std::to_wstring(static_cast<int>(VMLocalFunctionGetType(vm, heapPointer)));
+    }
+}
+
+//г ˳¼ÿε reg1 Ĳ
+static vector<wstring> RunRecord(const wstring& text, const CompileData& data) {
+    vector<wstring> record;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, data, { L"reg1" }));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        for (int16_t i = 0; i < parameterCount; i++) {
+            record.push_back(RecordValue(*vm, VMLocalFunctionGetParameter(*vm, parameterCount, i)));
+        }
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+    return record;
+}
+
+//г ˳¼ÿε reg1  reg7 ĺͲ Լʱ쳣
+//ÿεö true ʹ if(reg1()) 
+static vector<wstring> RunProgramRecord(const wstring& text, const CompileData& data) {
+    vector<wstring> regNames{ L"reg1", L"reg2", L"reg3", L"reg4", L"reg5", L"reg6", L"reg7" };
+    vector<wstring> record;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, data, regNames));
+    for (auto& name : regNames) {
+        builder.RegistLocalFunction(name, [&record, name](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+            record.push_back(name);
+            for (int16_t i = 0; i < parameterCount; i++) {
+                record.push_back(RecordValue(*vm, VMLocalFunctionGetParameter(*vm, parameterCount, i)));
+            }
+            return VMBoolToHeapPointer(true);
+        });
+    }
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    try {
+        VirtualMachineStart(vm);
+    }
+    catch (const RuntimeException&) {
+        record.push_back(L"RuntimeException");
+    }
+    return record;
+}
+
+TEST(VirtualMachine, OptimizeLevelVerify) {
+    vector<wstring> texts{
+        L"var a = 1; var b = 2; var k = 0;\n"
+        L"while(k < 3){ reg1(a + b); var b = 0.5; a = b; k = k + 1; }\n",
+
+        L"var a = 1.5; var b = 2.0; var o = object; o.f = 3; var i = 0; var x = 0; var y = 0;\n"
+        L"while(i < 100){ x = a * b; y = o.f; i = i + 1; }\n"
+        L"reg1(x, y);\n",
+
+        L"function Sum(n, s){ if(n == 0){ return s; } return Sum(n - 1, s + n); }\n"
+        L"reg1(Sum(50, 0));\n",
+
+        L"var k = 3;\n"
+        L"function Square(x){ var y = x * x; return y; }\n"
+        L"function Scale(x){ return x * k; }\n"
+        L"var s = 0; var i = 0;\n"
+        L"while(i < 10){ s = s + Square(i) + Scale(i); i = i + 1; }\n"
+        L"reg1(s);\n",
+
+        L"function Create(){ var c = object; c.x = 1; c.y = 2; var b = object; b.c = c; var a = object; a.b = b; return a; }\n"
+        L"var a = Create();\n"
+        L"a.b.c.x = a.b.c.x + a.b.c.y;\n"
+        L"reg1(a.b.c.x);\n",
+
+        L"function Length(x, y){ var p = object; p.x = x; p.y = y; if(x > y){ p.x = y; } return p.x * p.x + p.y * p.y; }\n"
+        L"var sum = array[3]; sum[0] = 0; sum[1] = 1; var i = 0;\n"
+        L"while(i < 3){ sum[0] = sum[0] + i; i = i + 1; }\n"
+        L"reg1(Length(3, 4), sum[0] + sum[1]);\n",
+
+        L"var k = 10; var step = 2; step = 3;\n"
+        L"function Sum(n){ var s = 0; var i = 0; while(i < n){ s = s + k + step; i = i + 1; } return s; }\n"
+        L"var g = function(a){ return a * k; };\n"
+        L"reg1(Sum(4), g(2));\n",
+
+        L"function Fib(n){ if(n < 2){ return n; } return Fib(n - 1) + Fib(n - 2); }\n"
+        L"var s = 0; var i = 0;\n"
+        L"while(i < 3){ var g = function(x){ return x * 2; }; s = s + g(i); i = i + 1; }\n"
+        L"reg1(Fib(10), s, \"s\" + 'c', 7 / 2.0);\n",
+    };
+    //ÿĽ O0 ͬ вȽͬһʽֵĽ ( StaticFunctionIdentity)
+    auto data = compileData;
+    data.options.verify = true;
+    for (auto& text : texts) {
+        data.options.level = OptimizeLevel::O0;
+        auto expect = RunRecord(text, data);
+        EXPECT_FALSE(expect.empty());
+        for (auto level : { OptimizeLevel::O1, OptimizeLevel::O2 }) {
+            data.options.level = level;
+            EXPECT_EQ(RunRecord(text, data), expect);
+        }
+    }
+    //ʱͬĳ ¼бغĵúʱ쳣
+    vector<wstring> programs{
+        L"reg1();",
+        L"reg1(false);",
+        L"reg1(true);",
+        L"reg1('C');",
+        L"reg1(12345);",
+        L"reg1(1.5);",
+        L"reg1(\"asd\");",
+        L"reg1(\"asd\" + 'f' + 'g');",
+        L"var arr = array[3]; arr[0] = 1; arr[1] = false; reg1(arr[0],arr[1],arr[2]);",
+        L"var o = object; o.a = true; o.b = false; reg1(o.a,o.b,o);",
+        L"var a = true; reg1(a); var b = false; reg2(b); reg3(false);",
+        L"var fun1 = function(){ return null; }; reg1(fun1());",
+        L"function fun1(){ return null; } reg1(fun1());",
+        L"function fun1(){ return false; } reg1(fun1());",
+        L"var fun1 = function(){ return false; }; reg1(fun1());",
+        L"reg3(reg2(reg1(1)));",
+        L"var i = 1; function fun(){ reg1(i); i = false; reg2(i); return null;} fun(); reg1(i); ",
+        L"var i = 1; function fun1(){ function fun2(){ reg1(i); i = false; reg2(i); } fun2(); reg1(i); } fun1(); ",
+        L"var b = null; if(true){ b = reg1(); } else{ b = reg2(); } reg3(b);",
+        L"var b = null; if(false){ b = reg1(); } else{ b = reg2(); } reg3(b);",
+        L"var t = true; var f = false; if(reg1()){ if(reg2()){ reg3(f); } else { reg3(t); } } else { reg3(f); } ",
+        L"var fun = null; if(reg1()){ fun = function(){ return 1;};  } reg2(fun()); ",
+        L"var i = 0; while( i < 10 ){ reg1(i); i = i + 1; } reg2(i);",
+        L"reg1(1 + 1, 1 + 1.5, 1.5 + 1, 1.5 + 1.5); reg2('a' + 'b', 'a' + \"bc\", \"ab\" + 'c', \"ab\" + \"cd\");",
+        L"reg1(1 == 1,1 != 2, null == null, function(){} != function(){}, 1 != null, 1 != 1.0);",
+        L"var fun = function(){ return -1; }; var a = 1; reg1(1 < 2, 2 <= 2, 2 > 1, 3 >= 3, fun() == -1);",
+        L"var i = 5; function fun(i){ if(i > 0){ fun(i - 1); } else { reg1(i); } return i; } fun(i);",
+        L"function fun(){ return fun() + 1; } fun();",
+        L"while (true) { break; }",
+        L" var i = 2;  while (true) {if (i > 0) { i = i - 1; } else { reg1(i); break; } }",
+        L" var i = 0;  while (true) { if (true) { i = i + 1; if (true) { i = i + 1; break; } } } reg1(i);",
+        L"var a = 2; while(true){ if (a > 0){ a = a - 1; continue; } break; } reg1(a);",
+        L"var i = 0; while(true){ if(true){ if(true) { i = i + 1; if (i == 2) { break; } else { continue; } } } break; } reg1(i);",
+        L"var o = object; o.p1 = 1; o.p2 = 2; o.p3 = 3; o.p4 = 4; o.p5 = 5; o.p6 = 6; o.p7 = 7; o.p8 = 8;\n"
+        L"o.p9 = 9; o.p10 = 0; o.p11 = 1; o.p12 = 2; o.p13 = 3; o.p14 = 4; o.p15 = 5; o.p16 = 6;\n"
+        L"reg1(o.p6); reg2(o.p5); reg3(o.p16); o.p17 = 7; reg1(o.p17, o.p16);\n",
+        L"var arr = array[4096];",
+        L"var a = array[5];\n"
+        L"reg2(a);\n"
+        L"var fun = function(){\n "
+        L"    var a = array[5];\n"
+        L"    var b = object;\n"
+        L"    b.o = 1; \n"
+        L"};\n"
+        L"var b = object;\n"
+        L"fun();\n"
+        L"reg1();\n"
+        L"reg2(a);\n"
+        L"reg3(b);\n",
+        L"var a = array[1];\n"
+        L"var fun = function(){\n"
+        L"    var b = array[3];\n"
+        L"    var c = array[2];\n"
+        L"    b[0] = false;\n"
+        L"    b[1] = c;\n"
+        L"    b[2] = 100;\n"
+        L"    c[0] = 1;\n"
+        L"    c[1] = b;\n"
+        L"    return b;\n"
+        L"};\n"
+        L"a = fun();\n"
+        L"reg1();\n"
+        L"reg2(a);\n"
+        L"reg3(a[0]);\n"
+        L"reg4(a[1]);\n"
+        L"reg5(a[2]);\n"
+        L"reg6(a[1][0]);\n"
+        L"reg7(a[1][1]);\n",
+        L"reg1(1 + 2 * 3 + 4); reg2((1+2) * (3 + 4)); reg3( 1 + 2 * 3 + 4 <= (1+2) * (3 + 4) || false);",
+        L"var a = array[2]; a[0] = 5; var b = array[2]; b[0] = 5; reg1(a == b);",
+        L"var i = 0;\n"
+        L"while(i < 3){\n"
+        L"    reg1(100, \"abc\");\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg2(100, \"abc\");\n",
+        L"var i = 0;\n"
+        L"var s = 0;\n"
+        L"while(i < 3000){\n"
+        L"    s = s + i % 2;\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg1(s, i);\n",
+    };
+    for (auto& text : programs) {
+        SCOPED_TRACE(text);
+        data.options.level = OptimizeLevel::O0;
+        auto expect = RunProgramRecord(text, data);
+        for (auto level : { OptimizeLevel::O1, OptimizeLevel::O2 }) {
+            data.options.level = level;
+            EXPECT_EQ(RunProgramRecord(text, data), expect);
+        }
+    }
+}
+
+TEST(VirtualMachine, StaticFunctionIdentity) {
+    wstring text = wstring() +
+        L"var a = array[2];\n"
+        L"var i = 0;\n"
+        L"while(i < 2){\n"
+        L"    a[i] = function(){\n"
+        L"        return 1;\n"
+        L"    };\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"function Create(){\n"
+        L"    return function(){\n"
+        L"        return 1;\n"
+        L"    };\n"
+        L"}\n"
+        L"reg1(a[0] == a[1], Create() == Create(), a[0] == Create());\n"
+        ;
+    //ͬһʽֵ ֻ static-function ʱͬ Ǹ֮ΨһĲ
+    auto falseValue = std::to_wstring(static_cast<int>(HeapEnum::False));
+    auto trueValue = std::to_wstring(static_cast<int>(HeapEnum::True));
+    auto data = compileData;
+    data.options.level = OptimizeLevel::O0;
+    EXPECT_EQ(RunRecord(text, data), vector<wstring>({ falseValue, falseValue, falseValue }));
+    data.options.level = OptimizeLevel::O1;
+    EXPECT_EQ(RunRecord(text, data), vector<wstring>({ trueValue, trueValue, falseValue }));
+    data.options.level = OptimizeLevel::O2;
+    EXPECT_EQ(RunRecord(text, data), vector<wstring>({ trueValue, trueValue, falseValue }));
+    data.options.disablePasses = { "static-function" };
+    EXPECT_EQ(RunRecord(text, data), vector<wstring>({ falseValue, falseValue, falseValue }));
+    data.options.disablePasses.clear();
+    data.options.lazy = true;
+    EXPECT_EQ(RunRecord(text, data), vector<wstring>({ trueValue, trueValue, falseValue }));
+    data.options.preParse = true;
+    EXPECT_EQ(RunRecord(text, data), vector<wstring>({ falseValue, falseValue, falseValue }));
+}
+
+TEST(VirtualMachine, PassOptions) {
+    auto data = compileData;
+    data.options = ParseCompileOptions({ "-O1", "-enable=licm", "-disable=immediate" }, data.passes);
+    EXPECT_EQ(data.options.level, OptimizeLevel::O1);
+    EXPECT_THROW(ParseCompileOptions({ "-O3" }, data.passes), ConfigurationException);
+    EXPECT_THROW(ParseCompileOptions({ "-enable=unknown" }, data.passes), ConfigurationException);
+
+    wstring text = wstring() +
+        L"var i = 0;\n"
+        L"while(i < 10){\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg1(i);\n"
+        ;
+    vector<PassTime> passTime;
+    auto runtimeData = GenerateVMRuntimeData(text, data, { L"reg1" }, &passTime);
+    vector<string> names;
+    for (auto& item : passTime) {
+        names.push_back(item.name);
+        EXPECT_GE(item.milliseconds, 0.0);
+    }
+    vector<string> expectNames{
+        "lexical-analysis", "parse", "semantic-analysis",
+        "closure-capture", "licm", "type-inference", "tail-call", "self-call", "static-function", "native-call", "intrinsic",
+        "lower", "emit",
+    };
+    EXPECT_EQ(names, expectNames);
+    //ر֮ i + 1 ʹƵõרָ
+    EXPECT_EQ(std::count_if(runtimeData.instruction.begin(), runtimeData.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::AddImmediate;
+    }), 0);
+    EXPECT_EQ(std::count_if(runtimeData.instruction.begin(), runtimeData.instruction.end(), [](const Instruction& instruction) {
+        return instruction.type == InstructionEnum::AddInt;
+    }), 1);
+}
+
+TEST(VirtualMachine, StackSlotReuse) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"function F(c){\n"
+        L"    var s = 0;\n"
+        L"    if(c){\n"
+        L"        var a = 1;\n"
+        L"        var b = 2;\n"
+        L"        s = a + b;\n"
+        L"    } else {\n"
+        L"        var x = 3;\n"
+        L"        var y = 4;\n"
+        L"        s = x * y;\n"
+        L"    }\n"
+        L"    if(c){\n"
+        L"        var d = 5;\n"
+        L"        var e = 6;\n"
+        L"        s = s + d + e;\n"
+        L"    }\n"
+        L"    return s;\n"
+        L"}\n"
+        L"reg1(F(true), F(false));\n"
+        ;
+    auto data = GenerateVMRuntimeData(text, compileData, regNames);
+    // s ֻ֮Ҫλ ֵܿеıͬλ
+    int16_t maxOffest = 0;
+    for (auto& instruction : data.instruction) {
+        if (instruction.type == InstructionEnum::SetVariableByOffest || instruction.type == InstructionEnum::GetVariableByOffest) {
+            maxOffest = std::max(maxOffest, instruction.value.offestOrLength);
+        }
+    }
+    EXPECT_LE(maxOffest, 6);
+    auto builder = VirtualMachineBuilder(std::move(data));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 14);
+        heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 1);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 12);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, StackSlotDeadCleared) {
+    vector<wstring> regNames{
+        L"reg1",
+        L"reg2",
+    };
+    wstring text = wstring() +
+        L"var big = array[1000];\n"
+        L"big[0] = 1;\n"
+        L"var n = big[0];\n"
+        L"var i = 0;\n"
+        L"while(i < 2){\n"
+        L"    reg1();\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg2(n);\n"
+        ;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    //big ֮ʹ λ n i ֮µλڻβΪ null ղٱ
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        VirtualMachineGC(*vm);
+        EXPECT_LT(vm->heapOffest, 1000);
+        return VMNullToHeapPointer();
+    });
+    builder.RegistLocalFunction(L"reg2", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        EXPECT_EQ(VMLocalFunctionGetInt(*vm, heapPointer), 1);
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+}
+
+TEST(VirtualMachine, LazyCompile) {
+    vector<wstring> texts{
+        L"function Fib(n){ if(n < 2){ return n; } return Fib(n - 1) + Fib(n - 2); }\n"
+        L"reg1(Fib(10), Fib(12));\n",
+
+        L"var k = 3;\n"
+        L"function Outer(x){ var y = x + k; var inner = function(z){ return z * y + 1.5; }; return inner(2) + inner(3); }\n"
+        L"var i = 0; var s = 0;\n"
+        L"while(i < 3){ s = s + Outer(i); i = i + 1; }\n"
+        L"reg1(s);\n",
+
+        L"function Counter(){ var c = object; c.n = 0; c.Inc = function(){ c.n = c.n + 1; return c.n; }; return c; }\n"
+        L"var a = Counter(); a.Inc(); a.Inc();\n"
+        L"var b = Counter(); b.Inc();\n"
+        L"reg1(a.n, b.n, \"lazy\" + 'x', a.Inc());\n",
+
+        L"function Even(n){ if(n == 0){ return true; } return Even(n - 2); }\n"
+        L"function Unused(x){ var s = \"never\"; return s + x; }\n"
+        L"var f = function(n){ return Even(n); };\n"
+        L"reg1(Even(10), f(8));\n",
+    };
+    //ӳɵĽֱͬ
+    auto data = compileData;
+    for (auto level : { OptimizeLevel::O0, OptimizeLevel::O2 }) {
+        data.options.level = level;
+        for (auto& text : texts) {
+            data.options.lazy = false;
+            auto expect = RunRecord(text, data);
+            EXPECT_FALSE(expect.empty());
+            data.options.lazy = true;
+            EXPECT_EQ(RunRecord(text, data), expect);
+        }
+    }
+}
+
+TEST(VirtualMachine, LazyCompileUnused) {
+    vector<wstring> regNames{
+        L"reg1",
+    };
+    wstring text = wstring() +
+        L"function Used(x){ if(x > 10){ return x; } return Used(x + 10); }\n"
+        L"function Unused(x){\n"
+        L"    var a = x * 2; var b = a * 3; var c = b * 4;\n"
+        L"    while(a < c){ a = a + b; }\n"
+        L"    return function(y){ return y + a + b + c; };\n"
+        L"}\n"
+        L"reg1(Used(1));\n"
+        L"reg1(Used(2));\n"
+        ;
+    auto data = compileData;
+    auto eager = GenerateVMRuntimeData(text, data, regNames);
+    data.options = ParseCompileOptions({ "-lazy" }, data.passes);
+    auto lazy = GenerateVMRuntimeData(text, data, regNames);
+    EXPECT_LT(lazy.instruction.size(), eager.instruction.size());
+    size_t compileCount = 0;
+    for (auto& instruction : lazy.instruction) {
+        if (instruction.type == InstructionEnum::CompileFunction) {
+            compileCount += 1;
+        }
+    }
+    EXPECT_EQ(compileCount, 2);
+
+    vector<int32_t> result;
+    auto builder = VirtualMachineBuilder(std::move(lazy));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, 0);
+        result.push_back(VMLocalFunctionGetInt(*vm, heapPointer));
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    size_t initialSize = vm.program.size();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+    EXPECT_EQ(result, vector<int32_t>({ 11, 12 }));
+    //ֻ Used ĺ ڶεò
+    size_t remain = 0;
+    for (auto& instruction : vm.program) {
+        if (instruction.type == InstructionEnum::CompileFunction) {
+            remain += 1;
+        }
+    }
+    EXPECT_EQ(remain, 1);
+    EXPECT_GT(vm.program.size(), initialSize);
+    EXPECT_LT(vm.program.size(), eager.instruction.size());
+}
+
+TEST(VirtualMachine, PreParse) {
+    vector<wstring> texts{
+        L"var k = 3; var x = 100;\n"
+        L"function Outer(a){ var x = a + k; var inner = function(z){ var k = z * x; return k + 1.5; }; return inner(2) + inner(3); }\n"
+        L"reg1(Outer(1), Outer(2), x);\n",
+
+        L"var n = 7;\n"
+        L"function Make(){ var o = object; o.n = n * 2; o.k = 'c'; o.s = \"pre\" + \"parse\"; return o; }\n"
+        L"var o = Make();\n"
+        L"reg1(o.n, o.s + o.k);\n",
+
+        L"function Fib(n){ if(n < 2){ return n; } return Fib(n - 1) + Fib(n - 2); }\n"
+        L"function Loop(n, s){ if(n == 0){ return s; } return Loop(n - 1, s + n); }\n"
+        L"reg1(Fib(12), Loop(1000, 0));\n",
+    };
+    //ԤĽֱͬ
+    auto data = compileData;
+    for (auto& text : texts) {
+        data.options = CompileOptions();
+        auto expect = RunRecord(text, data);
+        EXPECT_FALSE(expect.empty());
+        data.options = ParseCompileOptions({ "-preparse" }, data.passes);
+        EXPECT_EQ(RunRecord(text, data), expect);
+    }
+}
+
+TEST(VirtualMachine, PreParseDeferredError) {
+    wstring text = wstring() +
+        L"function Broken(){ return missing + 1; }\n"
+        L"function Fine(){ return 1; }\n"
+        L"reg1(Fine());\n"
+        ;
+    auto data = compileData;
+    EXPECT_THROW(GenerateVMRuntimeData(text, data, { L"reg1" }), CompileException);
+    //еĴڵʱŻᷢ
+    data.options = ParseCompileOptions({ "-preparse" }, data.passes);
+    EXPECT_EQ(RunRecord(text, data), vector<wstring>({ L"1" }));
+    EXPECT_THROW(RunRecord(text + L"Broken();\n", data), CompileException);
+    //ŲƥԤʱ
+    EXPECT_THROW(GenerateVMRuntimeData(L"function F(){ if(true){ return 1; }\n", data, { L"reg1" }), ParseException);
+}
+
+TEST(VirtualMachine, LayoutStaticCallGraph) {
+    wstring text = wstring() +
+        L"function Cold(a, b, c){ if(a > 0){ return Cold(a - 1, b, c); } return b + c; }\n"
+        L"function Helper(a){ if(a > 0){ return Helper(a - 1); } return a; }\n"
+        L"function Hot(a, b){ if(a > 0){ return Hot(a - 1, b + 1); } return b; }\n"
+        L"var f = Cold;\n"
+        L"var i = 0;\n"
+        L"var s = Helper(3);\n"
+        L"while(i < 10){ s = s + Hot(i, 1); i = i + 1; }\n"
+        L"reg1(s);\n"
+        ;
+    auto data = compileData;
+    auto module = GenerateIntermediateRepresentation(text, data, { L"reg1" });
+    EXPECT_NO_THROW(IRVerify(module));
+    //֮ѭеõ Hot һε Helper ûֱӵõ Cold
+    auto& order = module.functionOrder;
+    ASSERT_EQ(order.size(), 4);
+    EXPECT_EQ(order[0], 0);
+    EXPECT_EQ(module.functions[order[1]].parameterCount, 2);
+    EXPECT_EQ(module.functions[order[2]].parameterCount, 1);
+    EXPECT_EQ(module.functions[order[3]].parameterCount, 3);
+    auto expect = RunRecord(text, data);
+    data.options = ParseCompileOptions({ "-disable=layout" }, data.passes);
+    EXPECT_TRUE(GenerateIntermediateRepresentation(text, data, { L"reg1" }).functionOrder.empty());
+    EXPECT_EQ(RunRecord(text, data), expect);
+    EXPECT_EQ(expect, vector<wstring>({ L"55" }));
+}
+
+TEST(VirtualMachine, LayoutProfile) {
+    wstring text = wstring() +
+        L"function Step(x, n){\n"
+        L"    if(n == 0){ return x; }\n"
+        L"    if(x < 0){\n"
+        L"        var a = x * 2; var b = a - 1;\n"
+        L"        reg1(a, b);\n"
+        L"        return 0;\n"
+        L"    }\n"
+        L"    return Step(x + 2, n - 1);\n"
+        L"}\n"
+        L"reg1(Step(1, 50));\n"
+        L"reg1(Step(3, 20));\n"
+        ;
+    auto data = compileData;
+    auto module = GenerateIntermediateRepresentation(text, data, { L"reg1" });
+    vector<vector<int32_t>> blockPosition;
+    auto builder = VirtualMachineBuilder(IREmit(module, &blockPosition));
+    builder.RegistLocalFunction(L"reg1", [](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        return VMNullToHeapPointer();
+    });
+    builder.SetProfile(true);
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+    auto profile = std::make_shared<IRProfile>(IRCreateProfile(module, blockPosition, vm.instructionCount));
+    EXPECT_EQ(profile->blockCount[0][module.functions[0].layout[0]], 1);
+
+    //ûִйĻ (x < 0 ķ֧) ƶĩβ
+    data.options.profile = profile;
+    auto layouted = GenerateIntermediateRepresentation(text, data, { L"reg1" });
+    EXPECT_NO_THROW(IRVerify(layouted));
+    bool moved = false;
+    for (size_t function = 0; function < layouted.functions.size(); function++) {
+        auto& blockCount = profile->blockCount[function];
+        bool seenCold = false;
+        for (auto block : layouted.functions[function].layout) {
+            if (static_cast<size_t>(block) >= blockCount.size() || blockCount[block] == -1) {
+                continue;
+            }
+            if (blockCount[block] == 0) {
+                seenCold = true;
+            } else {
+                EXPECT_FALSE(seenCold);
+            }
+        }
+        moved = moved || layouted.functions[function].layout != module.functions[function].layout;
+    }
+    EXPECT_TRUE(moved);
+    EXPECT_EQ(RunRecord(text, data), vector<wstring>({ L"101", L"43" }));
+    EXPECT_EQ(RunRecord(text + L"reg1(Step(-1, 3));\n", data), vector<wstring>({ L"101", L"43", L"-2", L"-3", L"0" }));
+}
+
+static size_t CountInstruction(const VMRuntimeData& data, InstructionEnum type) {
+    return std::count_if(data.instruction.begin(), data.instruction.end(), [type](const Instruction& instruction) {
+        return instruction.type == type;
+    });
+}
+
+TEST(VirtualMachine, NativeCall) {
+    wstring text = wstring() +
+        L"function Report(a, b){\n"
+        L"    reg1(a, b);\n"
+        L"    return reg1();\n"
+        L"}\n"
+        L"var i = 0;\n"
+        L"while(i < 3){ Report(i, i * 2); i = i + 1; }\n"
+        L"reg1(\"end\", 1.5, reg1());\n"
+        ;
+    auto data = compileData;
+    auto runtimeData = GenerateVMRuntimeData(text, data, { L"reg1" });
+    //reg1 հ FunctionCall
+    EXPECT_EQ(CountInstruction(runtimeData, InstructionEnum::CallNative), 4);
+    EXPECT_EQ(CountInstruction(runtimeData, InstructionEnum::GetClosureItemByOffest), 0);
+    auto expect = vector<wstring>({ L"0", L"0", L"1", L"2", L"2", L"4", L"end", std::to_wstring(1.5f), L"1" });
+    EXPECT_EQ(RunRecord(text, data), expect);
+    data.options = ParseCompileOptions({ "-disable=native-call" }, data.passes);
+    EXPECT_EQ(CountInstruction(GenerateVMRuntimeData(text, data, { L"reg1" }), InstructionEnum::CallNative), 0);
+    EXPECT_EQ(RunRecord(text, data), expect);
+    data.options = ParseCompileOptions({ "-lazy" }, data.passes);
+    EXPECT_EQ(RunRecord(text, data), expect);
+}
+
+TEST(VirtualMachine, NativeCallShadowed) {
+    //ͬĶ ¸ֵ֮ ͨô
+    vector<wstring> texts{
+        L"function F(reg1){ return reg1(2); }\n"
+        L"reg1(F(function(x){ return x + 1; }));\n",
+
+        L"var f = reg1;\n"
+        L"reg1 = function(x){ return f(x * 10); };\n"
+        L"reg1(4);\n",
+    };
+    vector<vector<wstring>> expects{
+        { L"3" },
+        { L"40" },
+    };
+    for (size_t i = 0; i < texts.size(); i++) {
+        auto runtimeData = GenerateVMRuntimeData(texts[i], compileData, { L"reg1" });
+        EXPECT_EQ(CountInstruction(runtimeData, InstructionEnum::CallNative), 0);
+        EXPECT_EQ(RunRecord(texts[i], compileData), expects[i]);
+    }
+}
+
+//úͬıغ ¼õĴ
+static vector<wstring> RunIntrinsic(const wstring& text, const CompileData& data, int32_t& nativeCount) {
+    vector<wstring> regNames{ L"reg1", L"ArrayLength", L"ObjectFieldCount", L"TypeOf", L"CharToInt", L"IntToChar" };
+    vector<wstring> record;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, data, regNames));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        for (int16_t i = 0; i < parameterCount; i++) {
+            auto heapPointer = VMLocalFunctionGetParameter(*vm, parameterCount, i);
+            if (VMLocalFunctionGetType(*vm, heapPointer) == HeapEnum::Char) {
+                record.push_back(wstring(1, VMLocalFunctionGetChar(*vm, heapPointer)));
+            } else {
+                record.push_back(std::to_wstring(VMLocalFunctionGetInt(*vm, heapPointer)));
+            }
+        }
+        return VMNullToHeapPointer();
+    });
+    builder.RegistLocalFunction(L"ArrayLength", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        nativeCount += 1;
+        return VMIntToHeapPointer(*vm, VMLocalFunctionGetArraySize(*vm, VMLocalFunctionGetParameter(*vm, parameterCount, 0)));
+    });
+    builder.RegistLocalFunction(L"ObjectFieldCount", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        nativeCount += 1;
+        return VMIntToHeapPointer(*vm, VMLocalFunctionGetObjectFieldSize(*vm, VMLocalFunctionGetParameter(*vm, parameterCount, 0)));
+    });
+    builder.RegistLocalFunction(L"TypeOf", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        nativeCount += 1;
+        auto type = VMLocalFunctionGetType(*vm, VMLocalFunctionGetParameter(*vm, parameterCount, 0));
+        return VMIntToHeapPointer(*vm, static_cast<int32_t>(type));
+    });
+    builder.RegistLocalFunction(L"CharToInt", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        nativeCount += 1;
+        return VMIntToHeapPointer(*vm, VMLocalFunctionGetChar(*vm, VMLocalFunctionGetParameter(*vm, parameterCount, 0)));
+    });
+    builder.RegistLocalFunction(L"IntToChar", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        nativeCount += 1;
+        return VMCharToHeapPointer(*vm, static_cast<wchar_t>(VMLocalFunctionGetInt(*vm, VMLocalFunctionGetParameter(*vm, parameterCount, 0))));
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+    return record;
+}
+
+TEST(VirtualMachine, Intrinsic) {
+    wstring text = wstring() +
+        L"var a = array[5];\n"
+        L"var o = object; o.x = 1; o.y = 2;\n"
+        L"var c = IntToChar(CharToInt('a') + 2);\n"
+        L"reg1(ArrayLength(a), ObjectFieldCount(o), TypeOf(1.5), TypeOf(a), CharToInt(c), c);\n"
+        ;
+    auto expect = vector<wstring>({ L"5", L"2", std::to_wstring(static_cast<int>(HeapEnum::Float)),
+        std::to_wstring(static_cast<int>(HeapEnum::Array)), L"99", L"c" });
+    int32_t nativeCount = 0;
+    auto data = compileData;
+    auto runtimeData = GenerateVMRuntimeData(text, data, { L"reg1", L"ArrayLength", L"ObjectFieldCount", L"TypeOf", L"CharToInt", L"IntToChar" });
+    EXPECT_EQ(CountInstruction(runtimeData, InstructionEnum::ArrayLength), 1);
+    EXPECT_EQ(CountInstruction(runtimeData, InstructionEnum::TypeOf), 2);
+    EXPECT_EQ(CountInstruction(runtimeData, InstructionEnum::CharToInt), 2);
+    EXPECT_EQ(RunIntrinsic(text, data, nativeCount), expect);
+    EXPECT_EQ(nativeCount, 0);
+    //ر֮עıغ ͬ
+    data.options = ParseCompileOptions({ "-disable=intrinsic" }, data.passes);
+    EXPECT_EQ(RunIntrinsic(text, data, nativeCount), expect);
+    EXPECT_EQ(nativeCount, 7);
+    //Ͳȷ
+    EXPECT_THROW(RunIntrinsic(L"reg1(ArrayLength(1));", compileData, nativeCount), RuntimeException);
+}
+
+TEST(VirtualMachine, IntrinsicFallback) {
+    int32_t nativeCount = 0;
+    //Ϊֵʹ עıغ
+    wstring asValue = wstring() +
+        L"var f = ArrayLength;\n"
+        L"reg1(f(array[3]), ArrayLength(array[4]));\n"
+        ;
+    EXPECT_EQ(RunIntrinsic(asValue, compileData, nativeCount), vector<wstring>({ L"3", L"4" }));
+    EXPECT_EQ(nativeCount, 1);
+    //ͬĶ ߱¸ֵ ʹú
+    nativeCount = 0;
+    wstring shadowed = wstring() +
+        L"function F(TypeOf){ return TypeOf(1); }\n"
+        L"reg1(F(function(x){ return x + 41; }));\n"
+        L"CharToInt = function(c){ return 7; };\n"
+        L"reg1(CharToInt('a'));\n"
+        ;
+    EXPECT_EQ(RunIntrinsic(shadowed, compileData, nativeCount), vector<wstring>({ L"42", L"7" }));
+    EXPECT_EQ(nativeCount, 0);
+}
+
+TEST(VirtualMachine, SelfCall) {
+    wstring text = wstring() +
+        L"var base = 1;\n"
+        L"function Fib(n){\n"
+        L"    if(n < 2){ return n * base; }\n"
+        L"    return Fib(n - 1) + Fib(n - 2);\n"
+        L"}\n"
+        L"function Count(n){\n"
+        L"    if(n == 0){ return 0; }\n"
+        L"    var inner = function(){ return Count(n - 1); };\n"
+        L"    return inner() + 1;\n"
+        L"}\n"
+        L"reg1(Fib(15), Count(4));\n"
+        ;
+    auto data = compileData;
+    auto runtimeData = GenerateVMRuntimeData(text, data, { L"reg1" });
+    //ڲе Count ʹõһհ  CallSelf
+    EXPECT_EQ(CountInstruction(runtimeData, InstructionEnum::CallSelf), 2);
+    auto expect = vector<wstring>({ L"610", L"4" });
+    EXPECT_EQ(RunRecord(text, data), expect);
+    data.options = ParseCompileOptions({ "-disable=self-call" }, data.passes);
+    EXPECT_EQ(CountInstruction(GenerateVMRuntimeData(text, data, { L"reg1" }), InstructionEnum::CallSelf), 0);
+    EXPECT_EQ(RunRecord(text, data), expect);
+    data.options = ParseCompileOptions({ "-lazy" }, data.passes);
+    EXPECT_EQ(RunRecord(text, data), expect);
+}
+
+TEST(VirtualMachine, SelfCallShadowed) {
+    //ֱ¸ֵ ͬĶڸ ߲ͬ ͨô
+    vector<wstring> texts{
+        L"function F(n){ if(n == 0){ return 0; } return F(n - 1) + 1; }\n"
+        L"var g = F;\n"
+        L"F = function(n){ return 100; };\n"
+        L"reg1(g(3));\n",
+
+        L"function F(n){ if(n == 0){ return 0; } return F(n - 1) + 1; }\n"
+        L"function G(F){ return F(2); }\n"
+        L"reg1(G(function(x){ return x * 3; }));\n",
+
+        L"function F(n){ var r = F(); return r; }\n"
+        L"reg1(F(1));\n",
+    };
+    for (size_t i = 0; i < texts.size(); i++) {
+        auto runtimeData = GenerateVMRuntimeData(texts[i], compileData, { L"reg1" });
+        EXPECT_EQ(CountInstruction(runtimeData, InstructionEnum::CallSelf), 0);
+    }
+    //հֵ е F Ȼԭĺ
+    EXPECT_EQ(RunRecord(texts[0], compileData), vector<wstring>({ L"3" }));
+    EXPECT_EQ(RunRecord(texts[1], compileData), vector<wstring>({ L"6" }));
+    EXPECT_THROW(RunRecord(texts[2], compileData), RuntimeException);
+}
+
+TEST(VirtualMachine, FrameHeaderReserved) {
+    wstring text = wstring() +
+        L"function Fib(n){\n"
+        L"    if(n < 2){ return n; }\n"
+        L"    return Fib(n - 1) + Fib(n - 2);\n"
+        L"}\n"
+        L"var g = function(f, n){ return f(n) + 1; };\n"
+        L"reg1(g(Fib, 10));\n"
+        ;
+    auto data = compileData;
+    //SP PC հ (Լ CallSelf ķֵ) ֻԤλ  GetNull
+    auto nullCount = CountInstruction(GenerateVMRuntimeData(text, data, { L"reg1" }), InstructionEnum::GetNull);
+    wstring moreCalls = text + L"reg1(g(Fib, 3), Fib(g(Fib, 1)), Fib(2));\n";
+    EXPECT_EQ(CountInstruction(GenerateVMRuntimeData(moreCalls, data, { L"reg1" }), InstructionEnum::GetNull), nullCount);
+    EXPECT_EQ(RunRecord(moreCalls, data), vector<wstring>({ L"56", L"3", L"1", L"1" }));
+}
+
+TEST(VirtualMachine, FrameHeaderGC) {
+    vector<wstring> regNames{
+        L"reg1",
+        L"reg2",
+        L"reg3",
+    };
+    /*
+        ʱ Ԥλ֮ǰµֵ
+        reg3 Ĳ֮ Use  SP PC հλ һλʱλջ֮  ָ֮ filler м
+    */
+    wstring text = wstring() +
+        L"var Use = function(a, b){ return a[0]; };\n"
+        L"var i = 0;\n"
+        L"while(i < 3){\n"
+        L"    var arr = array[2];\n"
+        L"    arr[0] = i * 10;\n"
+        L"    reg3(array[50], array[50], array[50], array[50]);\n"
+        L"    reg1();\n"
+        L"    var filler = array[400];\n"
+        L"    reg2(Use(arr, reg1()));\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        ;
+    vector<int32_t> record;
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        VirtualMachineGC(*vm);
+        return VMNullToHeapPointer();
+    });
+    builder.RegistLocalFunction(L"reg2", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        record.push_back(VMLocalFunctionGetInt(*vm, VMLocalFunctionGetParameter(*vm, parameterCount, 0)));
+        return VMNullToHeapPointer();
+    });
+    builder.RegistLocalFunction(L"reg3", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        return VMNullToHeapPointer();
+    });
+    auto vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+    EXPECT_EQ(record, vector<int32_t>({ 0, 10, 20 }));
+    EXPECT_EQ(vm.gcCount, 6);
+}
+
+//reg1  reg2 ¼ ֮ vm Ϊнʱ
+using NativeList = vector<pair<wstring, function<int32_t(VirtualMachine*, int16_t)>>>;
+
+//reg1  reg2 ¼ natives Ϊעıغ
+static vector<int32_t> RunCacheRecord(const wstring& text, VirtualMachine& vm, int32_t heapMax = 0, const NativeList& natives = {}) {
+    vector<int32_t> record;
+    vector<wstring> regNames{ L"reg1", L"reg2" };
+    for (auto& [name, native] : natives) {
+        regNames.push_back(name);
+    }
+    auto builder = VirtualMachineBuilder(GenerateVMRuntimeData(text, compileData, regNames));
+    for (auto& [name, native] : natives) {
+        builder.RegistLocalFunction(name, native);
+    }
+    if (heapMax > 0) {
+        builder.SetHeapMax(heapMax);
+    }
+    builder.RegistLocalFunction(L"reg1", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        VirtualMachineGC(*vm);
+        return VMNullToHeapPointer();
+    });
+    builder.RegistLocalFunction(L"reg2", [&](VirtualMachine* vm, int16_t parameterCount) ->int32_t {
+        record.push_back(VMLocalFunctionGetInt(*vm, VMLocalFunctionGetParameter(*vm, parameterCount, 0)));
+        return VMNullToHeapPointer();
+    });
+    vm = builder.Build();
+    VirtualMachineInit(vm);
+    VirtualMachineStart(vm);
+    return record;
+}
+
+TEST(VirtualMachine, CallCache) {
+    //ƶ˺ ֮ ֮ĵȻ
+    wstring text = wstring() +
+        L"var junk = array[100];\n"
+        L"junk = null;\n"
+        L"var base = 5;\n"
+        L"var f = function(x){ return x + base; };\n"
+        L"var i = 0;\n"
+        L"var sum = 0;\n"
+        L"while(i < 100){\n"
+        L"    sum = sum + f(i);\n"
+        L"    if(i == 50){ reg1(); }\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg2(sum);\n"
+        ;
+    VirtualMachine vm;
+    EXPECT_EQ(RunCacheRecord(text, vm), vector<int32_t>({ 5450 }));
+    // Լ f ĵôһ
+    EXPECT_EQ(vm.callCacheMiss, 2);
+    //ͬһô ÿζ¼
+    wstring polymorphic = wstring() +
+        L"var a = function(x){ return x + 1; };\n"
+        L"var b = function(x){ return x * 2; };\n"
+        L"var i = 0;\n"
+        L"var f = a;\n"
+        L"while(i < 4){\n"
+        L"    reg2(f(i));\n"
+        L"    if(f == a){ f = b; } else { f = a; }\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        ;
+    EXPECT_EQ(RunCacheRecord(polymorphic, vm), vector<int32_t>({ 1, 2, 3, 6 }));
+    EXPECT_EQ(vm.callCacheMiss, 5);
+}
+
+TEST(VirtualMachine, CallCacheInvalidate) {
+    //ÿѭµĺ ֮һڱյĺԭλ ʹþɵĺ
+    wstring text = wstring() +
+        L"var MakeAdd = function(n){ return function(x){ return x + n; }; };\n"
+        L"var MakeMultiply = function(n){ return function(x){ return x * n; }; };\n"
+        L"var i = 0;\n"
+        L"while(i < 4){\n"
+        L"    var h = null;\n"
+        L"    if(i % 2 == 0){ h = MakeAdd(i * 10); } else { h = MakeMultiply(i * 10); }\n"
+        L"    reg2(h(2));\n"
+        L"    h = null;\n"
+        L"    reg1();\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        ;
+    VirtualMachine vm;
+    EXPECT_EQ(RunCacheRecord(text, vm), vector<int32_t>({ 2, 20, 22, 60 }));
+}
+
+TEST(VirtualMachine, ObjectShape) {
+    //ֶε˳ͬĶ״ ͬһʴֻڵһβ
+    wstring text = wstring() +
+        L"var Make = function(x){ var o = object; o.x = x; o.y = x * 2; return o; };\n"
+        L"var i = 0;\n"
+        L"var sum = 0;\n"
+        L"while(i < 50){\n"
+        L"    var o = Make(i);\n"
+        L"    o.x = o.x + 1;\n"
+        L"    sum = sum + o.x + o.y;\n"
+        L"    if(i == 25){ reg1(); }\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"reg2(sum);\n"
+        //˳ͬ ״ͬ ֶεֵӰ
+        L"var a = object; a.p = 1; a.q = 2;\n"
+        L"var b = object; b.q = 3; b.p = 4;\n"
+        L"var Sum = function(o){ return o.p * 10 + o.q; };\n"
+        L"reg2(Sum(a));\n"
+        L"reg2(Sum(b));\n"
+        ;
+    VirtualMachine vm;
+    EXPECT_EQ(RunCacheRecord(text, vm), vector<int32_t>({ 3725, 12, 43 }));
+    //ѭ Make μ o.x Ķд o.x o.y Ķȡ һ a b ļ Sum  o.p o.q  a b һ
+    EXPECT_EQ(vm.fieldCacheMiss, 6 + 4 + 4);
+    //յ״ x y  p q  q p 
+    EXPECT_EQ(vm.shapes.size(), 1 + 2 + 2 + 2);
+}
+
+TEST(VirtualMachine, ObjectFieldGrow) {
+    //ֶθʼ ObjectFieldList · ֮䷢
+    wstring text = wstring() +
+        L"var o = object;\n"
+        L"o.f0 = 0; o.f1 = 1; o.f2 = 2; o.f3 = 3; o.f4 = 4; o.f5 = 5; o.f6 = 6; o.f7 = 7;\n"
+        L"o.f8 = 8; o.f9 = 9; o.f10 = 10; o.f11 = 11; o.f12 = 12; o.f13 = 13; o.f14 = 14; o.f15 = 15;\n"
+        L"reg1();\n"
+        L"o.f16 = array[3];\n"
+        L"o.f16[0] = 16;\n"
+        L"o.f17 = 17;\n"
+        L"reg1();\n"
+        L"reg2(o.f12);\n"
+        L"reg2(o.f0 + o.f7 + o.f15 + o.f16[0] + o.f17);\n"
+        ;
+    VirtualMachine vm;
+    EXPECT_EQ(RunCacheRecord(text, vm), vector<int32_t>({ 12, 55 }));
+    EXPECT_THROW(RunCacheRecord(L"var o = object; o.x = 1; reg2(o.y);", vm), RuntimeException);
+}
+
+TEST(VirtualMachine, ObjectHashTable) {
+    //ֶθ VMObjectHashTableThreshold ֮Ϊ ObjectHashTable ״
+    wstring text = L"var o = object;\nvar p = object;\n";
+    for (int i = 0; i < 200; i++) {
+        text += L"o.f" + std::to_wstring(i) + L" = " + std::to_wstring(i) + L";\n";
+        if (i == 100) {
+            text += L"reg1();\n";
+        }
+    }
+    for (int i = 0; i < 200; i++) {
+        text += L"p.f" + std::to_wstring(i) + L" = o.f" + std::to_wstring(i) + L";\n";
+    }
+    text +=
+        L"o.f3 = 1000;\n"
+        L"reg1(o, p);\n"
+        L"reg2(o.f3 + o.f199 + p.f3);\n"
+        L"var i = 0;\n"
+        L"var sum = 0;\n"
+        L"while(i < 10){ sum = sum + p.f150 + o.f64; i = i + 1; }\n"
+        L"reg2(sum);\n";
+    VirtualMachine vm;
+    EXPECT_EQ(RunCacheRecord(text, vm), vector<int32_t>({ 1202, 2140 }));
+    EXPECT_EQ(vm.shapes.size(), VMObjectHashTableThreshold + 1);
+}
+
+TEST(VirtualMachine, ObjectHashTableGrow) {
+    // ֶεֵΪ ֮䷢
+    wstring text = L"var o = object;\nvar n = 0;\n";
+    for (int i = 0; i < 2000; i++) {
+        wstring name = L"o.f" + std::to_wstring(i);
+        text += name + L" = array[1];\n" + name + L"[0] = n;\nn = n + 1;\n";
+        if (i % 300 == 0) {
+            text += L"var junk" + std::to_wstring(i) + L" = array[50];\nreg1(o);\n";
+        }
+    }
+    text += L"reg2(o.f0[0] + o.f777[0] + o.f1999[0]);\n";
+    VirtualMachine vm;
+    EXPECT_EQ(RunCacheRecord(text, vm, 65536), vector<int32_t>({ 2776 }));
+    EXPECT_THROW(RunCacheRecord(text + L"reg2(o.missing);", vm, 65536), RuntimeException);
+}
+
+static const NativeList mapNatives{
+    { L"Map", VMMapCreate },
+    { L"MapGet", VMMapGet },
+    { L"MapSet", VMMapSet },
+    { L"MapHas", VMMapHas },
+    { L"MapDelete", VMMapDelete },
+    { L"MapSize", VMMapSize },
+    { L"MapKeys", VMMapKeys },
+};
+
+TEST(VirtualMachine, Map) {
+    //Int Char String ļͬ ʱƴӵַ볣ʱΪͬһ
+    wstring text = wstring() +
+        L"var m = Map();\n"
+        L"reg2(MapSize(m));\n"
+        L"if(MapGet(m, 1) == null){ reg2(-1); }\n"
+        L"MapSet(m, 65, 1);\n"
+        L"MapSet(m, 'A', 2);\n"
+        L"MapSet(m, \"ab\", 3);\n"
+        L"var s = \"a\" + 'b';\n"
+        L"reg2(MapGet(m, 65) + MapGet(m, 'A') * 10 + MapGet(m, s) * 100);\n"
+        L"MapSet(m, s, 4);\n"
+        L"reg2(MapGet(m, \"ab\"));\n"
+        L"reg2(MapSize(m));\n"
+        L"if(MapDelete(m, 'A')){ reg2(1); }\n"
+        L"if(MapDelete(m, 'A') == false){ reg2(0); }\n"
+        L"if(MapHas(m, 'A') == false && MapHas(m, 65)){ reg2(MapSize(m)); }\n"
+        L"MapSet(m, 'A', 5);\n"
+        L"var keys = MapKeys(m);\n"
+        L"var i = 0;\n"
+        L"var sum = 0;\n"
+        L"while(i < MapSize(m)){ sum = sum + MapGet(m, keys[i]); i = i + 1; }\n"
+        L"reg2(sum);\n"
+        ;
+    VirtualMachine vm;
+    EXPECT_EQ(RunCacheRecord(text, vm, 0, mapNatives), vector<int32_t>({ 0, -1, 321, 4, 3, 1, 0, 2, 10 }));
+}
+
+TEST(VirtualMachine, MapGrow) {
+    // ɾ֮· ֮䷢ ֵΪ
+    wstring text = wstring() +
+        L"var m = Map();\n"
+        L"var i = 0;\n"
+        L"while(i < 2000){\n"
+        L"    var a = array[1];\n"
+        L"    a[0] = i;\n"
+        L"    MapSet(m, i, a);\n"
+        L"    if(i % 300 == 0){ var junk = array[50]; reg1(); }\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"i = 0;\n"
+        L"while(i < 2000){ MapDelete(m, i); i = i + 2; }\n"
+        L"reg1();\n"
+        L"reg2(MapSize(m));\n"
+        L"i = 0;\n"
+        L"var c = array[3];\n"
+        L"c[0] = 'a'; c[1] = 'b'; c[2] = 'c';\n"
+        L"while(i < 1000){ MapSet(m, \"k\" + c[i % 3], i); i = i + 1; }\n"
+        L"reg2(MapSize(m));\n"
+        L"reg2(MapGet(m, 1)[0] + MapGet(m, 1999)[0] + MapGet(m, \"kc\"));\n"
+        L"if(MapGet(m, 2) == null){ reg2(0); }\n"
+        ;
+    VirtualMachine vm;
+    EXPECT_EQ(RunCacheRecord(text, vm, 65536, mapNatives), vector<int32_t>({ 1000, 1003, 2998, 0 }));
+    EXPECT_THROW(RunCacheRecord(L"var m = Map(); MapSet(m, 1.5, 1);", vm, 0, mapNatives), RuntimeException);
+    EXPECT_THROW(RunCacheRecord(L"var m = Map(); MapSet(m, array[1], 1);", vm, 0, mapNatives), RuntimeException);
+}
+
+TEST(VirtualMachine, CreateObjectGC) {
+    // Object ʱ շ ObjectFieldList ƶ ָƶ֮λ
+    wstring text = wstring() +
+        L"var keep = array[80];\n"
+        L"var i = 0;\n"
+        L"while(i < 2000){\n"
+        L"    var o = object;\n"
+        L"    o.a = i;\n"
+        L"    o.b = i * 2;\n"
+        L"    keep[i % 80] = o;\n"
+        L"    i = i + 1;\n"
+        L"}\n"
+        L"var sum = 0;\n"
+        L"i = 0;\n"
+        L"while(i < 80){ sum = sum + keep[i].b - keep[i].a * 2; i = i + 1; }\n"
+        L"reg2(sum);\n"
+        L"reg2(keep[79].a);\n"
+        ;
+    //ͬĶѴСʹշڲͬķ䴦 аη֮
+    for (int32_t heapMax = 4096; heapMax < 4096 + 64; heapMax++) {
+        VirtualMachine vm;
+        EXPECT_EQ(RunCacheRecord(text, vm, heapMax), vector<int32_t>({ 0, 1999 }));
+    }
 }
\ No newline at end of file